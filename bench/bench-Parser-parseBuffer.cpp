@@ -0,0 +1,103 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "tests.h"
+
+// Parse-time benchmark: generates documents with increasing number of
+// elements and reports the time taken by Parser::parseBuffer().  Each unit
+// has a region, a descriptor, a port, a media and a link with two binds,
+// so that every id-reference lookup of the parser is exercised.  Built
+// only if WITH_BENCHMARKS is on, and run by the "bench" target.  The same
+// document, at a small size, is checked by test-Parser-parseBuffer-refs.
+
+#define ELTS_PER_UNIT 7
+
+static string
+gen_document (int units)
+{
+  string regions, descriptors, body;
+
+  for (int i = 0; i < units; i++)
+    {
+      regions += xstrbuild ("   <region id='r%d' width='10%%'/>\n", i);
+      descriptors += xstrbuild (
+          "   <descriptor id='d%d' region='r%d'/>\n", i, i);
+      body += xstrbuild ("  <port id='p%d' component='m%d'/>\n", i, i);
+      body += xstrbuild ("  <media id='m%d' descriptor='d%d'/>\n", i, i);
+      body += xstrbuild ("\
+  <link xconnector='onBeginStart'>\n\
+   <bind role='onBegin' component='m%d'/>\n\
+   <bind role='start' component='m%d'/>\n\
+  </link>\n",
+                         i, (i + 1) % units);
+    }
+
+  return "\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n" + regions + "\
+  </regionBase>\n\
+  <descriptorBase>\n" + descriptors + "\
+  </descriptorBase>\n\
+  <connectorBase>\n\
+   <causalConnector id='onBeginStart'>\n\
+    <simpleCondition role='onBegin'/>\n\
+    <simpleAction role='start'/>\n\
+   </causalConnector>\n\
+  </connectorBase>\n\
+ </head>\n\
+ <body>\n" + body + "\
+ </body>\n\
+</ncl>\n";
+}
+
+int
+main (void)
+{
+  int sizes[] = { 1000, 5000, 10000, 20000, 50000 };
+
+  g_print ("%8s %12s %12s\n", "elements", "msec", "usec/elt");
+  for (auto n : sizes)
+    {
+      Document *doc;
+      string buf;
+      string errmsg;
+      gint64 t0, dt;
+      int units;
+
+      units = n / ELTS_PER_UNIT;
+      buf = gen_document (units);
+
+      t0 = g_get_monotonic_time ();
+      doc = Parser::parseBuffer (buf.c_str (), buf.length (), 800, 600,
+                                 &errmsg);
+      dt = g_get_monotonic_time () - t0;
+
+      if (doc == nullptr)
+        {
+          g_printerr ("*** Unexpected error: %s\n", errmsg.c_str ());
+          g_assert_not_reached ();
+        }
+      g_assert_cmpint (doc->getMedias ()->size (), ==, units + 1); // +settings
+
+      g_print ("%8d %12.2f %12.3f\n", units * ELTS_PER_UNIT,
+               (double) dt / 1000., (double) dt / (units * ELTS_PER_UNIT));
+      delete doc;
+    }
+
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,161 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+#include "WebServices.h"
+#include "PlayerRemote.h"
+#include <libsoup/soup.h>
+
+// Remote player benchmark: a document with many remote medias is bound to
+// a local libsoup mock of a remote player.  Each round starts and then
+// stops every media in a single tick, and reports the rate at which the
+// mock receives the resulting actions and their latency, measured from the
+// tick that flushed them to their arrival.  Built only if WITH_BENCHMARKS
+// is on; coalescing and delivery are checked by test-PlayerRemote-flush.
+
+#define BENCH_PORT (WS_PORT_DEFAULT + 20)
+#define BENCH_ROUNDS 10
+
+static guint received;
+static gint64 flushed_at;
+static vector<gint64> latencies;
+
+static void
+cb_mock_node (SoupServer *server, SoupMessage *msg, const char *path,
+              GHashTable *query, SoupClientContext *client, gpointer data)
+{
+  latencies.push_back (g_get_monotonic_time () - flushed_at);
+  received++;
+  soup_message_set_status (msg, SOUP_STATUS_OK);
+}
+
+static void
+cb_mock_default (SoupServer *server, SoupMessage *msg, const char *path,
+                 GHashTable *query, SoupClientContext *client, gpointer data)
+{
+  soup_message_set_status (msg, SOUP_STATUS_OK);
+}
+
+static string
+gen_document (int n)
+{
+  string body;
+
+  for (int i = 0; i < n; i++)
+    body += xstrbuild ("  <media id='m%d' type='%s'/>\n", i,
+                       REMOTE_PLAYER_MIME_NCL360);
+  return "<ncl>\n <body>\n" + body + " </body>\n</ncl>\n";
+}
+
+// Applies \p trans to every media in a single tick and waits for the
+// actions to arrive at the mock.
+static void
+run_tick (Formatter *fmt, Document *doc, int n, Event::Transition trans,
+          guint expected)
+{
+  for (int i = 0; i < n; i++)
+    {
+      Object *obj = doc->getObjectById (xstrbuild ("m%d", i));
+      g_assert_nonnull (obj);
+      doc->evalAction (obj->getLambda (), trans);
+    }
+  flushed_at = g_get_monotonic_time ();
+  fmt->sendTick (0, 0, 0);
+  while (received < expected)
+    g_main_context_iteration (nullptr, TRUE);
+}
+
+static gint64
+percentile (vector<gint64> &v, double p)
+{
+  size_t k = (size_t) ceil (p * v.size ());
+  return v[(k > 0) ? k - 1 : 0];
+}
+
+int
+main (void)
+{
+  int sizes[] = { 10, 100, 250 };
+  SoupServer *server;
+  GError *error = nullptr;
+  string location;
+
+  server = soup_server_new (SOUP_SERVER_SERVER_HEADER, "mock", nullptr);
+  g_assert_nonnull (server);
+  if (!soup_server_listen_local (server, BENCH_PORT,
+                                 SoupServerListenOptions (0), &error))
+    ERROR ("cannot start mock remote player: %s", error->message);
+  soup_server_add_handler (server, "/scene/nodes", cb_mock_node,
+                           nullptr, nullptr);
+  soup_server_add_handler (server, nullptr, cb_mock_default, nullptr,
+                           nullptr);
+  location = xstrbuild ("http://127.0.0.1:%d", BENCH_PORT);
+
+  g_print ("%8s %12s %10s %10s %10s\n", "medias", "events/s", "p50 ms",
+           "p99 ms", "max ms");
+  for (auto n : sizes)
+    {
+      Formatter *fmt;
+      Document *doc;
+      PlayerRemoteData pdata;
+      WebServicesRemoteStats stats;
+      gint64 t0, dt;
+
+      tests_parse_and_start (&fmt, &doc, gen_document (n));
+      pdata.location = location;
+      pdata.deviceType = "bench";
+      pdata.supportedFormats.push_back (REMOTE_PLAYER_MIME_NCL360);
+      pdata.recognizedableEvents.push_back ("selection");
+      g_assert (fmt->getWebServices ()->machMediaThenSetPlayerRemote (pdata));
+
+      // Start followed by stop in the same tick is coalesced away.
+      for (int i = 0; i < n; i++)
+        {
+          Object *obj = doc->getObjectById (xstrbuild ("m%d", i));
+          doc->evalAction (obj->getLambda (), Event::START);
+          doc->evalAction (obj->getLambda (), Event::STOP);
+        }
+      fmt->sendTick (0, 0, 0);
+      fmt->getWebServices ()->getRemoteStats (&stats);
+      g_assert_cmpuint (stats.coalesced, ==, (guint64) (2 * n));
+
+      received = 0;
+      latencies.clear ();
+      t0 = g_get_monotonic_time ();
+      for (int r = 0; r < BENCH_ROUNDS; r++)
+        {
+          run_tick (fmt, doc, n, Event::START, received + n);
+          run_tick (fmt, doc, n, Event::STOP, received + n);
+        }
+      dt = g_get_monotonic_time () - t0;
+
+      fmt->getWebServices ()->getRemoteStats (&stats);
+      g_assert_cmpuint (stats.sent, ==, received);
+      g_assert_cmpuint (stats.dropped, ==, 0);
+      g_assert_cmpuint (stats.failed, ==, 0);
+
+      std::sort (latencies.begin (), latencies.end ());
+      g_print ("%8d %12.0f %10.3f %10.3f %10.3f\n", n,
+               received / ((double) dt / G_USEC_PER_SEC),
+               percentile (latencies, .5) / 1000.,
+               percentile (latencies, .99) / 1000.,
+               latencies.back () / 1000.);
+      delete fmt;
+    }
+
+  g_object_unref (server);
+  exit (EXIT_SUCCESS);
+}
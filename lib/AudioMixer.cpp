@@ -0,0 +1,374 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "aux-ginga.h"
+#include "AudioMixer.h"
+
+namespace ginga {
+
+/// Time the mixer waits for late inputs before mixing without them.
+#define AUDIO_MIXER_LATENCY (40 * GINGA_MSECOND)
+
+/// Format of the mixed stream.
+#define AUDIO_MIXER_CAPS "audio/x-raw, rate=(int)48000, channels=(int)2"
+
+/// Mixer pipeline: a live silent source keeps the mixer running at clock
+/// rate, so that inputs can come and go (or stall) without stopping it.
+static GstElement *audio_mixer_pipeline;
+static GstElement *audio_mixer_mixer;
+
+/// Description of the output sink (see gst_parse_bin_from_description()).
+static string audio_mixer_sink = "autoaudiosink";
+
+/// Number of attached inputs.
+static guint audio_mixer_inputs;
+
+/// Serializes building the mixer, setSink(), attach() and detach(); the
+/// latter may run in another thread.
+static GMutex audio_mixer_mutex;
+
+/// Logs errors and warnings posted on mixer pipeline.  Nobody watches the
+/// mixer bus, so every message is dropped here.
+static GstBusSyncReply
+audio_mixer_bus_sync (unused (GstBus *bus), GstMessage *msg,
+                      unused (gpointer data))
+{
+  GError *error = nullptr;
+
+  switch (GST_MESSAGE_TYPE (msg))
+    {
+    case GST_MESSAGE_ERROR:
+      gst_message_parse_error (msg, &error, nullptr);
+      break;
+    case GST_MESSAGE_WARNING:
+      gst_message_parse_warning (msg, &error, nullptr);
+      break;
+    default:
+      break;
+    }
+
+  if (error != nullptr)
+    {
+      WARNING ("audio mixer: %s: %s", GST_MESSAGE_SRC_NAME (msg),
+               error->message);
+      g_error_free (error);
+    }
+
+  gst_message_unref (msg);
+  return GST_BUS_DROP;
+}
+
+/// Closes the output device at exit.  The pipeline itself is kept, as
+/// inputs may still be detached by the reaper thread.
+static void
+audio_mixer_shutdown (void)
+{
+  g_mutex_lock (&audio_mixer_mutex);
+  gst_element_set_state (audio_mixer_pipeline, GST_STATE_NULL);
+  g_mutex_unlock (&audio_mixer_mutex);
+}
+
+/// Drops the elements created by a failed audio_mixer_build().
+static void
+audio_mixer_unref (GstElement **elts, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    if (elts[i] != nullptr)
+      gst_object_unref (elts[i]);
+}
+
+/// Builds and starts mixer pipeline.  Returns false on failure, leaving
+/// #audio_mixer_pipeline and #audio_mixer_mixer null.  Must be called
+/// with #audio_mixer_mutex held.
+static bool
+audio_mixer_build (void)
+{
+  GstElement *pipeline;
+  GstElement *silence;
+  GstElement *mixer;
+  GstElement *caps;
+  GstElement *convert;
+  GstElement *resample;
+  GstElement *sink;
+  GstBus *bus;
+  GstCaps *filter;
+  GError *err = nullptr;
+
+  sink = gst_parse_bin_from_description (audio_mixer_sink.c_str (), TRUE,
+                                         &err);
+  if (unlikely (sink == nullptr))
+    {
+      WARNING ("bad audio sink '%s': %s", audio_mixer_sink.c_str (),
+               err->message);
+      g_error_free (err);
+      return false;
+    }
+
+  silence = gst_element_factory_make ("audiotestsrc", "mixer.silence");
+  mixer = gst_element_factory_make ("audiomixer", "mixer.mix");
+  caps = gst_element_factory_make ("capsfilter", "mixer.caps");
+  convert = gst_element_factory_make ("audioconvert", "mixer.convert");
+  resample = gst_element_factory_make ("audioresample", "mixer.resample");
+  if (unlikely (silence == nullptr || mixer == nullptr || caps == nullptr
+                || convert == nullptr || resample == nullptr))
+    {
+      GstElement *elts[]
+          = { silence, mixer, caps, convert, resample, sink };
+      WARNING ("cannot create audio mixer: missing GStreamer elements");
+      audio_mixer_unref (elts, G_N_ELEMENTS (elts));
+      return false;
+    }
+
+  g_object_set (silence, "is-live", TRUE, nullptr);
+  gst_util_set_object_arg (G_OBJECT (silence), "wave", "silence");
+  g_object_set (mixer, "latency", AUDIO_MIXER_LATENCY, nullptr);
+  filter = gst_caps_from_string (AUDIO_MIXER_CAPS);
+  g_assert_nonnull (filter);
+  g_object_set (caps, "caps", filter, nullptr);
+  gst_caps_unref (filter);
+
+  pipeline = gst_pipeline_new ("mixer");
+  g_assert_nonnull (pipeline);
+  gst_bin_add_many (GST_BIN (pipeline), silence, mixer, caps, convert,
+                    resample, sink, nullptr);
+  g_assert (gst_element_link_many (silence, mixer, caps, convert,
+                                   resample, sink, nullptr));
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  g_assert_nonnull (bus);
+  gst_bus_set_sync_handler (bus, audio_mixer_bus_sync, nullptr, nullptr);
+  gst_object_unref (bus);
+
+  if (unlikely (gst_element_set_state (pipeline, GST_STATE_PLAYING)
+                == GST_STATE_CHANGE_FAILURE))
+    {
+      WARNING ("cannot start audio mixer");
+      gst_element_set_state (pipeline, GST_STATE_NULL);
+      gst_object_unref (pipeline);
+      return false;
+    }
+
+  // Published last, as getRunningTime() reads it without the lock.
+  audio_mixer_mixer = mixer;
+  g_atomic_pointer_set (&audio_mixer_pipeline, pipeline);
+  atexit (audio_mixer_shutdown);
+  return true;
+}
+
+/// Gets mixer pipeline, building it if needed (or null, if it could not
+/// be created).  A failed build is retried on the next call, e.g., after
+/// setSink() has replaced a bad sink.
+static GstElement *
+audio_mixer_get (void)
+{
+  GstElement *pipeline;
+
+  g_mutex_lock (&audio_mixer_mutex);
+  if (audio_mixer_pipeline == nullptr)
+    audio_mixer_build ();
+  pipeline = audio_mixer_pipeline;
+  g_mutex_unlock (&audio_mixer_mutex);
+  return pipeline;
+}
+
+/**
+ * @brief Sets the output sink of the mixer.
+ *
+ * Must be called before the mixer is started by the first attached
+ * input; afterwards, the mixer is already connected to its output and
+ * this function fails.  If the mixer could not be started, e.g., because
+ * of a bad sink, a new sink may be set and the next attach() retries.
+ * Tests use it to mix into a \c fakesink or \c filesink.
+ *
+ * @param desc Sink description, in gst-launch syntax (e.g. "fakesink
+ * sync=true").
+ * @param errmsg Variable to store the error message (if any).
+ * @return True if successful, or false otherwise.
+ */
+bool
+AudioMixer::setSink (const string &desc, string *errmsg)
+{
+  bool status = true;
+
+  g_mutex_lock (&audio_mixer_mutex);
+  if (unlikely (audio_mixer_pipeline != nullptr))
+    {
+      tryset (errmsg, "audio mixer is already running");
+      status = false;
+    }
+  else
+    {
+      audio_mixer_sink = desc;
+    }
+  g_mutex_unlock (&audio_mixer_mutex);
+  return status;
+}
+
+/**
+ * @brief Attaches an input to the mixer.
+ *
+ * Adds \p bin to the mixer pipeline, links its "src" pad to a new request
+ * pad of the mixer and brings it to the state of the mixer.  The mixer
+ * takes ownership of \p bin, even on failure.  Volume and mute are set on
+ * the returned pad.  The first call starts the mixer and opens the output
+ * device, which stays open until the process exits.
+ *
+ * @param bin Bin producing raw audio on its "src" pad.
+ * @return The mixer pad the input is linked to, or null on failure.
+ */
+GstPad *
+AudioMixer::attach (GstElement *bin)
+{
+  GstElement *pipeline;
+  GstPad *src;
+  GstPad *pad;
+
+  g_assert_nonnull (bin);
+  gst_object_ref_sink (bin);
+
+  pipeline = audio_mixer_get ();
+  if (unlikely (pipeline == nullptr))
+    {
+      gst_object_unref (bin);
+      return nullptr;
+    }
+
+  g_mutex_lock (&audio_mixer_mutex);
+
+  src = gst_element_get_static_pad (bin, "src");
+  g_assert_nonnull (src);
+  pad = gst_element_get_request_pad (audio_mixer_mixer, "sink_%u");
+  g_assert_nonnull (pad);
+
+  g_assert (gst_bin_add (GST_BIN (pipeline), bin));
+  if (unlikely (gst_pad_link (src, pad) != GST_PAD_LINK_OK))
+    {
+      WARNING ("cannot link %s to audio mixer", GST_ELEMENT_NAME (bin));
+      gst_element_release_request_pad (audio_mixer_mixer, pad);
+      gst_object_unref (pad);
+      gst_bin_remove (GST_BIN (pipeline), bin);
+      pad = nullptr;
+    }
+  else
+    {
+      gst_element_sync_state_with_parent (bin);
+      audio_mixer_inputs++;
+    }
+
+  gst_object_unref (src);
+  gst_object_unref (bin);
+
+  g_mutex_unlock (&audio_mixer_mutex);
+  return pad;
+}
+
+/**
+ * @brief Detaches an input from the mixer.
+ *
+ * Stops the bin linked to \p pad, removes it from the mixer pipeline and
+ * releases \p pad.  This blocks until the bin's streaming threads are
+ * done, so players call it from the reaper thread.
+ *
+ * @param pad Pad returned by attach().
+ */
+void
+AudioMixer::detach (GstPad *pad)
+{
+  GstPad *src;
+  GstElement *bin;
+
+  g_assert_nonnull (pad);
+  g_mutex_lock (&audio_mixer_mutex);
+
+  src = gst_pad_get_peer (pad);
+  g_assert_nonnull (src);
+  bin = gst_pad_get_parent_element (src);
+  g_assert_nonnull (bin);
+
+  gst_element_set_locked_state (bin, TRUE);
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_pad_unlink (src, pad);
+  gst_element_release_request_pad (audio_mixer_mixer, pad);
+  gst_bin_remove (GST_BIN (audio_mixer_pipeline), bin);
+
+  gst_object_unref (bin);
+  gst_object_unref (src);
+  gst_object_unref (pad);
+
+  g_assert (audio_mixer_inputs > 0);
+  audio_mixer_inputs--;
+  g_mutex_unlock (&audio_mixer_mutex);
+}
+
+/**
+ * @brief Gets the running time of the mixer.
+ *
+ * Inputs are scheduled against this time: a buffer with running time
+ * \c t on a pad whose offset is \c o is mixed at running time \c t+o.
+ *
+ * @return The mixer running time, or zero if the mixer is not running.
+ */
+Time
+AudioMixer::getRunningTime ()
+{
+  GstElement *pipeline;
+  GstClock *clock;
+  Time now;
+
+  pipeline = (GstElement *) g_atomic_pointer_get (&audio_mixer_pipeline);
+  if (pipeline == nullptr)
+    return 0;
+
+  clock = gst_element_get_clock (pipeline);
+  if (clock == nullptr)
+    return 0;
+
+  now = gst_clock_get_time (clock);
+  gst_object_unref (clock);
+  return now - gst_element_get_base_time (pipeline);
+}
+
+/**
+ * @brief Gets the latency of the mixer.
+ *
+ * Input buffers must reach the mixer within this time of their running
+ * time; later data is mixed without them.
+ *
+ * @return The mixer latency.
+ */
+Time
+AudioMixer::getLatency ()
+{
+  return AUDIO_MIXER_LATENCY;
+}
+
+/**
+ * @brief Gets the number of inputs attached to the mixer.
+ * @return The number of inputs.
+ */
+guint
+AudioMixer::getInputCount ()
+{
+  guint n;
+
+  g_mutex_lock (&audio_mixer_mutex);
+  n = audio_mixer_inputs;
+  g_mutex_unlock (&audio_mixer_mutex);
+  return n;
+}
+
+}
@@ -68,4 +68,22 @@ Composition::addChild (Object *child)
     }
 }
 
+/**
+ * @brief Removes child from composition and from document.
+ *
+ * The child is not stopped nor destroyed; this is up to the caller.
+ *
+ * @param child The child to remove.
+ */
+void
+Composition::removeChild (Object *child)
+{
+  g_assert_nonnull (child);
+  if (_children.erase (child) > 0)
+    {
+      child->resetParent ();
+      g_assert (_doc->removeObject (child));
+    }
+}
+
 }
@@ -32,6 +32,7 @@ public:
   Object *getChildById (const string &);
   Object *getChildByIdOrAlias (const string &);
   void addChild (Object *);
+  void removeChild (Object *);
 
 protected:
   set<Object *> _children;
@@ -23,6 +23,18 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 
 namespace ginga {
 
+/// Deletes the predicates of a link.
+static void
+context_link_delete_predicates (pair<list<Action>, list<Action> > &link)
+{
+  for (auto &cond : link.first)
+    if (cond.predicate != nullptr)
+      delete cond.predicate;
+  for (auto &act : link.second)
+    if (act.predicate != nullptr)
+      delete act.predicate;
+}
+
 // Public.
 
 Context::Context (const string &id) : Composition (id)
@@ -39,15 +51,8 @@ Context::~Context ()
     delete child;
 
   // Delete predicates in links.
-  for (auto link : _links)
-    {
-      for (auto &cond : link.first)
-        if (cond.predicate != nullptr)
-          delete cond.predicate;
-      for (auto &act : link.second)
-        if (act.predicate != nullptr)
-          delete act.predicate;
-    }
+  for (auto &link : _links)
+    context_link_delete_predicates (link);
 }
 
 // Public: Object.
@@ -138,6 +143,44 @@ Context::setProperty (const string &name, const string &value, Time dur)
   Object::setProperty (name, value, dur);
 }
 
+void
+Context::removeReferences (const set<Object *> &objs)
+{
+  Object::removeReferences (objs);
+
+  // Drop ports mapped to removed objects.
+  for (auto it = _ports.begin (); it != _ports.end ();)
+    {
+      if (objs.find ((*it)->getObject ()) != objs.end ())
+        it = _ports.erase (it);
+      else
+        ++it;
+    }
+
+  // Drop links that refer to removed objects.
+  auto it = _links.begin ();
+  auto it_id = _linkIds.begin ();
+  while (it != _links.end ())
+    {
+      bool found = false;
+      for (auto lst : { &it->first, &it->second })
+        for (auto &act : *lst)
+          if (objs.find (act.event->getObject ()) != objs.end ())
+            found = true;
+      if (found)
+        {
+          context_link_delete_predicates (*it);
+          it = _links.erase (it);
+          it_id = _linkIds.erase (it_id);
+        }
+      else
+        {
+          ++it;
+          ++it_id;
+        }
+    }
+}
+
 void
 Context::sendKey (unused (const string &key), unused (bool press))
 {
@@ -358,11 +401,44 @@ Context::getLinks ()
 }
 
 void
-Context::addLink (list<Action> conds, list<Action> acts)
+Context::addLink (list<Action> conds, list<Action> acts, const string &id)
 {
   g_assert (conds.size () > 0);
   g_assert (acts.size () > 0);
   _links.push_back (std::make_pair (conds, acts));
+  _linkIds.push_back (id);
+}
+
+/**
+ * @brief Removes link from context.
+ * @param id Link id.
+ * @return \c true if successful, or \c false otherwise (no such link).
+ */
+bool
+Context::removeLink (const string &id)
+{
+  auto it = _links.begin ();
+  auto it_id = _linkIds.begin ();
+  for (; it != _links.end (); ++it, ++it_id)
+    {
+      if (*it_id != id)
+        continue;
+      context_link_delete_predicates (*it);
+      _links.erase (it);
+      _linkIds.erase (it_id);
+      return true;
+    }
+  return false;
+}
+
+/**
+ * @brief Gets the ids of context links.
+ * @return The link ids, in the same order as Context::getLinks().
+ */
+const list<string> *
+Context::getLinkIds ()
+{
+  return &_linkIds;
 }
 
 void
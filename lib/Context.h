@@ -34,6 +34,7 @@ public:
   string toString () override;
   string getProperty (const string &) override;
   void setProperty (const string &, const string &, Time dur = 0) override;
+  void removeReferences (const set<Object *> &) override;
   void sendKey (const string &, bool) override;
   void sendTick (Time, Time, Time) override;
   bool beforeTransition (Event *, Event::Transition) override;
@@ -44,7 +45,9 @@ public:
   void addPort (Event *);
 
   const list<pair<list<Action>, list<Action> > > *getLinks ();
-  void addLink (list<Action>, list<Action>);
+  void addLink (list<Action>, list<Action>, const string &id = "");
+  bool removeLink (const string &);
+  const list<string> *getLinkIds ();
 
   void incAwakeChildren ();
   void decAwakeChildren ();
@@ -55,6 +58,7 @@ public:
 private:
   list<Event *> _ports;                            ///< List of ports.
   list<pair<list<Action>, list<Action> > > _links; ///< List of links.
+  list<string> _linkIds; ///< Ids of links (in the same order).
   int _awakeChildren; ///< Counts awake children.
   bool _status;       ///< Whether links are active.
 };
@@ -19,11 +19,13 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 #include "Document.h"
 
 #include "Context.h"
+#include "Formatter.h"
 #include "Media.h"
 #include "MediaSettings.h"
 #include "Object.h"
 #include "Switch.h"
 #include "PlayerRemote.h"
+#include "WebServices.h"
 
 namespace ginga {
 
@@ -42,6 +44,9 @@ Document::Document ()
 
   _root = new Context ("__root__");
   _settings = nullptr;
+  _transitions = 0;
+  _actions = 0;
+  _linkScans = 0;
   g_assert (this->addObject (_root));
 
   obj = new MediaSettings ("__settings__");
@@ -147,12 +152,17 @@ Document::addObject (Object *obj)
   obj->initDocument (this);
   _objects.insert (obj);
   _objectsById[obj->getId ()] = obj;
+  for (auto evt : *obj->getEvents ())
+    if (evt->getType () == Event::SELECTION)
+      this->indexSelectionEvent (evt);
 
   if (instanceof (Media *, obj))
     {
       Media *media = cast (Media *, obj);
       g_assert_nonnull (media);
       _medias.insert (media);
+      for (auto it : *media->getProperties ())
+        this->indexFocusProperty (media, it.first, it.second);
       if (PlayerRemote::usesPlayerRemote (media))
         {
           _mediasRemote.insert (media);
@@ -177,6 +187,73 @@ Document::addObject (Object *obj)
   return true;
 }
 
+/// Collects \p obj and its descendants into \p result.
+static void
+document_collect_subtree (Object *obj, set<Object *> *result)
+{
+  result->insert (obj);
+  if (instanceof (Composition *, obj))
+    for (auto child : *cast (Composition *, obj)->getChildren ())
+      document_collect_subtree (child, result);
+}
+
+/**
+ * @brief Removes object from document.
+ *
+ * This function removes \p obj and its descendants from the document
+ * indexes, and drops every port, link, rule, alias and delayed action of
+ * the remaining objects that refers to them.  It is called by
+ * Composition::removeChild(), which also detaches \p obj from its parent.
+ * The removed objects are not destroyed.
+ *
+ * @param obj The object to remove.
+ * @return \c true if successful, or \c false otherwise (object not in
+ * document).
+ */
+bool
+Document::removeObject (Object *obj)
+{
+  set<Object *> objs;
+
+  g_assert_nonnull (obj);
+  g_assert (obj != _root && obj != _settings);
+
+  if (_objects.find (obj) == _objects.end ())
+    return false; // not in document
+
+  document_collect_subtree (obj, &objs);
+  for (auto it : objs)
+    {
+      _objects.erase (it);
+      auto id = _objectsById.find (it->getId ());
+      if (id != _objectsById.end () && id->second == it)
+        _objectsById.erase (id);
+      for (auto evt : *it->getEvents ())
+        if (evt->getType () == Event::SELECTION)
+          this->unindexSelectionEvent (evt);
+
+      if (instanceof (Media *, it))
+        {
+          _medias.erase (cast (Media *, it));
+          _mediasRemote.erase (cast (Media *, it));
+          this->unindexFocus (cast (Media *, it));
+        }
+      else if (instanceof (Context *, it))
+        {
+          _contexts.erase (cast (Context *, it));
+        }
+      else if (instanceof (Switch *, it))
+        {
+          _switches.erase (cast (Switch *, it));
+        }
+    }
+
+  for (auto it : _objects)
+    it->removeReferences (objs);
+
+  return true;
+}
+
 /**
  * @brief Gets document's root object.
  * @return The root object.
@@ -223,6 +300,227 @@ Document::getSwitches ()
   return &_switches;
 }
 
+/**
+ * @brief Gets the selection events that listen for a given key.
+ *
+ * Events whose key is empty or an unresolved parameter are indexed under
+ * the empty key; these are triggered by "ENTER" on focused media objects.
+ *
+ * @param key Key name.
+ * @return The set of selection events, or null if there is none.
+ */
+const set<Event *> *
+Document::getSelectionEvents (const string &key)
+{
+  auto it = _selectionEvents.find (key);
+  if (it == _selectionEvents.end ())
+    return nullptr;
+  return &it->second;
+}
+
+/**
+ * @brief Adds selection event to the key index.
+ *
+ * The event is indexed by its "key" parameter or, if it has none, by its
+ * id.  If the event is already indexed, it is moved to its current key.
+ * This is called by Object::addSelectionEvent() and
+ * Event::setParameter().
+ *
+ * @param evt The selection event.
+ */
+void
+Document::indexSelectionEvent (Event *evt)
+{
+  string key;
+
+  g_assert_nonnull (evt);
+  g_assert (evt->getType () == Event::SELECTION);
+
+  if (!evt->getParameter ("key", &key))
+    key = evt->getId ();
+  if (key[0] == '$')
+    key = ""; // parameter could not be resolved
+
+  auto it = _selectionKeys.find (evt);
+  if (it != _selectionKeys.end ())
+    {
+      if (it->second == key)
+        return; // nothing to do
+      this->unindexSelectionEvent (evt);
+    }
+
+  _selectionEvents[key].insert (evt);
+  _selectionKeys[evt] = key;
+}
+
+/**
+ * @brief Removes selection event from the key index.
+ * @param evt The selection event.
+ */
+void
+Document::unindexSelectionEvent (Event *evt)
+{
+  auto it = _selectionKeys.find (evt);
+  if (it == _selectionKeys.end ())
+    return; // not indexed
+
+  auto lst = _selectionEvents.find (it->second);
+  g_assert (lst != _selectionEvents.end ());
+  lst->second.erase (evt);
+  if (lst->second.empty ())
+    _selectionEvents.erase (lst);
+  _selectionKeys.erase (it);
+}
+
+/**
+ * @brief Gets the current focus index.
+ * @return The focus index, or the empty string if nothing is focused.
+ */
+string
+Document::getCurrentFocus ()
+{
+  return _currentFocus;
+}
+
+/**
+ * @brief Sets the current focus index.
+ *
+ * This is called by MediaSettings when its "service.currentFocus"
+ * property changes.
+ *
+ * @param index The focus index.
+ */
+void
+Document::setCurrentFocus (const string &index)
+{
+  _currentFocus = index;
+}
+
+/**
+ * @brief Gets the media objects with a given focus index.
+ * @param index Focus index.
+ * @return The set of media objects, or null if there is none.
+ */
+const set<Media *> *
+Document::getFocusMedias (const string &index)
+{
+  auto it = _focusMedias.find (index);
+  if (it == _focusMedias.end ())
+    return nullptr;
+  return &it->second;
+}
+
+/**
+ * @brief Gets the least focus index of the occurring media objects.
+ * @return The focus index, or the empty string if there is none.
+ */
+string
+Document::getFirstFocusIndex ()
+{
+  for (auto &it : _focusMedias)
+    for (auto media : it.second)
+      if (media->isOccurring ())
+        return it.first;
+  return "";
+}
+
+/**
+ * @brief Gets the focus index reached from media object by a cursor key.
+ * @param media The media object.
+ * @param key Cursor key ("CURSOR_UP", "CURSOR_DOWN", "CURSOR_LEFT" or
+ * "CURSOR_RIGHT").
+ * @param next Variable to store the resulting focus index.
+ * @return True if there is a neighbour in the given direction, or false
+ * otherwise.
+ */
+bool
+Document::getFocusNeighbour (Media *media, const string &key, string *next)
+{
+  const string *result;
+
+  auto it = _focusNodes.find (media);
+  if (it == _focusNodes.end ())
+    return false;
+
+  if (key == "CURSOR_UP")
+    result = &it->second.up;
+  else if (key == "CURSOR_DOWN")
+    result = &it->second.down;
+  else if (key == "CURSOR_LEFT")
+    result = &it->second.left;
+  else if (key == "CURSOR_RIGHT")
+    result = &it->second.right;
+  else
+    return false;
+
+  if (*result == "")
+    return false;
+
+  tryset (next, *result);
+  return true;
+}
+
+/**
+ * @brief Updates the focus graph after a property change.
+ *
+ * Only the "focusIndex", "moveUp", "moveDown", "moveLeft" and "moveRight"
+ * properties affect the graph; other properties are ignored.  This is
+ * called by Media::setProperty() and Document::addObject().
+ *
+ * @param media The media object.
+ * @param name Property name.
+ * @param value Property value.
+ */
+void
+Document::indexFocusProperty (Media *media, const string &name,
+                              const string &value)
+{
+  FocusNode *node;
+
+  g_assert_nonnull (media);
+  if (name == "focusIndex")
+    {
+      auto it = _focusNodes.find (media);
+      if (it != _focusNodes.end () && it->second.index != "")
+        {
+          auto lst = _focusMedias.find (it->second.index);
+          g_assert (lst != _focusMedias.end ());
+          lst->second.erase (media);
+          if (lst->second.empty ())
+            _focusMedias.erase (lst);
+        }
+      node = &_focusNodes[media];
+      node->index = value;
+      if (value != "")
+        _focusMedias[value].insert (media);
+      return;
+    }
+
+  if (name == "moveUp")
+    _focusNodes[media].up = value;
+  else if (name == "moveDown")
+    _focusNodes[media].down = value;
+  else if (name == "moveLeft")
+    _focusNodes[media].left = value;
+  else if (name == "moveRight")
+    _focusNodes[media].right = value;
+}
+
+/**
+ * @brief Removes media object from the focus graph.
+ * @param media The media object.
+ */
+void
+Document::unindexFocus (Media *media)
+{
+  auto it = _focusNodes.find (media);
+  if (it == _focusNodes.end ())
+    return; // not indexed
+
+  this->indexFocusProperty (media, "focusIndex", "");
+  _focusNodes.erase (it);
+}
+
 /**
  * @brief Evaluates action over document.
  */
@@ -253,6 +551,7 @@ Document::evalActionInContext (Action act, Context *ctx)
 
   if (!ctx->getLinksStatus ())
     return stack;
+  _linkScans += ctx->getLinks ()->size ();
   for (auto link : *ctx->getLinks ())
     {
       for (auto cond : link.first)
@@ -301,6 +600,48 @@ Document::evalActionInContext (Action act, Context *ctx)
   return stack;
 }
 
+/**
+ * @brief Gets the number of event transitions performed so far.
+ *
+ * The count is incremented by Document::evalAction() for each successful
+ * transition.
+ *
+ * @return The transition count.
+ */
+guint64
+Document::getTransitionCount ()
+{
+  return _transitions;
+}
+
+/**
+ * @brief Gets the number of actions evaluated so far.
+ *
+ * Counts every action popped by Document::evalAction(), including those
+ * whose transition did not take place.
+ *
+ * @return The action count.
+ */
+guint64
+Document::getActionCount ()
+{
+  return _actions;
+}
+
+/**
+ * @brief Gets the number of links scanned so far.
+ *
+ * Counts the links tested by Document::evalAction() against each
+ * transition, in every context it propagated to.
+ *
+ * @return The link scan count.
+ */
+guint64
+Document::getLinkScanCount ()
+{
+  return _linkScans;
+}
+
 /**
  * @brief Evaluates action over document.
  */
@@ -323,6 +664,7 @@ Document::evalAction (Action init)
 
       act = stack.back ();
       stack.pop_back ();
+      _actions++;
 
       evt = act.event;
       g_assert_nonnull (evt);
@@ -339,8 +681,14 @@ Document::evalAction (Action init)
         continue;
 
       n++;
+      _transitions++;
       obj = evt->getObject ();
       g_assert_nonnull (obj);
+
+      // Push transition to the event channel.
+      Formatter *fmt;
+      if (this->getData ("formatter", (void **) &fmt))
+        fmt->getWebServices ()->notifyEvent (evt, act.transition);
       comp = obj->getParent ();
 
       // If parent composition is a context
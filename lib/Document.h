@@ -42,6 +42,7 @@ public:
   Object *getObjectById (const string &);
   Object *getObjectByIdOrAlias (const string &);
   bool addObject (Object *);
+  bool removeObject (Object *);
 
   const string getId ();
   Context *getRoot ();
@@ -51,8 +52,23 @@ public:
   const set<Context *> *getContexts ();
   const set<Switch *> *getSwitches ();
 
+  const set<Event *> *getSelectionEvents (const string &);
+  void indexSelectionEvent (Event *);
+  void unindexSelectionEvent (Event *);
+
+  string getCurrentFocus ();
+  void setCurrentFocus (const string &);
+  const set<Media *> *getFocusMedias (const string &);
+  string getFirstFocusIndex ();
+  bool getFocusNeighbour (Media *, const string &, string *);
+  void indexFocusProperty (Media *, const string &, const string &);
+  void unindexFocus (Media *);
+
   int evalAction (Event *, Event::Transition, const string &value = "");
   int evalAction (Action);
+  guint64 getTransitionCount ();
+  guint64 getActionCount ();
+  guint64 getLinkScanCount ();
   bool evalPredicate (Predicate *);
   bool evalPropertyRef (const string &, string *);
 
@@ -70,6 +86,24 @@ private:
   set<Media *> _mediasRemote;         ///< Media objects.
   set<Context *> _contexts;           ///< Context objects.
   set<Switch *> _switches;            ///< Switch objects.
+  guint64 _transitions;               ///< Number of event transitions.
+  guint64 _actions;                   ///< Number of evaluated actions.
+  guint64 _linkScans;                 ///< Number of links scanned.
+  map<string, set<Event *>> _selectionEvents; ///< Selection events by key.
+  map<Event *, string> _selectionKeys; ///< Indexed key of selection event.
+
+  /// Focus information of a media object.
+  struct FocusNode
+  {
+    string index;                 ///< Focus index.
+    string up;                    ///< Focus index reached by CURSOR_UP.
+    string down;                  ///< Focus index reached by CURSOR_DOWN.
+    string left;                  ///< Focus index reached by CURSOR_LEFT.
+    string right;                 ///< Focus index reached by CURSOR_RIGHT.
+  };
+  string _currentFocus;                   ///< Current focus index.
+  map<string, set<Media *>> _focusMedias; ///< Media objects by focus index.
+  map<Media *, FocusNode> _focusNodes;    ///< Focus graph.
   UserData _udata;                    ///< Attached user data.
 };
 
@@ -17,6 +17,8 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include "aux-ginga.h"
 #include "Event.h"
+
+#include "Document.h"
 #include "Object.h"
 
 namespace ginga {
@@ -173,7 +175,26 @@ Event::getParameter (const string &name, string *value)
 bool
 Event::setParameter (const string &name, const string &value)
 {
-  MAP_SET_IMPL (_parameters, name, value);
+  Document *doc;
+  bool result;
+
+  result = _parameters.find (name) == _parameters.end ();
+  _parameters[name] = value;
+
+  // Keep the document's key index up to date.
+  if (_type == Event::SELECTION && name == "key"
+      && (doc = _object->getDocument ()) != nullptr)
+    {
+      doc->indexSelectionEvent (this);
+    }
+
+  return result;
+}
+
+const map<string, string> *
+Event::getParameters ()
+{
+  return &_parameters;
 }
 
 /**
@@ -236,6 +257,21 @@ Event::reset ()
   _state = Event::SLEEPING;
 }
 
+/**
+ * @brief Forces event state.
+ *
+ * Unlike Event::transition(), this does not notify the target object.  It
+ * is used by Formatter::restoreState() to reinstate a saved presentation
+ * state without replaying the transitions that led to it.
+ *
+ * @param state The new state.
+ */
+void
+Event::setState (Event::State state)
+{
+  _state = state;
+}
+
 // Public: Static.
 
 string
@@ -104,9 +104,11 @@ public:
 
   bool getParameter (const string &, string *);
   bool setParameter (const string &, const string &);
+  const map<string, string> *getParameters ();
 
   bool transition (Event::Transition);
   void reset ();
+  void setState (Event::State);
 
 public:
   static string getEventTypeAsString (Event::Type);
@@ -25,10 +25,16 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 #include "Object.h"
 #include "Switch.h"
 
+#include "LuaCache.h"
 #include "Parser.h"
+#include "ParserBinary.h"
+#include "Player.h"
 #include "PlayerText.h"
 #include "WebServices.h"
 
+#include <json/json.h>
+#include <libxml/parser.h>
+
 /**
  * @file Formatter.cpp
  * @brief The Formatter class.
@@ -58,20 +64,23 @@ typedef struct GingaOptionData
   }
 
 // Option table.
-static map<string, GingaOptionData> opts_table = {
+static const map<string, GingaOptionData> opts_table = {
   OPTS_ENTRY (background, G_TYPE_STRING, Background),
   OPTS_ENTRY (debug, G_TYPE_BOOLEAN, Debug),
   OPTS_ENTRY (experimental, G_TYPE_BOOLEAN, Experimental),
   OPTS_ENTRY (height, G_TYPE_INT, Size),
+  OPTS_ENTRY (memoryBudget, G_TYPE_INT, MemoryBudget),
   OPTS_ENTRY (opengl, G_TYPE_BOOLEAN, OpenGL),
+  OPTS_ENTRY (prewarm, G_TYPE_BOOLEAN, Prewarm),
+  OPTS_ENTRY (sharedClock, G_TYPE_BOOLEAN, SharedClock),
   OPTS_ENTRY (width, G_TYPE_INT, Size),
 };
 
 // Indexes option table.
 static bool
-opts_table_index (const string &key, GingaOptionData **result)
+opts_table_index (const string &key, const GingaOptionData **result)
 {
-  map<string, GingaOptionData>::iterator it;
+  map<string, GingaOptionData>::const_iterator it;
   if ((it = opts_table.find (key)) == opts_table.end ())
     return false;
   tryset (result, &it->second);
@@ -102,6 +111,261 @@ zcmp (Media *a, Media *b)
   return 0;
 }
 
+// Initializes GStreamer; called once per process.
+static void
+formatter_init_gstreamer ()
+{
+  GError *err = nullptr;
+
+  if (gst_is_initialized ())
+    return;
+
+  if (unlikely (!gst_init_check (nullptr, nullptr, &err)))
+    {
+      g_assert_nonnull (err);
+      ERROR ("%s", err->message);
+      g_error_free (err);
+    }
+}
+
+// Upper bounds of the redraw time histogram buckets (in milliseconds);
+// 16 and 33 are one frame at 60 and 30 fps.
+static const Time formatter_redraw_bounds_ms[FORMATTER_REDRAW_BUCKETS]
+    = { 1, 2, 4, 8, 16, 33, 50, 100 };
+
+// Version of the format written by Formatter::saveState().
+#define FORMATTER_STATE_VERSION 1
+
+// Maximum interval between memory budget checks (in microseconds).
+#define FORMATTER_MEMORY_CHECK_INTERVAL G_USEC_PER_SEC
+
+// Converts time to JSON; GINGA_TIME_NONE becomes null.
+static Json::Value
+state_time_to_json (Time time)
+{
+  if (!GINGA_TIME_IS_VALID (time))
+    return Json::Value (Json::nullValue);
+  return Json::Value ((Json::UInt64) time);
+}
+
+// Converts JSON to time; anything but an unsigned integer becomes
+// GINGA_TIME_NONE.
+static Time
+state_json_to_time (const Json::Value &value)
+{
+  if (!value.isUInt64 ())
+    return GINGA_TIME_NONE;
+  return (Time) value.asUInt64 ();
+}
+
+// Converts event to JSON.
+static Json::Value
+state_event_to_json (Event *evt)
+{
+  Json::Value value;
+  value["type"] = (int) evt->getType ();
+  value["id"] = evt->getId ();
+  return value;
+}
+
+// Gets the event of object \p obj described by \p value.
+static Event *
+state_json_to_event (Object *obj, const Json::Value &value)
+{
+  Event::Type type;
+  string id;
+  Event *evt;
+
+  if (unlikely (!value["type"].isInt () || !value["id"].isString ()))
+    return nullptr;
+
+  type = (Event::Type) value["type"].asInt ();
+  if (unlikely (type < Event::ATTRIBUTION || type > Event::LOOKAT))
+    return nullptr;
+  id = value["id"].asString ();
+  evt = obj->getEvent (type, id);
+  if (evt == nullptr && type == Event::ATTRIBUTION)
+    {
+      obj->addAttributionEvent (id);
+      evt = obj->getEvent (type, id);
+    }
+  return evt;
+}
+
+// Checks whether \p value is null or an array of objects.
+static bool
+state_json_is_list (const Json::Value &value)
+{
+  if (value.isNull ())
+    return true;
+  if (!value.isArray ())
+    return false;
+  for (const auto &item : value)
+    if (!item.isObject ())
+      return false;
+  return true;
+}
+
+// Checks the types of the members of the saved object \p o, so that
+// state_restore() can read them without Json::Value throwing.
+static bool
+state_json_is_object (const Json::Value &o)
+{
+  if (!o.isObject () || !o["id"].isString ())
+    return false;
+
+  const Json::Value &props = o["properties"];
+  if (!props.isNull () && !props.isObject ())
+    return false;
+  for (const auto &name : props.getMemberNames ())
+    if (!props[name].isString ())
+      return false;
+
+  if (!state_json_is_list (o["events"]) || !state_json_is_list (o["delayed"]))
+    return false;
+  for (const auto &e : o["events"])
+    if (!e["state"].isInt ())
+      return false;
+  for (const auto &a : o["delayed"])
+    if (!a["object"].isString () || !a["transition"].isInt ()
+        || !(a["value"].isNull () || a["value"].isString ()))
+      return false;
+
+  const Json::Value &player = o["player"];
+  if (!player.isNull ()
+      && !(player.isObject ()
+           && (player["paused"].isNull () || player["paused"].isBool ())))
+    return false;
+
+  return true;
+}
+
+// Installs the saved state \p root into the freshly loaded document \p doc.
+static bool
+state_restore (Document *doc, const Json::Value &root, string *errmsg)
+{
+  const Json::Value &objs = root["objects"];
+
+  if (unlikely (!objs.isArray ()))
+    {
+      tryset (errmsg, "Bad state: missing objects");
+      return false;
+    }
+  for (const auto &o : objs)
+    {
+      if (unlikely (!state_json_is_object (o)))
+        {
+          tryset (errmsg, "Bad state: malformed object");
+          return false;
+        }
+    }
+
+  // Restore properties, events and object times.
+  for (const auto &o : objs)
+    {
+      Object *obj;
+      string id;
+
+      id = o["id"].asString ();
+      obj = doc->getObjectById (id);
+      if (unlikely (obj == nullptr))
+        {
+          tryset (errmsg, "Bad state: no such object '" + id + "'");
+          return false;
+        }
+
+      const Json::Value &props = o["properties"];
+      for (const auto &name : props.getMemberNames ())
+        obj->setProperty (name, props[name].asString ());
+
+      for (const auto &e : o["events"])
+        {
+          Event *evt;
+          int state;
+
+          evt = state_json_to_event (obj, e);
+          state = e["state"].asInt ();
+          if (unlikely (evt == nullptr || state < Event::OCCURRING
+                        || state > Event::SLEEPING))
+            {
+              tryset (errmsg, "Bad state: bad event in '" + id + "'");
+              return false;
+            }
+          evt->setInterval (state_json_to_time (e["begin"]),
+                            state_json_to_time (e["end"]));
+          evt->setState ((Event::State) state);
+        }
+      obj->setTime (state_json_to_time (o["time"]));
+
+      if (instanceof (Context *, obj) && o["linksStatus"].isBool ())
+        cast (Context *, obj)->setLinksStatus (o["linksStatus"].asBool ());
+      else if (instanceof (Switch *, obj) && o["selected"].isString ())
+        cast (Switch *, obj)
+            ->setSelected (doc->getObjectById (o["selected"].asString ()));
+    }
+
+  // Restore delayed actions, awake counts and players.  This is done in a
+  // second pass so that every event and property is already in place.
+  for (const auto &o : objs)
+    {
+      Object *obj;
+      Composition *parent;
+
+      obj = doc->getObjectById (o["id"].asString ());
+      g_assert_nonnull (obj);
+
+      for (const auto &a : o["delayed"])
+        {
+          Object *target;
+          Event *evt;
+          Time time;
+          int trans;
+
+          target = doc->getObjectById (a["object"].asString ());
+          evt = (target != nullptr) ? state_json_to_event (target, a)
+                                    : nullptr;
+          time = state_json_to_time (a["time"]);
+          trans = a["transition"].asInt ();
+          if (unlikely (evt == nullptr || !GINGA_TIME_IS_VALID (time)
+                        || !GINGA_TIME_IS_VALID (obj->getTime ())
+                        || trans < Event::ABORT || trans > Event::STOP))
+            {
+              tryset (errmsg, "Bad state: bad delayed action in '"
+                                  + obj->getId () + "'");
+              return false;
+            }
+          obj->addDelayedAction (
+              evt, (Event::Transition) trans, a["value"].asString (),
+              (time > obj->getTime ()) ? time - obj->getTime () : 0);
+        }
+
+      if (obj->isSleeping ())
+        continue;
+
+      parent = obj->getParent ();
+      if (parent != nullptr && instanceof (Context *, parent))
+        cast (Context *, parent)->incAwakeChildren ();
+
+      if (instanceof (Media *, obj))
+        {
+          const Json::Value &player = o["player"];
+          if (unlikely (!cast (Media *, obj)->restorePlayer (
+                  state_json_to_time (player["time"]),
+                  player["paused"].asBool ())))
+            {
+              tryset (errmsg, "Cannot restore player of '" + obj->getId ()
+                                  + "'");
+              return false;
+            }
+        }
+    }
+
+  if (root["nextFocus"].isString ())
+    doc->getSettings ()->scheduleFocusUpdate (root["nextFocus"].asString ());
+
+  return true;
+}
+
 // Public: External API.
 
 GingaState
@@ -113,51 +377,18 @@ Formatter::getState ()
 bool
 Formatter::start (const string &file, string *errmsg)
 {
-  int w, h;
   Event *evt;
 
   // This must be the first check.
   if (_state != GINGA_STATE_STOPPED)
     return false;
 
-  // Parse document.
-  g_assert_null (_doc);
-  w = _opts.width;
-  h = _opts.height;
-  _doc = nullptr;
-
-#if defined WITH_LUA && WITH_LUA
-  if (xstrhassuffix (file, ".lua"))
-    {
-      _doc = ParserLua::parseFile (file, errmsg);
-      if (unlikely (_doc == nullptr))
-        return false;
-    }
-#endif
-
-  if (_doc == nullptr)
-    _doc = Parser::parseFile (file, w, h, errmsg);
-  if (unlikely (_doc == nullptr))
+  if (unlikely (!this->load (file, errmsg)))
     return false;
 
-  g_assert_nonnull (_doc);
-  _doc->setData ("formatter", (void *) this);
-
-  Context *root = _doc->getRoot ();
-  g_assert_nonnull (root);
-  MediaSettings *settings = _doc->getSettings ();
-  g_assert_nonnull (settings);
-
-  // Initialize formatter variables.
-  _docPath = file;
-  _eos = false;
-  _lastTickTotal = 0;
-  _lastTickDiff = 0;
-  _lastTickFrameNo = 0;
-
   // Run document.
   TRACE ("%s", file.c_str ());
-  evt = root->getLambda ();
+  evt = _doc->getRoot ()->getLambda ();
   g_assert_nonnull (evt);
   if (_doc->evalAction (evt, Event::START) == 0)
     return false;
@@ -187,6 +418,9 @@ Formatter::stop ()
   delete _doc;
   _doc = nullptr;
 
+  // Deliver the final actions of remote players.
+  _webservices->flushRemotePlayerActions ();
+
   _state = GINGA_STATE_STOPPED;
   return true;
 }
@@ -202,23 +436,9 @@ Formatter::resize (int width, int height)
   if (_state != GINGA_STATE_PLAYING)
     return;
 
-  // Resize each media object in document.
+  // Recompute the geometry of each media object in document.
   for (auto media : *_doc->getMedias ())
-    {
-#define UPDATE_IF_HAVE(PROP)                                               \
-  {                                                                        \
-    string s = media->getProperty (PROP);                                  \
-    if (s != "")                                                           \
-      media->setProperty (PROP, s);                                        \
-  }
-
-      UPDATE_IF_HAVE ("top");
-      UPDATE_IF_HAVE ("left");
-      UPDATE_IF_HAVE ("width");
-      UPDATE_IF_HAVE ("height");
-      UPDATE_IF_HAVE ("bottom");
-      UPDATE_IF_HAVE ("right");
-    }
+    media->updateGeometry ();
 }
 
 void
@@ -226,11 +446,15 @@ Formatter::redraw (cairo_t *cr)
 {
   GList *zlist;
   GList *l;
+  gint64 t0;
 
   // This must be the first check.
   if (_state != GINGA_STATE_PLAYING)
     return;
 
+  t0 = g_get_monotonic_time ();
+  _redrawSerial++;
+
   if (_opts.opengl)
     {
       GL::beginDraw ();
@@ -265,9 +489,11 @@ Formatter::redraw (cairo_t *cr)
         }
     }
 
+  // Only medias with something to draw enter the z-sorted list.
   zlist = nullptr;
   for (auto &media : *_doc->getMedias ())
-    zlist = g_list_insert_sorted (zlist, media, (GCompareFunc) zcmp);
+    if (media->isDrawable ())
+      zlist = g_list_insert_sorted (zlist, media, (GCompareFunc) zcmp);
 
   l = zlist;
   while (l != NULL)
@@ -279,11 +505,22 @@ Formatter::redraw (cairo_t *cr)
     }
   g_assert_null (zlist);
 
+  // Players are only queried when some backing store was reloaded or,
+  // to catch the ones that update theirs on every frame, once in a while.
+  if (_opts.memoryBudget > 0
+      && (_memoryDirty
+          || t0 - _memoryChecked >= FORMATTER_MEMORY_CHECK_INTERVAL))
+    {
+      this->enforceMemoryBudget ();
+      _memoryDirty = false;
+      _memoryChecked = t0;
+    }
+
   if (_opts.debug)
     {
-      static Color fg = { 1., 1., 1., 1. };
-      static Color bg = { 0, 0, 0, 0 };
-      static Rect rect = { 0, 0, 0, 0 };
+      Color fg = { 1., 1., 1., 1. };
+      Color bg = { 0, 0, 0, 0 };
+      Rect rect = { 0, 0, 0, 0 };
       string info;
       cairo_surface_t *debug;
       Rect ink;
@@ -291,6 +528,16 @@ Formatter::redraw (cairo_t *cr)
                         _docPath.c_str (), _lastTickFrameNo,
                         GINGA_TIME_ARGS (_lastTickTotal),
                         1 * GINGA_SECOND / (double) _lastTickDiff);
+      if (_inputSamples > 0)
+        {
+          GingaStats stats;
+          this->getStats (&stats);
+          info += xstrbuild (
+              " key:%.1f/%.1f/%.1fms",
+              (double) stats.inputLatencyP50 / GINGA_MSECOND,
+              (double) stats.inputLatencyP90 / GINGA_MSECOND,
+              (double) stats.inputLatencyP99 / GINGA_MSECOND);
+        }
       rect.width = _opts.width;
       rect.height = _opts.height;
       debug = PlayerText::renderSurface (info, "monospace", "", "bold", "9",
@@ -306,6 +553,11 @@ Formatter::redraw (cairo_t *cr)
       cairo_restore (cr);
       cairo_surface_destroy (debug);
     }
+
+  this->redrawDone ((Time) (g_get_monotonic_time () - t0) * GINGA_USECOND);
+
+  if (GINGA_TIME_IS_VALID (_inputApplied))
+    this->inputPresented ();
 }
 
 // Stops formatter if EOS has been seen.
@@ -332,7 +584,10 @@ Formatter::redraw (cairo_t *cr)
 bool
 Formatter::sendKey (const string &key, bool press)
 {
-  list<Object *> buf;
+  list<Media *> focused;
+  list<Event *> buf;
+  const set<Media *> *medias;
+  const set<Event *> *evts;
 
   // This must be the first check.
   if (_state != GINGA_STATE_PLAYING)
@@ -343,15 +598,47 @@ Formatter::sendKey (const string &key, bool press)
 
   // IMPORTANT: When propagating a key to the objects, we cannot traverse
   // the object set directly, as the reception of a key may cause this set
-  // to be modified.  We thus need to create a buffer with the objects that
-  // should receive the key, i.e., those that are not sleeping, and then
-  // propagate the key only to the objects in this buffer.
-  for (auto obj : *_doc->getObjects ())
-    if (!obj->isSleeping ())
-      buf.push_back (obj);
-  for (auto obj : buf)
-    obj->sendKey (key, press);
-
+  // to be modified.  We thus need to create a buffer with the objects (and
+  // events) that should receive the key, and then propagate the key only
+  // to the objects (and events) in this buffer.
+  //
+  // Only focused media objects receive the key itself, for navigation and
+  // for their players.  Selection events are looked up in the document's
+  // key index: those listening for the key, plus those with no key if the
+  // key is "ENTER" and their media object is focused.
+  if ((medias = _doc->getFocusMedias (_doc->getCurrentFocus ()))
+      != nullptr)
+    for (auto media : *medias)
+      if (media->isSelectable (true))
+        focused.push_back (media);
+
+  if ((evts = _doc->getSelectionEvents (key)) != nullptr)
+    for (auto evt : *evts)
+      {
+        Media *media = cast (Media *, evt->getObject ());
+        if (media != nullptr && media->isSelectable (false))
+          buf.push_back (evt);
+      }
+
+  if (key == "ENTER" && (evts = _doc->getSelectionEvents ("")) != nullptr)
+    for (auto evt : *evts)
+      {
+        Media *media = cast (Media *, evt->getObject ());
+        if (media != nullptr && media->isSelectable (true))
+          buf.push_back (evt);
+      }
+
+  // Players changed while the key press is dispatched pick its stamp up
+  // (see Player::stampInput()), and hand it back when they redraw.
+  if (press)
+    _inputStamp = g_get_monotonic_time () * GINGA_USECOND;
+
+  for (auto media : focused)
+    media->sendKey (key, press);
+  for (auto evt : buf)
+    _doc->evalAction (evt, press ? Event::START : Event::STOP);
+
+  _inputStamp = GINGA_TIME_NONE;
   return true;
 }
 
@@ -359,6 +646,7 @@ bool
 Formatter::sendTick (uint64_t total, uint64_t diff, uint64_t frame)
 {
   list<Object *> buf;
+  gint64 t0;
 
   // This must be the first check.
   if (_state != GINGA_STATE_PLAYING)
@@ -370,6 +658,7 @@ Formatter::sendTick (uint64_t total, uint64_t diff, uint64_t frame)
   _lastTickTotal = total;
   _lastTickDiff = diff;
   _lastTickFrameNo = frame;
+  t0 = g_get_monotonic_time ();
 
   // IMPORTANT: The same warning about propagation that appear in
   // Formatter::sendKeyEvent() applies here.  The difference is that ticks
@@ -380,6 +669,267 @@ Formatter::sendTick (uint64_t total, uint64_t diff, uint64_t frame)
   for (auto obj : buf)
     obj->sendTick (total, diff, frame);
 
+  // Send the remote player actions of this tick in a batch.
+  _webservices->flushRemotePlayerActions ();
+
+  _metrics.tickCount++;
+  _metrics.tickSum += (Time) (g_get_monotonic_time () - t0) * GINGA_USECOND;
+
+  return true;
+}
+
+/**
+ * @brief Applies NCL editing command to the running document.
+ *
+ * The command is a line of the form "NAME ARG... LAST", where the
+ * arguments are separated by blanks and the last one extends to the end
+ * of the line.  The supported commands are:
+ *
+ * - addNode CONTEXT XML
+ * - removeNode COMPOSITION NODE
+ * - addLink CONTEXT XML
+ * - removeLink CONTEXT LINK
+ * - setPropertyValue NODE NAME VALUE
+ *
+ * See Formatter::addNode() and friends.
+ *
+ * @param cmd Editing command.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+Formatter::sendEditingCommand (const string &cmd, string *errmsg)
+{
+  static const map<string, int> nargs = {
+    { "addNode", 2 },    { "removeNode", 2 },       { "addLink", 2 },
+    { "removeLink", 2 }, { "setPropertyValue", 3 },
+  };
+  vector<string> args;
+  string name;
+  string rest;
+  size_t i;
+
+  rest = xstrstrip (cmd);
+  i = rest.find_first_of (" \t");
+  name = rest.substr (0, i);
+  rest = (i == string::npos) ? "" : xstrstrip (rest.substr (i));
+
+  auto it = nargs.find (name);
+  if (unlikely (it == nargs.end ()))
+    {
+      tryset (errmsg, "Unknown editing command '" + name + "'");
+      return false;
+    }
+
+  for (int n = 1; n < it->second && rest != ""; n++)
+    {
+      i = rest.find_first_of (" \t");
+      args.push_back (rest.substr (0, i));
+      rest = (i == string::npos) ? "" : xstrstrip (rest.substr (i));
+    }
+  if (unlikely ((int) args.size () != it->second - 1 || rest == ""))
+    {
+      tryset (errmsg, xstrbuild ("Editing command '%s' expects %d arguments",
+                                 name.c_str (), it->second));
+      return false;
+    }
+  args.push_back (rest);
+
+  TRACE ("%s", cmd.c_str ());
+  if (name == "addNode")
+    return this->addNode (args[0], args[1], errmsg);
+  if (name == "removeNode")
+    return this->removeNode (args[0], args[1], errmsg);
+  if (name == "addLink")
+    return this->addLink (args[0], args[1], errmsg);
+  if (name == "removeLink")
+    return this->removeLink (args[0], args[1], errmsg);
+  if (name == "setPropertyValue")
+    return this->setPropertyValue (args[0], args[1], args[2], errmsg);
+  g_assert_not_reached ();
+}
+
+void
+Formatter::getStats (GingaStats *stats)
+{
+  vector<Time> sorted;
+  size_t n;
+
+  g_assert_nonnull (stats);
+  stats->inputSamples = _inputSamples;
+  stats->inputLatencyP50 = 0;
+  stats->inputLatencyP90 = 0;
+  stats->inputLatencyP99 = 0;
+  stats->inputLatencyMax = 0;
+
+  n = _inputLatencies.size ();
+  if (n == 0)
+    return;
+
+  // Nearest-rank percentiles over the latest samples.
+  sorted = _inputLatencies;
+  std::sort (sorted.begin (), sorted.end ());
+  stats->inputLatencyP50 = sorted[(n * 50 + 99) / 100 - 1];
+  stats->inputLatencyP90 = sorted[(n * 90 + 99) / 100 - 1];
+  stats->inputLatencyP99 = sorted[(n * 99 + 99) / 100 - 1];
+  stats->inputLatencyMax = sorted[n - 1];
+}
+
+bool
+Formatter::saveState (string *state, string *errmsg)
+{
+  Json::Value root;
+  Json::StreamWriterBuilder builder;
+  string next;
+
+  // This must be the first check.
+  if (_state != GINGA_STATE_PLAYING)
+    {
+      tryset (errmsg, "Formatter is not playing");
+      return false;
+    }
+
+  root["version"] = FORMATTER_STATE_VERSION;
+  root["document"] = _docPath;
+  root["eos"] = _eos;
+  root["tick"]["total"] = (Json::UInt64) _lastTickTotal;
+  root["tick"]["diff"] = (Json::UInt64) _lastTickDiff;
+  root["tick"]["frame"] = (Json::UInt64) _lastTickFrameNo;
+  if (_doc->getSettings ()->getScheduledFocusUpdate (&next))
+    root["nextFocus"] = next;
+
+  root["objects"] = Json::Value (Json::arrayValue);
+  for (auto obj : *_doc->getObjects ())
+    {
+      Json::Value o;
+      Time time;
+      bool paused;
+
+      o["id"] = obj->getId ();
+      o["time"] = state_time_to_json (obj->getTime ());
+
+      o["properties"] = Json::Value (Json::objectValue);
+      for (auto it : *obj->getProperties ())
+        o["properties"][it.first] = it.second;
+
+      o["events"] = Json::Value (Json::arrayValue);
+      for (auto evt : *obj->getEvents ())
+        {
+          Json::Value e;
+          Time begin, end;
+
+          e = state_event_to_json (evt);
+          e["state"] = (int) evt->getState ();
+          evt->getInterval (&begin, &end);
+          e["begin"] = state_time_to_json (begin);
+          e["end"] = state_time_to_json (end);
+          o["events"].append (e);
+        }
+
+      o["delayed"] = Json::Value (Json::arrayValue);
+      for (auto it : *obj->getDelayedActions ())
+        {
+          Json::Value a;
+
+          if (!GINGA_TIME_IS_VALID (it.second))
+            continue; // already fired
+
+          a = state_event_to_json (it.first.event);
+          a["object"] = it.first.event->getObject ()->getId ();
+          a["transition"] = (int) it.first.transition;
+          a["value"] = it.first.value;
+          a["time"] = state_time_to_json (it.second);
+          o["delayed"].append (a);
+        }
+
+      if (instanceof (Context *, obj))
+        {
+          o["linksStatus"] = cast (Context *, obj)->getLinksStatus ();
+        }
+      else if (instanceof (Switch *, obj))
+        {
+          Object *sel = cast (Switch *, obj)->getSelected ();
+          if (sel != nullptr)
+            o["selected"] = sel->getId ();
+        }
+      else if (instanceof (Media *, obj)
+               && cast (Media *, obj)->getPlayerTime (&time, &paused))
+        {
+          o["player"]["time"] = state_time_to_json (time);
+          o["player"]["paused"] = paused;
+        }
+
+      root["objects"].append (o);
+    }
+
+  builder["indentation"] = "";
+  tryset (state, Json::writeString (builder, root));
+  return true;
+}
+
+bool
+Formatter::restoreState (const string &state, string *errmsg)
+{
+  Json::Value root;
+  Json::CharReaderBuilder builder;
+  Json::CharReader *reader;
+  string errors;
+  bool status;
+
+  reader = builder.newCharReader ();
+  status = reader->parse (state.data (), state.data () + state.length (),
+                          &root, &errors);
+  delete reader;
+  if (unlikely (!status || !root.isObject ()))
+    {
+      tryset (errmsg, "Bad state: " + errors);
+      return false;
+    }
+  if (unlikely (!root["version"].isInt ()
+                || root["version"].asInt () != FORMATTER_STATE_VERSION))
+    {
+      tryset (errmsg, "Unsupported state version");
+      return false;
+    }
+
+  const Json::Value &tick = root["tick"];
+  if (unlikely (!root["document"].isString () || !root["eos"].isBool ()
+                || !tick.isObject () || !tick["total"].isUInt64 ()
+                || !tick["diff"].isUInt64 () || !tick["frame"].isUInt64 ()))
+    {
+      tryset (errmsg, "Bad state: malformed document or tick");
+      return false;
+    }
+
+  if (_state != GINGA_STATE_STOPPED)
+    this->stop ();
+
+  if (unlikely (!this->load (root["document"].asString (), errmsg)))
+    return false;
+
+  if (unlikely (!state_restore (_doc, root, errmsg)))
+    {
+      // Put objects back to sleep so that they can be safely destroyed.
+      for (auto obj : *_doc->getObjects ())
+        for (auto evt : *obj->getEvents ())
+          evt->reset ();
+      delete _doc;
+      _doc = nullptr;
+      return false;
+    }
+
+  _lastTickTotal = tick["total"].asUInt64 ();
+  _lastTickDiff = tick["diff"].asUInt64 ();
+  _lastTickFrameNo = tick["frame"].asUInt64 ();
+  _eos = root["eos"].asBool ();
+
+  // Sets formatter state.
+  _state = GINGA_STATE_PLAYING;
+
+  // start webservices
+  if (_opts.webservices)
+    _webservices->start ();
+
   return true;
 }
 
@@ -396,7 +946,7 @@ Formatter::getOptions ()
 #define OPT_GETSET_DEFN(Name, Type, GType)                                 \
   Type Formatter::getOption##Name (const string &name)                     \
   {                                                                        \
-    GingaOptionData *opt;                                                  \
+    const GingaOptionData *opt;                                            \
     if (unlikely (!opts_table_index (name, &opt)))                         \
       OPT_ERR_UNKNOWN (name.c_str ());                                     \
     if (unlikely (opt->type != (GType)))                                   \
@@ -405,7 +955,7 @@ Formatter::getOptions ()
   }                                                                        \
   void Formatter::setOption##Name (const string &name, Type value)         \
   {                                                                        \
-    GingaOptionData *opt;                                                  \
+    const GingaOptionData *opt;                                            \
     if (unlikely (!opts_table_index (name, &opt)))                         \
       OPT_ERR_UNKNOWN (name.c_str ());                                     \
     if (unlikely (opt->type != (GType)))                                   \
@@ -431,8 +981,18 @@ OPT_GETSET_DEFN (String, string, G_TYPE_STRING)
  */
 Formatter::Formatter (const GingaOptions *opts) : Ginga (opts)
 {
+  static gsize init = 0;
   const char *s;
 
+  // Process-wide initialization (GStreamer and libxml2) shared by all
+  // formatters, which may be created on different threads.
+  if (g_once_init_enter (&init))
+    {
+      formatter_init_gstreamer ();
+      xmlInitParser ();
+      g_once_init_leave (&init, 1);
+    }
+
   _state = GINGA_STATE_STOPPED;
   if (opts)
     _opts = *opts;
@@ -445,6 +1005,9 @@ Formatter::Formatter (const GingaOptions *opts) : Ginga (opts)
       _opts.webservices = false;
       _opts.opengl = false;
       _opts.experimental = false;
+      _opts.prewarm = false;
+      _opts.memoryBudget = 0;
+      _opts.sharedClock = false;
     };
   _background = { 0., 0., 0., 0. };
 
@@ -458,12 +1021,35 @@ Formatter::Formatter (const GingaOptions *opts) : Ginga (opts)
   _webservices = new WebServices (this);
   _docPath = "";
   _eos = false;
+  _inputStamp = GINGA_TIME_NONE;
+  _inputApplied = GINGA_TIME_NONE;
+  _inputSamples = 0;
+  _redrawSerial = 0;
+  _memoryDirty = true;
+  _memoryChecked = 0;
+
+  for (size_t i = 0; i < FORMATTER_REDRAW_BUCKETS; i++)
+    {
+      _metrics.redrawBounds[i] = formatter_redraw_bounds_ms[i] * GINGA_MSECOND;
+      _metrics.redrawBuckets[i] = 0;
+    }
+  _metrics.redrawCount = 0;
+  _metrics.redrawSum = 0;
+  _metrics.tickCount = 0;
+  _metrics.tickSum = 0;
+  _metrics.evictions = 0;
+  _metrics.evictedBytes = 0;
+  _metrics.droppedFrames = 0;
+  _metrics.luaCycleSum = 0;
 
   // Initialize options.
   setOptionBackground (this, "background", _opts.background);
   setOptionDebug (this, "debug", _opts.debug);
   setOptionExperimental (this, "experimental", _opts.experimental);
   setOptionOpenGL (this, "opengl", _opts.opengl);
+  setOptionPrewarm (this, "prewarm", _opts.prewarm);
+  setOptionMemoryBudget (this, "memoryBudget", _opts.memoryBudget);
+  setOptionSharedClock (this, "sharedClock", _opts.sharedClock);
 }
 
 /**
@@ -494,6 +1080,105 @@ Formatter::getWebServices ()
   return _webservices;
 }
 
+/**
+ * @brief Gets redraw, tick and player counters.
+ *
+ * The dropped frame and NCLua cycle counters add up the players alive and
+ * those already destroyed (see Formatter::retirePlayerMetrics()), so that
+ * they never decrease.
+ *
+ * @param metrics Variable to store the counters.
+ */
+void
+Formatter::getMetrics (FormatterMetrics *metrics)
+{
+  g_assert_nonnull (metrics);
+  *metrics = _metrics;
+  if (_doc == nullptr)
+    return;
+
+  for (auto media : *_doc->getMedias ())
+    {
+      Player::Metrics pm;
+      if (!media->getPlayerMetrics (nullptr, &pm))
+        continue;
+      metrics->droppedFrames += pm.droppedFrames;
+      metrics->luaCycleSum += pm.cycleTime;
+    }
+}
+
+/**
+ * @brief Accounts the counters of a player about to be destroyed.
+ *
+ * Called by Media before it stops and destroys its player, so that the
+ * counters reported by Formatter::getMetrics() keep what it did.
+ *
+ * @param droppedFrames Frames dropped by the player.
+ * @param cycleTime Time spent by the player in its Lua cycles.
+ */
+void
+Formatter::retirePlayerMetrics (guint64 droppedFrames, Time cycleTime)
+{
+  _metrics.droppedFrames += droppedFrames;
+  _metrics.luaCycleSum += cycleTime;
+}
+
+/**
+ * @brief Gets the serial number of the current (or last) redraw.
+ * @return Redraw serial, or zero if nothing was redrawn yet.
+ */
+guint64
+Formatter::getRedrawSerial ()
+{
+  return _redrawSerial;
+}
+
+/**
+ * @brief Signals that the memory held by some player changed.
+ *
+ * Makes the next redraw check the memory budget, instead of waiting for
+ * the next periodic check.
+ */
+void
+Formatter::setMemoryDirty ()
+{
+  _memoryDirty = true;
+}
+
+/**
+ * @brief Gets the stamp of the key press being dispatched.
+ *
+ * Players changed by the key press (directly or through the links it
+ * triggers) keep this stamp until they redraw.
+ *
+ * @return Monotonic time of the key press, or \c GINGA_TIME_NONE if no
+ * key press is being dispatched.
+ */
+Time
+Formatter::getInputStamp ()
+{
+  return _inputStamp;
+}
+
+/**
+ * @brief Signals that the effects of a key press were applied.
+ *
+ * Called by players when they redraw after being changed by the key
+ * press.  The next redraw completes the key-to-photon latency sample of
+ * the oldest applied key press.
+ *
+ * @param stamp Stamp of the key press (see getInputStamp()); ignored if
+ * \c GINGA_TIME_NONE.
+ */
+void
+Formatter::setInputApplied (Time stamp)
+{
+  if (!GINGA_TIME_IS_VALID (stamp))
+    return;
+  if (!GINGA_TIME_IS_VALID (_inputApplied) || stamp < _inputApplied)
+    _inputApplied = stamp;
+}
+
 /**
  * @brief Gets EOS flag.
  * @return EOS flag.
@@ -514,6 +1199,202 @@ Formatter::setEOS (bool eos)
   _eos = eos;
 }
 
+// Editing commands fail with this unless the formatter is playing.
+#define _GINGA_CHECK_EDITING(ginga, errmsg)                                 \
+  G_STMT_START                                                             \
+  {                                                                        \
+    if (unlikely ((ginga)->_state != GINGA_STATE_PLAYING))                 \
+      {                                                                    \
+        tryset ((errmsg), "No document is running");                       \
+        return false;                                                      \
+      }                                                                    \
+  }                                                                        \
+  G_STMT_END
+
+/// Gets context of the current document by id or alias.
+static Context *
+formatter_get_context (Document *doc, const string &id, string *errmsg)
+{
+  Context *ctx = cast (Context *, doc->getObjectByIdOrAlias (id));
+  if (unlikely (ctx == nullptr))
+    tryset (errmsg, "No such context '" + id + "'");
+  return ctx;
+}
+
+/**
+ * @brief Adds node to the running document.
+ *
+ * The node is parsed by Parser::parseFragment() directly into the context,
+ * so it may use the regions, descriptors and rules of the document.  It is
+ * created sleeping, i.e., it must be started by some link or port.  No
+ * other object is restarted.
+ *
+ * @param ctxId Id of the parent context.
+ * @param xml The \<media\>, \<context\> or \<switch\> element.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+Formatter::addNode (const string &ctxId, const string &xml, string *errmsg)
+{
+  Context *ctx;
+
+  _GINGA_CHECK_EDITING (this, errmsg);
+  if (unlikely ((ctx = formatter_get_context (_doc, ctxId, errmsg))
+                == nullptr))
+    return false;
+
+  if (unlikely (xstrhasprefix (xstrstrip (xml), "<link")))
+    {
+      tryset (errmsg, "Use addLink to add links");
+      return false;
+    }
+
+  return Parser::parseFragment (xml.c_str (), xml.length (), _docPath, ctx,
+                                _opts.width, _opts.height, errmsg);
+}
+
+/**
+ * @brief Removes node from the running document.
+ *
+ * The node is stopped, if it is occurring, and then destroyed together
+ * with its players.  Any port, link or rule that refers to it is dropped.
+ *
+ * @param compId Id of the parent composition.
+ * @param nodeId Id of the node.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+Formatter::removeNode (const string &compId, const string &nodeId,
+                       string *errmsg)
+{
+  Composition *comp;
+  Object *obj;
+
+  _GINGA_CHECK_EDITING (this, errmsg);
+  comp = cast (Composition *, _doc->getObjectByIdOrAlias (compId));
+  if (unlikely (comp == nullptr))
+    {
+      tryset (errmsg, "No such composition '" + compId + "'");
+      return false;
+    }
+
+  obj = comp->getChildById (nodeId);
+  if (unlikely (obj == nullptr || obj == _doc->getSettings ()))
+    {
+      tryset (errmsg, "No such node '" + nodeId + "' in '" + compId + "'");
+      return false;
+    }
+
+  if (!obj->isSleeping ())
+    obj->getLambda ()->transition (Event::STOP);
+  comp->removeChild (obj);
+  delete obj;
+
+  return true;
+}
+
+/**
+ * @brief Adds link to the running document.
+ *
+ * The link is parsed by Parser::parseFragment(), so it may use the
+ * connectors of the document and bind any child of the context.
+ *
+ * @param ctxId Id of the context.
+ * @param xml The \<link\> element.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+Formatter::addLink (const string &ctxId, const string &xml, string *errmsg)
+{
+  Context *ctx;
+
+  _GINGA_CHECK_EDITING (this, errmsg);
+  if (unlikely ((ctx = formatter_get_context (_doc, ctxId, errmsg))
+                == nullptr))
+    return false;
+
+  if (unlikely (!xstrhasprefix (xstrstrip (xml), "<link")))
+    {
+      tryset (errmsg, "Expected a <link> element");
+      return false;
+    }
+
+  return Parser::parseFragment (xml.c_str (), xml.length (), _docPath, ctx,
+                                _opts.width, _opts.height, errmsg);
+}
+
+/**
+ * @brief Removes link from the running document.
+ * @param ctxId Id of the context.
+ * @param linkId Id of the link.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+Formatter::removeLink (const string &ctxId, const string &linkId,
+                       string *errmsg)
+{
+  Context *ctx;
+
+  _GINGA_CHECK_EDITING (this, errmsg);
+  if (unlikely ((ctx = formatter_get_context (_doc, ctxId, errmsg))
+                == nullptr))
+    return false;
+
+  if (unlikely (!ctx->removeLink (linkId)))
+    {
+      tryset (errmsg, "No such link '" + linkId + "' in '" + ctxId + "'");
+      return false;
+    }
+
+  return true;
+}
+
+/**
+ * @brief Sets property of node in the running document.
+ *
+ * The property is set through its attribution event, so that the links
+ * that depend on it are triggered and the node's player is updated in
+ * place.
+ *
+ * @param nodeId Id of the node.
+ * @param name Property name.
+ * @param value Property value.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+Formatter::setPropertyValue (const string &nodeId, const string &name,
+                             const string &value, string *errmsg)
+{
+  Object *obj;
+  Event *evt;
+
+  _GINGA_CHECK_EDITING (this, errmsg);
+  obj = _doc->getObjectByIdOrAlias (nodeId);
+  if (unlikely (obj == nullptr))
+    {
+      tryset (errmsg, "No such node '" + nodeId + "'");
+      return false;
+    }
+
+  evt = obj->getAttributionEvent (name);
+  if (evt == nullptr)
+    {
+      obj->addAttributionEvent (name);
+      evt = obj->getAttributionEvent (name);
+      g_assert_nonnull (evt);
+    }
+
+  if (_doc->evalAction (evt, Event::START, value) == 0)
+    obj->setProperty (name, value);
+
+  return true;
+}
+
 // Public: Static.
 
 /**
@@ -609,6 +1490,67 @@ Formatter::setOptionOpenGL (unused (Formatter *self), const string &name,
   TRACE ("%s:=%s", name.c_str (), strbool (value));
 }
 
+/**
+ * @brief Sets the prewarm option of the given Formatter.
+ *
+ * If set, Formatter::start() compiles the NCLua scripts of the document
+ * into the Lua bytecode cache before running it.
+ *
+ * @param self Formatter.
+ * @param name Must be the string "prewarm".
+ * @param value Prewarm flag value.
+ */
+void
+Formatter::setOptionPrewarm (unused (Formatter *self), const string &name,
+                             bool value)
+{
+  g_assert (name == "prewarm");
+  TRACE ("%s:=%s", name.c_str (), strbool (value));
+}
+
+/**
+ * @brief Sets the memory budget option of the given Formatter.
+ *
+ * If positive, Formatter::redraw() keeps the bytes held by the player
+ * surfaces, textures and pipelines within this many megabytes by
+ * evicting the backing stores of the players that were not drawn in the
+ * current frame, least recently drawn first.  The budget is checked
+ * after a player reloads its backing stores, and at least once a second.
+ *
+ * @param self Formatter.
+ * @param name Must be the string "memoryBudget".
+ * @param value Memory budget in megabytes, or zero for no budget.
+ */
+void
+Formatter::setOptionMemoryBudget (Formatter *self, const string &name,
+                                  int value)
+{
+  g_assert (name == "memoryBudget");
+  if (unlikely (value < 0))
+    WARNING ("negative memory budget %d: disabling budget", value);
+  self->setMemoryDirty ();
+  TRACE ("%s:=%d", name.c_str (), value);
+}
+
+/**
+ * @brief Sets the shared clock option of the given Formatter.
+ *
+ * If set, the video players created from now on run on the system clock
+ * and post to a single bus, watched once for all of them, instead of
+ * each pipeline selecting its own clock and installing its own watch.
+ *
+ * @param self Formatter.
+ * @param name Must be the string "sharedClock".
+ * @param value Shared clock flag value.
+ */
+void
+Formatter::setOptionSharedClock (unused (Formatter *self),
+                                 const string &name, bool value)
+{
+  g_assert (name == "sharedClock");
+  TRACE ("%s:=%s", name.c_str (), strbool (value));
+}
+
 /**
  * @brief Sets the width or height options of the given Formatter.
  * @param self Formatter.
@@ -625,4 +1567,180 @@ Formatter::setOptionSize (Formatter *self, const string &name, int value)
   TRACE ("%s:=%d", name.c_str (), value);
 }
 
+// Private.
+
+/// Maximum number of key-to-photon latency samples kept.
+#define FORMATTER_INPUT_LATENCY_SAMPLES 256
+
+// Parses the document in \p file and initializes formatter variables,
+// but does not start the presentation.
+bool
+Formatter::load (const string &file, string *errmsg)
+{
+  int w, h;
+
+  // Parse document.
+  g_assert_null (_doc);
+  w = _opts.width;
+  h = _opts.height;
+  _doc = nullptr;
+
+#if defined WITH_LUA && WITH_LUA
+  if (xstrhassuffix (file, ".lua"))
+    {
+      _doc = ParserLua::parseFile (file, errmsg);
+      if (unlikely (_doc == nullptr))
+        return false;
+    }
+#endif
+
+  if (xstrhassuffix (file, ".nclb"))
+    {
+      _doc = ParserBinary::parseFile (file, w, h, errmsg);
+      if (unlikely (_doc == nullptr))
+        return false;
+    }
+
+  if (_doc == nullptr)
+    _doc = Parser::parseFile (file, w, h, errmsg);
+  if (unlikely (_doc == nullptr))
+    return false;
+
+  g_assert_nonnull (_doc);
+  _doc->setData ("formatter", (void *) this);
+
+  // Precompile NCLua scripts.
+  if (_opts.prewarm)
+    {
+      for (auto media : *_doc->getMedias ())
+        {
+          string uri = media->getProperty ("uri");
+          string mime = media->getProperty ("type");
+          string msg;
+          gchar *path;
+
+          if (mime == "" && uri != "")
+            Player::getMimeForURI (uri, &mime);
+          if (mime != "application/x-ginga-NCLua")
+            continue;
+
+          path = g_filename_from_uri (uri.c_str (), nullptr, nullptr);
+          if (path == nullptr)
+            continue;
+          if (unlikely (!LuaCache::prewarm (path, &msg)))
+            WARNING ("cannot precompile '%s': %s", path, msg.c_str ());
+          g_free (path);
+        }
+    }
+
+  Context *root = _doc->getRoot ();
+  g_assert_nonnull (root);
+  MediaSettings *settings = _doc->getSettings ();
+  g_assert_nonnull (settings);
+
+  // Initialize formatter variables.
+  _docPath = file;
+  _eos = false;
+  _lastTickTotal = 0;
+  _lastTickDiff = 0;
+  _lastTickFrameNo = 0;
+  _inputStamp = GINGA_TIME_NONE;
+  _inputApplied = GINGA_TIME_NONE;
+
+  return true;
+}
+
+// Accounts a redraw that took \p dur in the redraw time histogram.
+void
+Formatter::redrawDone (Time dur)
+{
+  _metrics.redrawCount++;
+  _metrics.redrawSum += dur;
+  for (size_t i = 0; i < FORMATTER_REDRAW_BUCKETS; i++)
+    {
+      if (dur <= _metrics.redrawBounds[i])
+        {
+          _metrics.redrawBuckets[i]++;
+          break;
+        }
+    }
+}
+
+// Compares the redraw serials of eviction candidates.
+static bool
+formatter_lru_cmp (const pair<guint64, Media *> &a,
+                   const pair<guint64, Media *> &b)
+{
+  return a.first < b.first;
+}
+
+// Evicts the backing stores of players that were not drawn in the
+// current frame, least recently drawn first, until the bytes held by
+// all players fit in the memory budget.  Evicted players are reloaded
+// lazily by Player::redraw().
+void
+Formatter::enforceMemoryBudget ()
+{
+  vector<pair<guint64, Media *>> lru;
+  guint64 budget;
+  guint64 total;
+
+  budget = (guint64) _opts.memoryBudget * 1024 * 1024;
+  total = 0;
+  for (auto media : *_doc->getMedias ())
+    {
+      Player::Metrics pm;
+      if (!media->getPlayerMetrics (nullptr, &pm))
+        continue;
+      total += pm.surfaceBytes + pm.textureBytes + pm.pipelineBytes;
+      if (pm.lastDrawn != _redrawSerial
+          && pm.surfaceBytes + pm.textureBytes > 0)
+        lru.push_back (std::make_pair (pm.lastDrawn, media));
+    }
+
+  if (total <= budget)
+    return;
+
+  std::stable_sort (lru.begin (), lru.end (), formatter_lru_cmp);
+  for (auto &it : lru)
+    {
+      guint64 bytes;
+
+      if (total <= budget)
+        break;
+      bytes = it.second->evictPlayer ();
+      if (bytes == 0)
+        continue;
+      TRACE ("evicted %" G_GUINT64_FORMAT " bytes of %s", bytes,
+             it.second->getId ().c_str ());
+      total -= MIN (bytes, total);
+      _metrics.evictions++;
+      _metrics.evictedBytes += bytes;
+    }
+
+  if (total > budget)
+    TRACE ("memory budget exceeded by visible players: %" G_GUINT64_FORMAT
+           " > %" G_GUINT64_FORMAT " bytes", total, budget);
+}
+
+// Records the latency of the oldest applied key, whose effects have just
+// been presented.
+void
+Formatter::inputPresented ()
+{
+  Time now, latency;
+
+  g_assert (GINGA_TIME_IS_VALID (_inputApplied));
+  now = g_get_monotonic_time () * GINGA_USECOND;
+  latency = (now > _inputApplied) ? now - _inputApplied : 0;
+
+  if (_inputLatencies.size () < FORMATTER_INPUT_LATENCY_SAMPLES)
+    _inputLatencies.push_back (latency);
+  else
+    _inputLatencies[_inputSamples % FORMATTER_INPUT_LATENCY_SAMPLES]
+        = latency;
+  _inputSamples++;
+  _inputApplied = GINGA_TIME_NONE;
+}
+
 }
@@ -32,6 +32,47 @@ class Media;
 class MediaSettings;
 class Object;
 
+/// Number of finite buckets in the redraw time histogram.
+#define FORMATTER_REDRAW_BUCKETS 8
+
+/**
+ * @brief Frame timing counters exported by WebServices' /metrics.
+ */
+struct FormatterMetrics
+{
+  /// @brief Upper bounds of the redraw time buckets (in nanoseconds).
+  Time redrawBounds[FORMATTER_REDRAW_BUCKETS];
+
+  /// @brief Number of redraws that fell in each bucket (not cumulative);
+  /// redraws above the last bound count only in #redrawCount.
+  guint64 redrawBuckets[FORMATTER_REDRAW_BUCKETS];
+
+  /// @brief Total number of redraws.
+  guint64 redrawCount;
+
+  /// @brief Total time spent in redraws (in nanoseconds).
+  Time redrawSum;
+
+  /// @brief Total number of ticks.
+  guint64 tickCount;
+
+  /// @brief Total time spent in ticks (in nanoseconds).
+  Time tickSum;
+
+  /// @brief Number of player evictions due to the memory budget.
+  guint64 evictions;
+
+  /// @brief Total bytes released by evictions.
+  guint64 evictedBytes;
+
+  /// @brief Total frames dropped by video players, alive or not.
+  guint64 droppedFrames;
+
+  /// @brief Total time spent running NCLua players, alive or not (in
+  /// nanoseconds).
+  Time luaCycleSum;
+};
+
 /**
  * @brief Interface between libginga and the external world.
  */
@@ -49,6 +90,10 @@ public:
 
   bool sendKey (const std::string &, bool);
   bool sendTick (uint64_t, uint64_t, uint64_t);
+  bool sendEditingCommand (const std::string &, std::string *);
+  void getStats (GingaStats *);
+  bool saveState (string *, string *);
+  bool restoreState (const string &, string *);
 
   const GingaOptions *getOptions ();
   bool getOptionBool (const std::string &);
@@ -64,14 +109,30 @@ public:
 
   Document *getDocument ();
   WebServices *getWebServices ();
+  void getMetrics (FormatterMetrics *);
+  void retirePlayerMetrics (guint64, Time);
+  guint64 getRedrawSerial ();
+  void setMemoryDirty ();
+  Time getInputStamp ();
+  void setInputApplied (Time);
   bool getEOS ();
   void setEOS (bool);
 
+  bool addNode (const string &, const string &, string *);
+  bool removeNode (const string &, const string &, string *);
+  bool addLink (const string &, const string &, string *);
+  bool removeLink (const string &, const string &, string *);
+  bool setPropertyValue (const string &, const string &, const string &,
+                         string *);
+
   static void setOptionBackground (Formatter *, const string &, string);
   static void setOptionDebug (Formatter *, const string &, bool);
   static void setOptionWebServices (Formatter *, const string &, bool);
   static void setOptionExperimental (Formatter *, const string &, bool);
   static void setOptionOpenGL (Formatter *, const string &, bool);
+  static void setOptionPrewarm (Formatter *, const string &, bool);
+  static void setOptionMemoryBudget (Formatter *, const string &, int);
+  static void setOptionSharedClock (Formatter *, const string &, bool);
   static void setOptionSize (Formatter *, const string &, int);
 
 private:
@@ -107,6 +168,38 @@ private:
 
   /// @brief Whether the presentation has ended naturally.
   bool _eos;
+
+  /// @brief Monotonic time of the key press being dispatched, or
+  /// GINGA_TIME_NONE.
+  Time _inputStamp;
+
+  /// @brief Monotonic time of the oldest key press applied to some player
+  /// but not yet presented, or GINGA_TIME_NONE.
+  Time _inputApplied;
+
+  /// @brief Latest key-to-photon latencies (ring buffer).
+  vector<Time> _inputLatencies;
+
+  /// @brief Total number of key-to-photon latency samples.
+  guint64 _inputSamples;
+
+  /// @brief Redraw and tick time counters.
+  FormatterMetrics _metrics;
+
+  /// @brief Serial number of the current (or last) redraw.
+  guint64 _redrawSerial;
+
+  /// @brief Whether the player memory changed since the last budget
+  /// check.
+  bool _memoryDirty;
+
+  /// @brief Monotonic time of the last budget check (in microseconds).
+  gint64 _memoryChecked;
+
+  bool load (const string &, string *);
+  void inputPresented ();
+  void redrawDone (Time);
+  void enforceMemoryBudget ();
 };
 
 }
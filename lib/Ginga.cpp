@@ -73,6 +73,10 @@ Ginga::version ()
 /**
  * @fn Ginga::start
  * @brief Starts the presentation of an NCL file.
+ *
+ * Files with the .nclb extension are taken as documents compiled by
+ * ginga-compile (see ParserBinary::writeFile()).
+ *
  * @param path Path to NCL file.
  * @param[out] errmsg Variable to store the error message (if any).
  * @return \c true if successful or \c false otherwise.
@@ -81,6 +85,10 @@ Ginga::version ()
 /**
  * @fn Ginga::stop
  * @brief Stops the presentation.
+ *
+ * Returns without waiting for the media pipelines of the stopped players
+ * to be released; these are released in background.
+ *
  * @return \c true if successful or \c false otherwise.
  */
 
@@ -114,6 +122,40 @@ Ginga::version ()
  * @return \c true if successful, or \c false otherwise.
  */
 
+/**
+ * @fn Ginga::getStats
+ * @brief Gets presentation statistics.
+ * @param stats Variable to store the statistics.
+ */
+
+/**
+ * @fn Ginga::saveState
+ * @brief Serializes the runtime state of the presentation.
+ *
+ * The state records event states and intervals, object times, pending
+ * delayed actions, object properties (settings variables and focus
+ * included) and the position of each active player.  It does not include
+ * the document itself, which is re-read from its original path by
+ * Ginga::restoreState().
+ *
+ * @param[out] state Variable to store the serialized state.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful or \c false otherwise.
+ */
+
+/**
+ * @fn Ginga::restoreState
+ * @brief Resumes a presentation from a state saved by Ginga::saveState().
+ *
+ * Any running presentation is stopped first.  The document is loaded
+ * again and the saved state is installed directly, without re-executing
+ * the links and actions that led to it.
+ *
+ * @param state Serialized state.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful or \c false otherwise.
+ */
+
 /**
  * @fn Ginga::getOptions
  * @brief Gets current options.
@@ -0,0 +1,316 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "aux-ginga.h"
+#include "LuaCache.h"
+
+GINGA_BEGIN_DECLS
+#include "aux-lua.h"
+GINGA_END_DECLS
+
+/**
+ * @file LuaCache.cpp
+ * @brief On-disk cache of compiled Lua chunks.
+ *
+ * Compiled chunks are stored under the user cache directory, one file per
+ * source, named after a checksum of the source's absolute path and of the
+ * Lua version ginga was built against, followed by the source's mtime (in
+ * microseconds) and size.  Editing a script (or upgrading Lua) thus yields
+ * a new key and a cache miss.  Writing a chunk removes the stale chunks of
+ * the same source, and the directory keeps at most #LUACACHE_MAX_ENTRIES
+ * chunks, the oldest being removed first.
+ */
+
+namespace ginga {
+
+/// Maximum number of compiled chunks kept in the cache directory.
+#define LUACACHE_MAX_ENTRIES 256
+
+// Lua writer that appends the dumped chunk to a GString.
+static int
+luacache_writer (unused (lua_State *L), const void *p, size_t sz, void *ud)
+{
+  g_string_append_len ((GString *) ud, (const gchar *) p, (gssize) sz);
+  return 0;
+}
+
+// Computes the cache key of the Lua source at the given path.  All keys
+// of the same source share the prefix "<checksum>-".
+static bool
+luacache_get_key (const string &path, string *key)
+{
+  GFile *file;
+  GFileInfo *info;
+  gchar *abs;
+  guint64 mtime;
+  goffset size;
+  string str;
+  gchar *sum;
+
+  file = g_file_new_for_path (path.c_str ());
+  g_assert_nonnull (file);
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NONE, nullptr, nullptr);
+  if (info == nullptr)
+    {
+      g_object_unref (file);
+      return false;
+    }
+
+  abs = g_file_get_path (file);
+  g_assert_nonnull (abs);
+  g_object_unref (file);
+  mtime = g_file_info_get_attribute_uint64 (info,
+                                            G_FILE_ATTRIBUTE_TIME_MODIFIED)
+              * G_USEC_PER_SEC
+          + g_file_info_get_attribute_uint32 (
+                info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  size = g_file_info_get_size (info);
+  g_object_unref (info);
+
+  str = xstrbuild ("%s:%d:%d", abs, (int) LUA_VERSION_NUM,
+                   (int) sizeof (lua_Number));
+  g_free (abs);
+  sum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, str.c_str (), -1);
+  g_assert_nonnull (sum);
+  tryset (key, xstrbuild ("%s-%" G_GUINT64_FORMAT "-%" G_GINT64_FORMAT,
+                          sum, mtime, (gint64) size));
+  g_free (sum);
+  return true;
+}
+
+// Compares the modification times of cached chunks.
+static bool
+luacache_mtime_cmp (const pair<gint64, string> &a,
+                    const pair<gint64, string> &b)
+{
+  return a.first < b.first;
+}
+
+// Removes from the cache directory the chunks of the same source as the
+// given (just written) chunk, then the oldest chunks until at most
+// #LUACACHE_MAX_ENTRIES remain.
+static void
+luacache_prune (const string &cache)
+{
+  vector<pair<gint64, string>> entries;
+  string dir;
+  string name;
+  string prefix;
+  GDir *gdir;
+  const gchar *entry;
+
+  dir = xpathdirname (cache);
+  name = xpathbasename (cache);
+  prefix = name.substr (0, name.find ('-') + 1);
+
+  gdir = g_dir_open (dir.c_str (), 0, nullptr);
+  if (gdir == nullptr)
+    return;
+
+  while ((entry = g_dir_read_name (gdir)) != nullptr)
+    {
+      string path;
+      GStatBuf st;
+
+      if (!xstrhassuffix (entry, ".luac") || name == entry)
+        continue;
+
+      path = xpathbuild (dir, entry);
+      if (xstrhasprefix (entry, prefix))
+        {
+          TRACE ("removing stale Lua cache '%s'", path.c_str ());
+          g_unlink (path.c_str ());
+          continue;
+        }
+      if (g_stat (path.c_str (), &st) == 0)
+        entries.push_back (std::make_pair ((gint64) st.st_mtime, path));
+    }
+  g_dir_close (gdir);
+
+  if (entries.size () < LUACACHE_MAX_ENTRIES)
+    return;
+
+  std::stable_sort (entries.begin (), entries.end (), luacache_mtime_cmp);
+  for (size_t i = 0; i <= entries.size () - LUACACHE_MAX_ENTRIES; i++)
+    {
+      TRACE ("removing old Lua cache '%s'", entries[i].second.c_str ());
+      g_unlink (entries[i].second.c_str ());
+    }
+}
+
+// Compiles the Lua source at path and pushes the resulting chunk onto the
+// stack.  If cache is non-empty, also stores the compiled chunk there.
+static bool
+luacache_compile (lua_State *L, const string &path, const string &cache,
+                  string *errmsg)
+{
+  GString *buf;
+  GError *err;
+  string dir;
+
+  if (unlikely (luaL_loadfile (L, path.c_str ()) != LUA_OK))
+    {
+      tryset (errmsg, string (lua_tostring (L, -1)));
+      lua_pop (L, 1);
+      return false;
+    }
+
+  if (cache == "")
+    return true;
+
+  dir = xpathdirname (cache);
+  if (unlikely (g_mkdir_with_parents (dir.c_str (), 0755) != 0))
+    {
+      WARNING ("cannot create Lua cache dir '%s': %s", dir.c_str (),
+               g_strerror (errno));
+      return true;
+    }
+
+  buf = g_string_new (nullptr);
+  g_assert_nonnull (buf);
+  lua_dump (L, luacache_writer, buf, 0);
+
+  err = nullptr;
+  if (unlikely (!g_file_set_contents (cache.c_str (), buf->str,
+                                      (gssize) buf->len, &err)))
+    {
+      g_assert_nonnull (err);
+      WARNING ("cannot write Lua cache '%s': %s", cache.c_str (),
+               err->message);
+      g_error_free (err);
+    }
+  else
+    {
+      TRACE ("cached '%s' as '%s'", path.c_str (), cache.c_str ());
+      luacache_prune (cache);
+    }
+
+  g_string_free (buf, TRUE);
+  return true;
+}
+
+/**
+ * @brief Loads a Lua file using the bytecode cache.
+ *
+ * If there is an up-to-date compiled chunk for the file, loads it.
+ * Otherwise, compiles the file and stores the result in the cache.  In
+ * both cases, the resulting function is left on top of the stack, as with
+ * luaL_loadfile().
+ *
+ * @param L Lua state.
+ * @param path Path to Lua source file.
+ * @param errmsg Variable to store the error message (if any).
+ * @return True if successful, or false otherwise.
+ */
+bool
+LuaCache::loadFile (lua_State *L, const string &path, string *errmsg)
+{
+  string key;
+  string cache;
+  gchar *data;
+  gsize len;
+
+  g_assert_nonnull (L);
+  if (unlikely (!luacache_get_key (path, &key)))
+    return luacache_compile (L, path, "", errmsg);
+
+  cache = xpathbuild (LuaCache::getCacheDir (), key + ".luac");
+  if (g_file_get_contents (cache.c_str (), &data, &len, nullptr))
+    {
+      string name = "@" + path;
+      int status = luaL_loadbufferx (L, data, len, name.c_str (), "b");
+      g_free (data);
+      if (likely (status == LUA_OK))
+        return true;
+
+      TRACE ("discarding Lua cache '%s': %s", cache.c_str (),
+             lua_tostring (L, -1));
+      lua_pop (L, 1);
+    }
+
+  return luacache_compile (L, path, cache, errmsg);
+}
+
+/**
+ * @brief Compiles a Lua file into the bytecode cache.
+ *
+ * Does nothing if there is already an up-to-date compiled chunk for the
+ * file.
+ *
+ * @param path Path to Lua source file.
+ * @param errmsg Variable to store the error message (if any).
+ * @return True if successful, or false otherwise.
+ */
+bool
+LuaCache::prewarm (const string &path, string *errmsg)
+{
+  lua_State *L;
+  bool status;
+
+  L = luaL_newstate ();
+  g_assert_nonnull (L);
+  status = LuaCache::loadFile (L, path, errmsg);
+  lua_close (L);
+
+  return status;
+}
+
+/**
+ * @brief Gets the path of the compiled chunk of a Lua file.
+ *
+ * Compiles the file into the cache if needed.  This is meant for code that
+ * can only load Lua chunks by file name, e.g., ncluaw_open().
+ *
+ * @param path Path to Lua source file.
+ * @return Path to the compiled chunk, or the given path if the file could
+ * not be compiled or cached.
+ */
+string
+LuaCache::getCachedPath (const string &path)
+{
+  string key;
+  string cache;
+
+  if (unlikely (!luacache_get_key (path, &key)))
+    return path;
+
+  cache = xpathbuild (LuaCache::getCacheDir (), key + ".luac");
+  if (!g_file_test (cache.c_str (), G_FILE_TEST_IS_REGULAR)
+      && !(LuaCache::prewarm (path, nullptr)
+           && g_file_test (cache.c_str (), G_FILE_TEST_IS_REGULAR)))
+    {
+      return path;
+    }
+
+  return cache;
+}
+
+/**
+ * @brief Gets the directory where compiled chunks are stored.
+ * @return Cache directory path.
+ */
+string
+LuaCache::getCacheDir ()
+{
+  return xpathbuild (xpathbuild (g_get_user_cache_dir (), "ginga"), "lua");
+}
+
+}
@@ -64,6 +64,8 @@ Media::setProperty (const string &name, const string &value, Time dur)
 {
   string from = this->getProperty (name);
   Object::setProperty (name, value, dur);
+  if (_doc != nullptr)
+    _doc->indexFocusProperty (this, name, value);
 
   if (_player == nullptr)
     return;
@@ -78,8 +80,6 @@ Media::setProperty (const string &name, const string &value, Time dur)
 void
 Media::sendKey (const string &key, bool press)
 {
-  list<Event *> buf;
-
   if (unlikely (this->isSleeping ()))
     return; // nothing to do
 
@@ -89,14 +89,7 @@ Media::sendKey (const string &key, bool press)
   if (press && xstrhasprefix (key, "CURSOR_") && _player->isFocused ())
     {
       string next;
-      if ((key == "CURSOR_UP"
-           && (next = _player->getProperty ("moveUp")) != "")
-          || ((key == "CURSOR_DOWN"
-               && (next = _player->getProperty ("moveDown")) != ""))
-          || ((key == "CURSOR_LEFT"
-               && (next = _player->getProperty ("moveLeft")) != ""))
-          || ((key == "CURSOR_RIGHT"
-               && (next = _player->getProperty ("moveRight")) != "")))
+      if (_doc->getFocusNeighbour (this, key, &next))
         {
           MediaSettings *settings;
           settings = _doc->getSettings ();
@@ -109,31 +102,8 @@ Media::sendKey (const string &key, bool press)
   if (_player->isFocused ())
     _player->sendKeyEvent (key, press);
 
-  // Collect the events to be triggered.
-  for (auto evt : _events)
-    {
-      if (evt->getType () != Event::SELECTION)
-        continue;
-
-      string expected = "";
-      evt->getParameter ("key", &expected);
-
-      if (expected[0] == '$')
-        expected = ""; // A param could not be resolved.  Should we generate
-                       // an error?
-
-      if (!((expected == "" && key == "ENTER" && _player->isFocused ())
-            || (expected != "" && key == expected)))
-        {
-          continue;
-        }
-
-      buf.push_back (evt);
-    }
-
-  // Run collected events.
-  for (Event *evt : buf)
-    _doc->evalAction (evt, press ? Event::START : Event::STOP);
+  // Selection events are dispatched by Formatter::sendKey() through the
+  // document's key index; see Document::getSelectionEvents().
 }
 
 void
@@ -185,18 +155,9 @@ Media::beforeTransition (Event *evt, Event::Transition transition)
               {
                 if (evt->isLambda ())
                   { // Lambda
-                    Formatter *fmt;
-
-                    g_assert (_doc->getData ("formatter", (void **) &fmt));
-                    g_assert_null (_player);
-                    _player = Player::createPlayer (
-                        fmt, this, _properties["uri"], _properties["type"]);
-                    if (unlikely (_player == nullptr))
+                    if (unlikely (!this->createPlayer ()))
                       return false; // fail
 
-                    for (auto it : _properties)
-                      _player->setProperty (it.first, it.second);
-
                     g_assert_nonnull (_player);
                     // Start underlying player.
                     // TODO: Check player failure.
@@ -491,6 +452,20 @@ Media::isFocused ()
   return _player->isFocused ();
 }
 
+/**
+ * @brief Tests whether media object reacts to selection events.
+ * @param focused Whether the selection also requires the media to be
+ * focused, which is the case for selection events with no key.
+ * @return True if the selection events of media should be triggered.
+ */
+bool
+Media::isSelectable (bool focused)
+{
+  if (this->isSleeping () || _player == nullptr)
+    return false;
+  return !focused || _player->isFocused ();
+}
+
 bool
 Media::getZ (int *zindex, int *zorder)
 {
@@ -501,6 +476,19 @@ Media::getZ (int *zindex, int *zorder)
   return true;
 }
 
+/**
+ * @brief Tests whether media has something to draw.
+ * @return True if media is occurring or paused and its player draws on
+ * screen, or false otherwise.
+ */
+bool
+Media::isDrawable ()
+{
+  if (this->isSleeping () || _player == nullptr)
+    return false;
+  return _player->isDrawable ();
+}
+
 void
 Media::redraw (cairo_t *cr)
 {
@@ -509,17 +497,109 @@ Media::redraw (cairo_t *cr)
   _player->redraw (cr);
 }
 
+void
+Media::updateGeometry ()
+{
+  if (_player == nullptr)
+    return; // nothing to do
+  _player->updateGeometry ();
+}
+
+/**
+ * @brief Gets the playback time of the underlying player.
+ * @param time Variable to store the player time.
+ * @param paused Variable to store whether the player is paused.
+ * @return True if the media has an underlying player, or false otherwise.
+ */
+bool
+Media::getPlayerTime (Time *time, bool *paused)
+{
+  if (_player == nullptr)
+    return false;
+  tryset (time, _player->getTime ());
+  tryset (paused, _player->getState () == Player::PAUSED);
+  return true;
+}
+
+/**
+ * @brief Gets the resource usage of the underlying player.
+ * @param kind Variable to store the player kind.
+ * @param metrics Variable to store the player metrics.
+ * @return True if the media has an underlying player, or false otherwise.
+ */
+bool
+Media::getPlayerMetrics (string *kind, Player::Metrics *metrics)
+{
+  if (_player == nullptr)
+    return false;
+  tryset (kind, _player->getKind ());
+  if (metrics != nullptr)
+    _player->getMetrics (metrics);
+  return true;
+}
+
+/**
+ * @brief Releases the backing stores of the underlying player.
+ * @return The number of bytes released.
+ */
+guint64
+Media::evictPlayer ()
+{
+  if (_player == nullptr)
+    return 0;
+  return _player->evict ();
+}
+
+/**
+ * @brief Recreates the underlying player of a restored media object.
+ *
+ * Creates and starts the player as the start of the lambda event would,
+ * but without transitioning any event, then fast-forwards it to \p time.
+ * Used by Formatter::restoreState().
+ *
+ * @param time Player time to resume from.
+ * @param paused Whether to leave the player paused.
+ * @return True if successful, or false otherwise.
+ */
+bool
+Media::restorePlayer (Time time, bool paused)
+{
+  if (unlikely (!this->createPlayer ()))
+    return false;
+
+  _player->start ();
+  if (GINGA_TIME_IS_VALID (time) && time > 0)
+    {
+      _player->incTime (time);
+      _player->setProperty (
+          "time", xstrbuild ("%.9gs", (double) time / GINGA_SECOND));
+    }
+  if (paused)
+    _player->pause ();
+  return true;
+}
+
 // Protected.
 
 void
 Media::doStop ()
 {
+  Formatter *fmt;
+
   if (_player == nullptr)
     {
       g_assert (this->isSleeping ());
       return; // nothing to do
     }
 
+  // Keep the player's counters before stopping it releases its pipeline.
+  if (_doc != nullptr && _doc->getData ("formatter", (void **) &fmt))
+    {
+      Player::Metrics pm;
+      _player->getMetrics (&pm);
+      fmt->retirePlayerMetrics (pm.droppedFrames, pm.cycleTime);
+    }
+
   if (_player->getState () != Player::SLEEPING)
     _player->stop ();
   delete _player;
@@ -527,4 +607,25 @@ Media::doStop ()
   Object::doStop ();
 }
 
+// Private.
+
+// Creates the underlying player and copies the current properties into it.
+bool
+Media::createPlayer ()
+{
+  Formatter *fmt;
+
+  g_assert (_doc->getData ("formatter", (void **) &fmt));
+  g_assert_null (_player);
+  _player = Player::createPlayer (fmt, this, _properties["uri"],
+                                  _properties["type"]);
+  if (unlikely (_player == nullptr))
+    return false;
+
+  for (auto it : _properties)
+    _player->setProperty (it.first, it.second);
+
+  return true;
+}
+
 }
@@ -40,13 +40,23 @@ public:
 
   // Media:
   virtual bool isFocused ();
+  bool isSelectable (bool);
   virtual bool getZ (int *, int *);
+  bool isDrawable ();
   virtual void redraw (cairo_t *);
+  void updateGeometry ();
+  bool getPlayerTime (Time *, bool *);
+  bool getPlayerMetrics (string *, Player::Metrics *);
+  guint64 evictPlayer ();
+  bool restorePlayer (Time, bool);
 
 protected:
   Player *_player; // underlying player
 
   void doStop () override;
+
+private:
+  bool createPlayer ();
 };
 
 }
@@ -26,7 +26,8 @@ namespace ginga {
 // Public.
 
 MediaSettings::MediaSettings (const string &id)
-    : Media (id), _nextFocus (""), _hasNextFocus (false)
+    : Media (id), _nextFocus (""), _hasNextFocus (false),
+      _nextFocusKey (GINGA_TIME_NONE)
 {
   _properties["type"] = "application/x-ginga-settings";
   this->addAttributionEvent ("service.currentFocus");
@@ -48,18 +49,25 @@ void
 MediaSettings::setProperty (const string &name, const string &value,
                             Time dur)
 {
-  if (name == "service.currentFocus")
-    Player::setCurrentFocus (value);
+  if (name == "service.currentFocus" && _doc != nullptr)
+    _doc->setCurrentFocus (value);
   Media::setProperty (name, value, dur);
 }
 
 void
 MediaSettings::sendTick (Time total, Time diff, Time frame)
 {
+  Formatter *fmt;
+
   if (_hasNextFocus) // effectuate pending focus index update
     {
       this->updateCurrentFocus (_nextFocus);
       _hasNextFocus = false;
+
+      // The focus border moves in the next redraw.
+      if (_doc->getData ("formatter", (void **) &fmt))
+        fmt->setInputApplied (_nextFocusKey);
+      _nextFocusKey = GINGA_TIME_NONE;
     }
   Media::sendTick (total, diff, frame);
 }
@@ -89,24 +97,11 @@ void
 MediaSettings::updateCurrentFocus (const string &index)
 {
   string next;
-  string i;
 
   if (index != "")
-    {
-      next = index;
-    }
+    next = index;
   else
-    {
-      for (auto media : *_doc->getMedias ())
-        {
-          if (media->isOccurring ()
-              && (i = media->getProperty ("focusIndex")) != ""
-              && (next == "" || i < next))
-            {
-              next = i;
-            }
-        }
-    }
+    next = _doc->getFirstFocusIndex ();
 
   // Do the actual attribution.
   string value = next;
@@ -118,8 +113,25 @@ MediaSettings::updateCurrentFocus (const string &index)
 void
 MediaSettings::scheduleFocusUpdate (const string &next)
 {
+  Formatter *fmt;
+
   _hasNextFocus = true;
   _nextFocus = next;
+
+  // Focus moves triggered by keys take effect in the next tick; keep the
+  // stamp of the key press until then.
+  if (!GINGA_TIME_IS_VALID (_nextFocusKey) && _doc != nullptr
+      && _doc->getData ("formatter", (void **) &fmt))
+    _nextFocusKey = fmt->getInputStamp ();
+}
+
+bool
+MediaSettings::getScheduledFocusUpdate (string *next)
+{
+  if (!_hasNextFocus)
+    return false;
+  tryset (next, _nextFocus);
+  return true;
 }
 
 }
@@ -41,10 +41,12 @@ public:
   // MediaSettings:
   void updateCurrentFocus (const string &);
   void scheduleFocusUpdate (const string &);
+  bool getScheduledFocusUpdate (string *);
 
 private:
   string _nextFocus;  // next focus index
   bool _hasNextFocus; // true if a focus update is scheduled
+  Time _nextFocusKey; // stamp of the key press that scheduled it
 };
 
 }
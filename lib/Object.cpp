@@ -81,6 +81,13 @@ Object::initParent (Composition *parent)
   _parent = parent;
 }
 
+void
+Object::resetParent ()
+{
+  g_assert_nonnull (_parent);
+  _parent = nullptr;
+}
+
 string
 Object::toString ()
 {
@@ -280,6 +287,8 @@ Object::addSelectionEvent (const string &key)
 
   evt = new Event (Event::SELECTION, this, key);
   _events.insert (evt);
+  if (_doc != nullptr)
+    _doc->indexSelectionEvent (evt);
 }
 
 Event *
@@ -343,6 +352,12 @@ Object::setProperty (const string &name, const string &value, Time dur)
   _properties[name] = value;
 }
 
+const map<string, string> *
+Object::getProperties ()
+{
+  return &_properties;
+}
+
 const list<pair<Action, Time> > *
 Object::getDelayedActions ()
 {
@@ -361,6 +376,35 @@ Object::addDelayedAction (Event *event, Event::Transition transition,
   _delayed.push_back (std::make_pair (act, _time + delay));
 }
 
+/**
+ * @brief Drops references to objects that are leaving the document.
+ *
+ * Removes the delayed actions over events of the objects in \p objs and
+ * the aliases whose parent is in \p objs.  Called by
+ * Document::removeObject() for each remaining object.
+ *
+ * @param objs The objects being removed.
+ */
+void
+Object::removeReferences (const set<Object *> &objs)
+{
+  for (auto it = _delayed.begin (); it != _delayed.end ();)
+    {
+      if (objs.find (it->first.event->getObject ()) != objs.end ())
+        it = _delayed.erase (it);
+      else
+        ++it;
+    }
+
+  for (auto it = _aliases.begin (); it != _aliases.end ();)
+    {
+      if (it->second != nullptr && objs.find (it->second) != objs.end ())
+        it = _aliases.erase (it);
+      else
+        ++it;
+    }
+}
+
 void
 Object::sendKey (unused (const string &key), unused (bool press))
 {
@@ -407,6 +451,20 @@ Object::getTime ()
   return _time;
 }
 
+/**
+ * @brief Forces object playback time.
+ *
+ * Used by Formatter::restoreState() together with Event::setState().
+ * Delayed actions are relative to this time.
+ *
+ * @param time The new playback time (or GINGA_TIME_NONE).
+ */
+void
+Object::setTime (Time time)
+{
+  _time = time;
+}
+
 // Private.
 
 void
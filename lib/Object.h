@@ -39,6 +39,7 @@ public:
 
   Composition *getParent ();
   void initParent (Composition *);
+  void resetParent ();
 
   virtual string getObjectTypeAsString () = 0;
   virtual string toString ();
@@ -67,15 +68,19 @@ public:
 
   virtual string getProperty (const string &);
   virtual void setProperty (const string &, const string &, Time dur = 0);
+  const map<string, string> *getProperties ();
 
   const list<pair<Action, Time> > *getDelayedActions ();
   void addDelayedAction (Event *, Event::Transition,
                          const string &value = "", Time delay = 0);
 
+  virtual void removeReferences (const set<Object *> &);
+
   virtual void sendKey (const string &, bool);
   virtual void sendTick (Time, Time, Time);
 
   Time getTime ();
+  void setTime (Time);
 
   /**
    * @brief Initiates event transition.
@@ -15,7 +15,9 @@ License for more details.
 You should have received a copy of the GNU General Public License
 along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 
+#include <bitset>
 #include <memory>
+#include <unordered_map>
 
 #include "aux-ginga.h"
 #include "Parser.h"
@@ -30,6 +32,7 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 #include <libxml/parser.h>
 #include <fontconfig/fontconfig.h>
 #include <libxml/uri.h>
+#include <libxml/xmlreader.h>
 
 namespace ginga {
 
@@ -60,16 +63,25 @@ xmlGetLastErrorAsString ()
   return errmsg;
 }
 
-/// Gets node property as C++ string.
-static inline bool
-xmlGetPropAsString (xmlNode *node, const string &name, string *result)
+/// Gets attribute value as C++ string.
+static inline void
+xmlAttrGetValueAsString (xmlAttr *prop, string *result)
 {
-  xmlChar *str = xmlGetProp (node, toXmlChar (name));
-  if (str == nullptr)
-    return false;
-  tryset (result, toCPPString (str));
-  g_free (str);
-  return true;
+  xmlNode *text = prop->children;
+  if (text == nullptr)
+    {
+      result->assign ("");
+    }
+  else if (text->next == nullptr && text->type == XML_TEXT_NODE)
+    {
+      result->assign (toCString (text->content)); // common case
+    }
+  else
+    {
+      xmlChar *str = xmlNodeListGetString (prop->doc, text, 1);
+      result->assign ((str != nullptr) ? toCString (str) : "");
+      xmlFree (str);
+    }
 }
 
 /// Finds node children by tag.
@@ -113,6 +125,7 @@ xmlIsValidName (const string &value, char *offending)
 // Forward declarations.
 typedef struct ParserSyntaxAttr ParserSyntaxAttr;
 typedef struct ParserSyntaxElt ParserSyntaxElt;
+typedef struct ParserSyntaxCompiledElt ParserSyntaxCompiledElt;
 
 /**
  * @brief Parser element wrapper.
@@ -177,6 +190,89 @@ typedef struct ParserLinkBind
   map<string, string> params; ///< Bind parameters.
 } ParserLinkBind;
 
+/**
+ * @brief Stream frame.
+ *
+ * Data associated with an open element while the document is being
+ * streamed by ParserState::process().
+ */
+typedef struct ParserStreamFrame
+{
+  ParserElt *elt;                        ///< Element wrapper.
+  const ParserSyntaxCompiledElt *eltsyn; ///< Entry in syntax table.
+  bool cached; ///< Whether element is in element cache.
+} ParserStreamFrame;
+
+/**
+ * @brief Imported document being read by a worker thread.
+ *
+ * Created by ParserState::importPrefetch() and consumed by
+ * ParserState::importJoin().
+ */
+typedef struct ParserImportFetch
+{
+  string uri;             ///< Document URI.
+  shared_ptr<xmlDoc> xml; ///< Imported document (null on error).
+  string errmsg;          ///< Error message (if any).
+  bool done;              ///< Whether reading has finished.
+  GMutex mutex;           ///< Protects the fields above.
+  GCond cond;             ///< Signaled when reading finishes.
+} ParserImportFetch;
+
+/**
+ * @brief Document read while processing an imported base.
+ */
+typedef struct ParserImportDep
+{
+  string uri;             ///< Document URI.
+  guint64 mtime;          ///< Modification time of source file (in usec).
+  goffset size;           ///< Size of source file.
+  shared_ptr<xmlDoc> xml; ///< Processed document tree.
+} ParserImportDep;
+
+/**
+ * @brief Processing of an imported base being recorded.
+ *
+ * Filled while ParserState::pushImportBase() processes the base, and then
+ * turned into a #ParserImportBase.
+ */
+typedef struct ParserImportRecord
+{
+  bool cacheable;             ///< Whether all documents read are local.
+  int zorder;                 ///< Z-order of the first region.
+  list<ParserImportDep> deps; ///< Documents read.
+  list<ParserElt *> elts;     ///< Elements cached, in processing order.
+  list<string> ids;           ///< Unique ids seen, in processing order.
+} ParserImportRecord;
+
+/**
+ * @brief Element left by the processing of an imported base.
+ */
+typedef struct ParserImportElt
+{
+  xmlNode *node;               ///< Source node.
+  map<string, string> attrs;   ///< Attributes (after processing).
+  set<string> tests;           ///< Test roles (connectors).
+  list<ParserConnRole> roles;  ///< Roles (connectors).
+  shared_ptr<Predicate> pred;  ///< Predicate (compound conditions, rules).
+  shared_ptr<xmlDoc> xml;      ///< Imported document (nested imports).
+} ParserImportElt;
+
+/**
+ * @brief Imported base, as processed by a previous parse.
+ *
+ * Replayed by ParserState::importReplay() instead of processing the base
+ * again.  Read-only once built, and shared by concurrent parses.
+ */
+typedef struct ParserImportBase
+{
+  list<ParserImportDep> deps; ///< Documents read (the imported one first).
+  list<ParserImportElt> elts; ///< Elements cached, in processing order.
+  list<string> ids;           ///< Unique ids seen.
+  int zorder;                 ///< Z-order of the first region.
+  int nregions;               ///< Number of regions.
+} ParserImportBase;
+
 /**
  * @brief Parser state.
  *
@@ -200,12 +296,14 @@ public:
     ERROR_ELT_MISSING_CHILD,            ///< Missing child element.
     ERROR_ELT_BAD_CHILD,                ///< Bad child element.
     ERROR_ELT_IMPORT,                   ///< Error in imported document.
+    ERROR_XML,                          ///< Malformed XML.
   };
 
   ParserState (int, int);
   ~ParserState ();
   ParserState::Error getError (string *);
-  Document *process (xmlDoc *);
+  Document *process (xmlTextReader *);
+  bool processEdit (xmlTextReader *, Context *);
 
   // push & pop
   static bool pushNcl (ParserState *, ParserElt *);
@@ -243,16 +341,21 @@ public:
 
 private:
   Document *_doc;      ///< The resulting #Document.
+  Context *_editCtx;   ///< Context being edited (if editing).
   xmlDoc *_xml;        ///< The DOM tree being processed.
   int _genid;          ///< Last generated id.
+  int _zorder;         ///< Z-order of the next region.
   UserData _udata;     ///< Attached user data.
   set<string> _unique; ///< Unique attributes seen so far.
 
   ParserState::Error _error; ///< Last error code.
   string _errorMsg;          ///< Last error message.
 
-  map<xmlNode *, ParserElt *> _eltCache;          ///< Element cache.
-  map<string, list<ParserElt *> > _eltCacheByTag; ///< Element cache by tag.
+  unordered_map<xmlNode *, ParserElt *> _eltCache; ///< Element cache.
+  map<string, list<ParserElt *> > _eltCacheByTag;  ///< Element cache by tag.
+
+  /// Element cache by tag and id.
+  unordered_map<string, unordered_map<string, ParserElt *> > _eltCacheById;
 
   /// Alias stack for solving imports.
   list<pair<string, string> > _aliasStack;
@@ -263,9 +366,27 @@ private:
   ///< Rectangle stack for solving region hierarchy.
   list<Rect> _rectStack;
 
+  ///< Source geometry of the regions in #_rectStack.
+  list<map<string, string> > _regionStack;
+
   ///< Reference map for solving the refer attribute in \<media\>.
   map<string, Media *> _referMap;
 
+  ///< Open elements while streaming the document.
+  list<ParserStreamFrame> _streamStack;
+
+  ///< Whether #_xml is a skeleton tree owned by the state.
+  bool _xmlOwned;
+
+  ///< Imported documents processed so far.
+  set<xmlDoc *> _importDocs;
+
+  ///< Imported documents being read, indexed by URI.
+  map<string, ParserImportFetch *> _importFetches;
+
+  ///< Imported bases being processed (innermost last).
+  list<ParserImportRecord *> _importRecords;
+
   string genId ();
   string getURI ();
   bool isInUniqueSet (const string &);
@@ -298,6 +419,14 @@ private:
   size_t eltCacheIndexByTag (const list<string> &, list<ParserElt *> *);
   bool eltCacheAdd (ParserElt *);
 
+  // Imported documents.
+  void importPrefetch (xmlNode *, const string &);
+  shared_ptr<xmlDoc> importJoin (const string &, string *);
+  bool importProcess (ParserElt *, ParserElt *, xmlDoc *, const string &);
+  void importRecordDep (const ParserImportDep &, bool);
+  shared_ptr<ParserImportBase> importSnapshot (ParserImportRecord *);
+  bool importReplay (ParserElt *, const ParserImportBase *);
+
   // Alias stack.
   string aliasStackCombine ();
   bool aliasStackPeek (string *, string *);
@@ -329,9 +458,13 @@ private:
   Predicate *solvePredicate (Predicate *, const map<string, string> *);
 
   // Node processing.
-  ParserSyntaxElt *checkNode (xmlNode *, map<string, string> *,
-                              list<xmlNode *> *);
+  const ParserSyntaxCompiledElt *checkNode (xmlNode *,
+                                            map<string, string> *,
+                                            list<xmlNode *> *);
   bool processNode (xmlNode *);
+  bool processStream (xmlTextReader *);
+  bool startNode (xmlNode *);
+  bool endNode ();
 };
 
 /// Asserted version of UserData::getData().
@@ -369,6 +502,21 @@ typedef struct ParserSyntaxAttr
   int flags;   ///< Processing flags.
 } ParserSyntaxAttr;
 
+/// Maximum number of elements in #parser_syntax_table.
+#define PARSER_SYNTAX_MAX_ELTS 64
+
+/// Maximum number of attributes per element in #parser_syntax_table.
+#define PARSER_SYNTAX_MAX_ATTRS 32
+
+/// Maximum number of distinct attribute names in #parser_syntax_table.
+#define PARSER_SYNTAX_MAX_NAMES 128
+
+/// Bitset indexed by element id.
+typedef bitset<PARSER_SYNTAX_MAX_ELTS> ParserSyntaxEltSet;
+
+/// Bitset indexed by attribute id.
+typedef bitset<PARSER_SYNTAX_MAX_NAMES> ParserSyntaxAttrSet;
+
 /**
  * @brief NCL element syntax.
  */
@@ -435,7 +583,7 @@ typedef enum
   }
 
 /// NCL syntax table (grammar).
-static map<string, ParserSyntaxElt> parser_syntax_table = {
+static const map<string, ParserSyntaxElt> parser_syntax_table = {
   {
       "ncl",                     // element name
       { ParserState::pushNcl,    // push function
@@ -856,31 +1004,210 @@ static map<string, ParserSyntaxElt> parser_syntax_table = {
   },
 };
 
+/// Number of slots in the hash tables of #parser_syntax_compiled (must be
+/// a power of 2).
+#define PARSER_SYNTAX_HASH_SIZE 1024
+
+/// Maximum number of seeds tried when building a perfect hash table.
+#define PARSER_SYNTAX_MAX_SEEDS 65536
+
+/**
+ * @brief Compiled NCL element syntax.
+ */
+typedef struct ParserSyntaxCompiledElt
+{
+  const char *tag;              ///< Element name.
+  int id;                       ///< Element id.
+  const ParserSyntaxElt *syn;   ///< Entry in #parser_syntax_table.
+  ParserSyntaxEltSet parentset; ///< Possible parents (by element id).
+  ParserSyntaxEltSet childset;  ///< Possible children (by element id).
+  ParserSyntaxAttrSet attrset;  ///< Attributes (by attribute id).
+
+  /// Position of attribute in ParserSyntaxElt::attributes (by attribute
+  /// id).
+  guint8 attrpos[PARSER_SYNTAX_MAX_NAMES];
+} ParserSyntaxCompiledElt;
+
+/**
+ * @brief Compiled NCL syntax table.
+ *
+ * Element and attribute names are mapped to ids by perfect hash tables,
+ * whose slots hold the id plus one (zero means empty), so that a lookup
+ * costs one hash and one string comparison.
+ */
+typedef struct ParserSyntaxCompiled
+{
+  guint eltseed;                            ///< Seed of element hash.
+  guint attrseed;                           ///< Seed of attribute hash.
+  guint8 eltslot[PARSER_SYNTAX_HASH_SIZE];  ///< Element ids (by hash).
+  guint8 attrslot[PARSER_SYNTAX_HASH_SIZE]; ///< Attribute ids (by hash).
+
+  /// Attribute names (by attribute id).
+  const char *attrname[PARSER_SYNTAX_MAX_NAMES];
+
+  /// Compiled element syntax (by element id).
+  ParserSyntaxCompiledElt elts[PARSER_SYNTAX_MAX_ELTS];
+} ParserSyntaxCompiled;
+
+/// Hashes tag or attribute name into a slot (seeded FNV-1a).
+static inline guint
+parser_syntax_hash (guint seed, const char *str)
+{
+  guint h = 2166136261u ^ seed;
+  while (*str != '\0')
+    {
+      h ^= (guchar) *str++;
+      h *= 16777619u;
+    }
+  return (h ^ (h >> 16)) & (PARSER_SYNTAX_HASH_SIZE - 1);
+}
+
+/// Finds a seed for which all \p names hash to distinct slots and stores
+/// in \p slot the index of each name plus one.
+static guint
+parser_syntax_perfect_hash (const vector<const char *> &names,
+                            guint8 *slot)
+{
+  g_assert (names.size () < PARSER_SYNTAX_HASH_SIZE / 4);
+  for (guint seed = 0; seed < PARSER_SYNTAX_MAX_SEEDS; seed++)
+    {
+      size_t i;
+
+      for (i = 0; i < PARSER_SYNTAX_HASH_SIZE; i++)
+        slot[i] = 0;
+      for (i = 0; i < names.size (); i++)
+        {
+          guint h = parser_syntax_hash (seed, names[i]);
+          if (slot[h] != 0)
+            break;
+          slot[h] = (guint8) (i + 1);
+        }
+      if (i == names.size ())
+        return seed;
+    }
+  g_assert_not_reached ();
+}
+
+/// Compiles syntax table: assigns element and attribute ids, builds the
+/// perfect hash tables, and fills the parent, children and attribute
+/// sets.  After this, checking a node against the table does no
+/// allocation.
+static ParserSyntaxCompiled
+parser_syntax_table_compile ()
+{
+  ParserSyntaxCompiled syntax = ParserSyntaxCompiled ();
+  vector<const char *> tags;
+  vector<const char *> names;
+  map<string, int> eltids;
+  map<string, int> attrids;
+  int id;
+
+  g_assert (parser_syntax_table.size () <= PARSER_SYNTAX_MAX_ELTS);
+
+  id = 0;
+  for (auto &it : parser_syntax_table)
+    {
+      ParserSyntaxCompiledElt *eltsyn = &syntax.elts[id];
+      int pos = 0;
+
+      g_assert (it.second.attributes.size () <= PARSER_SYNTAX_MAX_ATTRS);
+      eltsyn->tag = it.first.c_str ();
+      eltsyn->id = id;
+      eltsyn->syn = &it.second;
+      eltids[it.first] = id++;
+      tags.push_back (eltsyn->tag);
+
+      for (auto &attrsyn : it.second.attributes)
+        {
+          auto jt = attrids.find (attrsyn.name);
+          int attrid;
+
+          if (jt == attrids.end ())
+            {
+              attrid = (int) names.size ();
+              g_assert (attrid < PARSER_SYNTAX_MAX_NAMES);
+              attrids[attrsyn.name] = attrid;
+              names.push_back (attrsyn.name.c_str ());
+              syntax.attrname[attrid] = attrsyn.name.c_str ();
+            }
+          else
+            {
+              attrid = jt->second;
+            }
+          eltsyn->attrset.set ((size_t) attrid);
+          eltsyn->attrpos[attrid] = (guint8) pos++;
+        }
+    }
+
+  for (auto &it : parser_syntax_table)
+    {
+      int child = eltids[it.first];
+      for (auto &parent : it.second.parents)
+        {
+          auto jt = eltids.find (parent);
+          if (jt == eltids.end ())
+            continue;
+          syntax.elts[child].parentset.set ((size_t) jt->second);
+          syntax.elts[jt->second].childset.set ((size_t) child);
+        }
+    }
+
+  syntax.eltseed = parser_syntax_perfect_hash (tags, syntax.eltslot);
+  syntax.attrseed = parser_syntax_perfect_hash (names, syntax.attrslot);
+
+  return syntax;
+}
+
+/// Compiled syntax table (built once, at load time).
+static const ParserSyntaxCompiled parser_syntax_compiled
+    = parser_syntax_table_compile ();
+
 /// Indexes syntax table.
 static bool
-parser_syntax_table_index (const string &tag, ParserSyntaxElt **result)
+parser_syntax_table_index (const char *tag,
+                           const ParserSyntaxCompiledElt **result)
 {
-  auto it = parser_syntax_table.find (tag);
-  if (it == parser_syntax_table.end ())
+  const ParserSyntaxCompiledElt *eltsyn;
+  guint slot;
+
+  slot = parser_syntax_compiled.eltslot[parser_syntax_hash (
+      parser_syntax_compiled.eltseed, tag)];
+  if (slot == 0)
+    return false;
+
+  eltsyn = &parser_syntax_compiled.elts[slot - 1];
+  if (!g_str_equal (eltsyn->tag, tag))
     return false;
-  tryset (result, &it->second);
+
+  tryset (result, eltsyn);
   return true;
 }
 
-/// Gets possible children of a given element.
-static map<string, bool>
-parser_syntax_table_get_possible_children (const string &tag)
+/// Indexes attribute syntax of a given element.  Returns the position of
+/// attribute in the element's attribute list, or -1 if the element has
+/// no such attribute.
+static int
+parser_syntax_table_index_attribute (const ParserSyntaxCompiledElt *eltsyn,
+                                     const char *name)
 {
-  map<string, bool> result;
-  for (auto it : parser_syntax_table)
-    for (auto parent : it.second.parents)
-      if (parent == tag)
-        result[it.first] = true;
-  return result;
+  guint slot;
+  guint id;
+
+  slot = parser_syntax_compiled.attrslot[parser_syntax_hash (
+      parser_syntax_compiled.attrseed, name)];
+  if (slot == 0)
+    return -1;
+
+  id = slot - 1;
+  if (!eltsyn->attrset.test (id)
+      || !g_str_equal (parser_syntax_compiled.attrname[id], name))
+    return -1;
+
+  return eltsyn->attrpos[id];
 }
 
 /// Reserved connector roles.
-static map<string, pair<Event::Type, Event::Transition> >
+static const map<string, pair<Event::Type, Event::Transition> >
     parser_syntax_reserved_role_table = {
       { "onBegin", { Event::PRESENTATION, Event::START } }, // conditions
       { "onEnd", { Event::PRESENTATION, Event::STOP } },
@@ -918,7 +1245,7 @@ parser_syntax_reserved_role_table_index (const string &role,
 }
 
 /// Known event types.
-static map<string, Event::Type> parser_syntax_event_type_table = {
+static const map<string, Event::Type> parser_syntax_event_type_table = {
   { "presentation", Event::PRESENTATION },
   { "attribution", Event::ATTRIBUTION },
   { "selection", Event::SELECTION },
@@ -926,7 +1253,7 @@ static map<string, Event::Type> parser_syntax_event_type_table = {
 };
 
 /// Known transitions.
-static map<string, Event::Transition> parser_syntax_transition_table = {
+static const map<string, Event::Transition> parser_syntax_transition_table = {
   { "start", Event::START },   { "starts", Event::START },
   { "pause", Event::PAUSE },   { "pauses", Event::PAUSE },
   { "resume", Event::RESUME }, { "resumes", Event::RESUME },
@@ -935,14 +1262,14 @@ static map<string, Event::Transition> parser_syntax_transition_table = {
 };
 
 /// Known logical connectives.
-static map<string, Predicate::Type> parser_syntax_connective_table = {
+static const map<string, Predicate::Type> parser_syntax_connective_table = {
   { "not", Predicate::NEGATION },
   { "and", Predicate::CONJUNCTION },
   { "or", Predicate::DISJUNCTION },
 };
 
 /// Known string comparators.
-static map<string, Predicate::Test> parser_syntax_comparator_table = {
+static const map<string, Predicate::Test> parser_syntax_comparator_table = {
   { "eq", Predicate::EQ },  // ==
   { "ne", Predicate::NE },  // !=
   { "lt", Predicate::LT },  // <
@@ -1129,6 +1456,8 @@ void
 ParserState::addToUniqueSet (const string &id)
 {
   _unique.insert (id);
+  for (auto rec : _importRecords)
+    rec->ids.push_back (id);
 }
 
 /**
@@ -1403,20 +1732,17 @@ bool
 ParserState::eltCacheIndexById (const string &id, ParserElt **elt,
                                 const list<string> &tags)
 {
-  for (auto tag : tags)
+  for (auto &tag : tags)
     {
-      auto it = _eltCacheByTag.find (tag);
-      if (it == _eltCacheByTag.end ())
+      auto it = _eltCacheById.find (tag);
+      if (it == _eltCacheById.end ())
         continue;
-      for (auto other : it->second)
-        {
-          string other_id;
-          if (other->getAttribute ("id", &other_id) && other_id == id)
-            {
-              tryset (elt, other);
-              return true;
-            }
-        }
+      auto it_id = it->second.find (id);
+      if (it_id == it->second.end ())
+        continue;
+      g_assert_nonnull (it_id->second);
+      tryset (elt, it_id->second);
+      return true;
     }
   return false;
 }
@@ -1456,12 +1782,20 @@ bool
 ParserState::eltCacheAdd (ParserElt *elt)
 {
   xmlNode *node;
+  string id;
 
   node = elt->getNode ();
-  if (_eltCache.find (node) != _eltCache.end ())
+  if (!_eltCache.insert (std::make_pair (node, elt)).second)
     return false;
-  _eltCache[node] = elt;
   _eltCacheByTag[elt->getTag ()].push_back (elt);
+  for (auto rec : _importRecords)
+    rec->elts.push_back (elt);
+
+  // Ids are resolved by checkNode() before elements are cached, so the id
+  // index never goes stale.  On duplicates the first element wins, as in
+  // document order.
+  if (elt->getAttribute ("id", &id))
+    _eltCacheById[elt->getTag ()].insert (std::make_pair (id, elt));
   return true;
 }
 
@@ -2006,54 +2340,65 @@ ParserState::solvePredicate (Predicate *pred, const map<string, string> *tr)
  * @return Pointer to entry in syntax table if successful, otherwise returns
  * \c nullptr and sets #Parser error accordingly.
  */
-ParserSyntaxElt *
+const ParserSyntaxCompiledElt *
 ParserState::checkNode (xmlNode *node, map<string, string> *attrs,
                         list<xmlNode *> *children)
 {
-  string tag;
-  ParserSyntaxElt *eltsyn;
-  map<string, bool> possible;
+  const ParserSyntaxCompiledElt *eltsyn;
+  xmlAttr *found[PARSER_SYNTAX_MAX_ATTRS];
+  xmlAttr *unknown;
+  int i;
 
   g_assert_nonnull (node);
-  tag = toCPPString (node->name);
 
   // Check if element is known.
-  if (unlikely (!parser_syntax_table_index (tag, &eltsyn)))
+  if (unlikely (!parser_syntax_table_index (toCString (node->name),
+                                            &eltsyn)))
     return (this->errEltUnknown (node), nullptr);
 
   // Check parent.
   g_assert_nonnull (node->parent);
-  if (eltsyn->parents.size () > 0)
+  if (eltsyn->syn->parents.size () > 0)
     {
-      string parent;
-      bool found;
+      const ParserSyntaxCompiledElt *parsyn;
 
       if (unlikely (node->parent->type != XML_ELEMENT_NODE))
         return (this->errEltMissingParent (node), nullptr);
 
-      parent = toCPPString (node->parent->name);
-      found = false;
-      for (auto par : eltsyn->parents)
+      if (unlikely (!parser_syntax_table_index (
+                        toCString (node->parent->name), &parsyn)
+                    || !eltsyn->parentset.test ((size_t) parsyn->id)))
+        return (this->errEltBadParent (node), nullptr);
+    }
+
+  // Match node attributes against syntax.
+  for (i = 0; i < (int) eltsyn->syn->attributes.size (); i++)
+    found[i] = nullptr;
+  unknown = nullptr;
+  for (xmlAttr *prop = node->properties; prop != nullptr; prop = prop->next)
+    {
+      i = parser_syntax_table_index_attribute (eltsyn,
+                                               toCString (prop->name));
+      if (i < 0)
         {
-          if (parent == par)
-            {
-              found = true;
-              break;
-            }
+          if (unknown == nullptr)
+            unknown = prop;
+          continue;
         }
-      if (unlikely (!found))
-        return (this->errEltBadParent (node), nullptr);
+      if (found[i] == nullptr)
+        found[i] = prop;
     }
 
   // Collect attributes.
-  for (auto attrsyn : eltsyn->attributes)
+  i = 0;
+  for (auto &attrsyn : eltsyn->syn->attributes)
     {
+      xmlAttr *prop = found[i++];
       string value;
-      string explain;
 
-      if (!xmlGetPropAsString (node, attrsyn.name, &value)) // not found
+      if (prop == nullptr) // not found
         {
-          if (attrsyn.name == "id" && eltsyn->flags & ELT_GEN_ID)
+          if (attrsyn.name == "id" && eltsyn->syn->flags & ELT_GEN_ID)
             {
               if (attrs != nullptr)
                 (*attrs)["id"] = this->genId ();
@@ -2070,6 +2415,7 @@ ParserState::checkNode (xmlNode *node, map<string, string> *attrs,
             }
         }
 
+      xmlAttrGetValueAsString (prop, &value);
       if (unlikely ((attrsyn.flags & ATTR_NONEMPTY) && value == ""))
         {
           return (this->errEltBadAttribute (node, attrsyn.name, value,
@@ -2114,27 +2460,29 @@ ParserState::checkNode (xmlNode *node, map<string, string> *attrs,
     }
 
   // Check for unknown attributes.
-  if (attrs != nullptr)
+  if (unlikely (attrs != nullptr && unknown != nullptr))
     {
-      for (xmlAttr *prop = node->properties; prop != nullptr;
-           prop = prop->next)
-        {
-          string name = toCPPString (prop->name);
-          if (unlikely (attrs->find (name) == attrs->end ()))
-            return (this->errEltUnknownAttribute (node, name), nullptr);
-        }
+      return (this->errEltUnknownAttribute (node,
+                                            toCPPString (unknown->name)),
+              nullptr);
     }
 
   // Collect children.
-  possible = parser_syntax_table_get_possible_children (tag);
   for (xmlNode *child = node->children; child; child = child->next)
     {
+      const ParserSyntaxCompiledElt *childsyn;
+
       if (child->type != XML_ELEMENT_NODE)
         continue;
 
-      string child_tag = toCPPString (child->name);
-      if (unlikely (possible.find (child_tag) == possible.end ()))
-        return (this->errEltUnknownChild (node, child_tag), nullptr);
+      if (unlikely (!parser_syntax_table_index (toCString (child->name),
+                                                &childsyn)
+                    || !eltsyn->childset.test ((size_t) childsyn->id)))
+        {
+          return (this->errEltUnknownChild (node,
+                                            toCPPString (child->name)),
+                  nullptr);
+        }
 
       if (children != nullptr)
         children->push_back (child);
@@ -2146,13 +2494,13 @@ ParserState::checkNode (xmlNode *node, map<string, string> *attrs,
 /**
  * @brief Processes node.
  *
- * After being called by ParserState::process(), starting from the root
- * node, this function proceeds recursively, processing each node in the
- * input document tree.  For each node, it checks its syntax (according to
- * #parser_syntax_table), calls the corresponding push function (if any),
- * processes the node's children, and calls the corresponding pop function
- * (if any).  At any moment, if something goes wrong the function sets
- * #Parser error and returns false.
+ * After being called by ParserState::pushImportBase(), starting from the
+ * imported base node, this function proceeds recursively, processing each
+ * node in the imported document tree.  For each node, it checks its syntax
+ * (according to #parser_syntax_table), calls the corresponding push
+ * function (if any), processes the node's children, and calls the
+ * corresponding pop function (if any).  At any moment, if something goes
+ * wrong the function sets #Parser error and returns false.
  *
  * @param node The node to process.
  * @return \c true if successful, or \c false otherwise.
@@ -2162,7 +2510,7 @@ ParserState::processNode (xmlNode *node)
 {
   map<string, string> attrs;
   list<xmlNode *> children;
-  ParserSyntaxElt *eltsyn;
+  const ParserSyntaxCompiledElt *eltsyn;
   ParserElt *elt;
   bool cached;
   bool status;
@@ -2182,14 +2530,15 @@ ParserState::processNode (xmlNode *node)
   status = true;
 
   // Push element.
-  if (unlikely (eltsyn->push != nullptr && !eltsyn->push (this, elt)))
+  if (unlikely (eltsyn->syn->push != nullptr
+                && !eltsyn->syn->push (this, elt)))
     {
       status = false;
       goto done;
     }
 
   // Save element into cache.
-  if (eltsyn->flags & ELT_CACHE)
+  if (eltsyn->syn->flags & ELT_CACHE)
     {
       cached = true;
       g_assert (this->eltCacheAdd (elt));
@@ -2206,7 +2555,8 @@ ParserState::processNode (xmlNode *node)
     }
 
   // Pop element.
-  if (unlikely (eltsyn->pop != nullptr && !eltsyn->pop (this, elt)))
+  if (unlikely (eltsyn->syn->pop != nullptr
+                && !eltsyn->syn->pop (this, elt)))
     {
       status = false;
       goto done;
@@ -2218,6 +2568,113 @@ done:
   return status;
 }
 
+/**
+ * @brief Starts the processing of a streamed node.
+ *
+ * Called by ParserState::process() when the reader enters an element.
+ * Does the same as ParserState::processNode() up to (and
+ * including) the push function, except that the resulting element wrapper
+ * is bound to a skeleton copy of \p node, which holds no attributes nor
+ * text and thus outlives the reader's node.  The element is left open
+ * until the matching call to ParserState::endNode().
+ *
+ * @param node The reader's current node.
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+ParserState::startNode (xmlNode *node)
+{
+  map<string, string> attrs;
+  const ParserSyntaxCompiledElt *eltsyn;
+  ParserStreamFrame frame;
+  xmlNode *skel;
+  string tag;
+
+  g_assert_nonnull (node);
+  tag = toCPPString (node->name);
+
+  // Check if node is a possible child of current element.
+  if (!_streamStack.empty ())
+    {
+      ParserStreamFrame *parent = &_streamStack.back ();
+      const ParserSyntaxCompiledElt *childsyn;
+      if (unlikely (!parser_syntax_table_index (tag.c_str (), &childsyn)
+                    || !parent->eltsyn->childset.test (
+                        (size_t) childsyn->id)))
+        return this->errEltUnknownChild (parent->elt->getNode (), tag);
+    }
+
+  // Check node.
+  eltsyn = this->checkNode (node, &attrs, nullptr);
+  if (unlikely (eltsyn == nullptr))
+    return false;
+
+  // Create skeleton node.
+  skel = xmlNewDocNode (_xml, nullptr, node->name, nullptr);
+  g_assert_nonnull (skel);
+  skel->line = node->line;
+  if (_streamStack.empty ())
+    xmlDocSetRootElement (_xml, skel);
+  else
+    g_assert_nonnull (xmlAddChild (_streamStack.back ().elt->getNode (),
+                                   skel));
+
+  // Allocate and initialize element wrapper.
+  frame.elt = new ParserElt (skel);
+  for (auto it : attrs)
+    g_assert (frame.elt->setAttribute (it.first, it.second));
+  frame.eltsyn = eltsyn;
+  frame.cached = false;
+
+  // Push element.
+  if (unlikely (eltsyn->syn->push != nullptr
+                && !eltsyn->syn->push (this, frame.elt)))
+    {
+      delete frame.elt;
+      return false;
+    }
+
+  // Save element into cache.
+  if (eltsyn->syn->flags & ELT_CACHE)
+    {
+      frame.cached = true;
+      g_assert (this->eltCacheAdd (frame.elt));
+    }
+
+  _streamStack.push_back (frame);
+  return true;
+}
+
+/**
+ * @brief Ends the processing of a streamed node.
+ *
+ * Called by ParserState::process() when the reader leaves the innermost
+ * open element.  Calls the corresponding pop function (if any).
+ *
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+ParserState::endNode ()
+{
+  ParserStreamFrame frame;
+  bool status;
+
+  g_assert_false (_streamStack.empty ());
+  frame = _streamStack.back ();
+  _streamStack.pop_back ();
+
+  status = true;
+  if (unlikely (frame.eltsyn->syn->pop != nullptr
+                && !frame.eltsyn->syn->pop (this, frame.elt)))
+    {
+      status = false;
+    }
+
+  if (!frame.cached)
+    delete frame.elt;
+  return status;
+}
+
 // ParserState: public.
 
 /**
@@ -2229,10 +2686,13 @@ done:
 ParserState::ParserState (int width, int height)
 {
   _doc = nullptr;
+  _editCtx = nullptr;
   _xml = nullptr;
+  _xmlOwned = false;
   g_assert_cmpint (width, >, 0);
   g_assert_cmpint (height, >, 0);
   _genid = 0;
+  _zorder = 0;
   _error = ParserState::ERROR_NONE;
   _errorMsg = "no error";
   this->rectStackPush ({ 0, 0, width, height });
@@ -2245,6 +2705,22 @@ ParserState::~ParserState ()
 {
   for (auto it : _eltCache)
     delete it.second;
+  for (auto &frame : _streamStack)
+    if (!frame.cached)
+      delete frame.elt;
+  if (_xmlOwned)
+    xmlFreeDoc (_xml);
+  for (auto &it : _importFetches)
+    {
+      ParserImportFetch *fetch = it.second;
+      g_mutex_lock (&fetch->mutex);
+      while (!fetch->done)
+        g_cond_wait (&fetch->cond, &fetch->mutex);
+      g_mutex_unlock (&fetch->mutex);
+      g_mutex_clear (&fetch->mutex);
+      g_cond_clear (&fetch->cond);
+      delete fetch;
+    }
 }
 
 /**
@@ -2260,28 +2736,26 @@ ParserState::getError (string *message)
 }
 
 /**
- * @brief Processes XML document.
+ * @brief Processes XML document as it is read.
  *
- * This function is a wrapper over ParserState::processNode().  It calls the
- * later with the root node of the given XML document and, if nothing goes
- * wrong, returns the resulting document.
+ * Instead of waiting for the whole DOM tree, this function pushes and pops
+ * each element as soon as the reader enters and leaves it, and lets the
+ * reader discard the nodes already processed.  The only tree kept is a
+ * skeleton of element names and line numbers, used to report errors and to
+ * index the element cache.  Forward references are solved by the pop
+ * functions (mostly ParserState::popNcl()), once the referenced elements
+ * are in the cache.
  *
- * @param xml The XML document to process.
+ * @param reader The XML reader to process.
  * @return The resulting #Document if successful, or null otherwise.
  */
 Document *
-ParserState::process (xmlDoc *xml)
+ParserState::process (xmlTextReader *reader)
 {
-  xmlNode *root;
-
-  g_assert_nonnull (xml);
-  _xml = xml;
+  g_assert_null (_doc);
   _doc = new Document ();
 
-  root = xmlDocGetRootElement (xml);
-  g_assert_nonnull (root);
-
-  if (unlikely (!this->processNode (root)))
+  if (unlikely (!this->processStream (reader)))
     {
       delete _doc;
       _doc = nullptr;
@@ -2292,68 +2766,277 @@ ParserState::process (xmlDoc *xml)
   return _doc;
 }
 
-// ParserState: push & pop.
-
 /**
- * @brief Starts the processing of \<ncl\> element.
- * @param st #ParserState.
- * @param elt Element wrapper.
+ * @brief Processes NCL editing fragment over a live context.
+ *
+ * Same as ParserState::process(), except that the objects and links in
+ * the \<body\> of the streamed document are added to \p ctx, which must
+ * be in a running #Document.  If processing fails, the children added to
+ * \p ctx are removed and destroyed.
+ *
+ * @param reader The XML reader to process.
+ * @param ctx The context to edit.
  * @return \c true if successful, or \c false otherwise.
  */
 bool
-ParserState::pushNcl (ParserState *st, ParserElt *elt)
+ParserState::processEdit (xmlTextReader *reader, Context *ctx)
 {
-  Context *root;
-  string *id = new string ();
+  set<Object *> saved;
 
-  root = st->_doc->getRoot ();
-  g_assert_nonnull (root);
+  g_assert_null (_doc);
+  g_assert_nonnull (ctx);
+  _doc = ctx->getDocument ();
+  g_assert_nonnull (_doc);
+  _editCtx = ctx;
 
-  if (elt->getAttribute ("id", id))
+  saved = *ctx->getChildren ();
+  if (unlikely (!this->processStream (reader)))
     {
-      root->addAlias (*id);
-      st->_doc->setData ("id", id, xstrdelete);
+      list<Object *> added;
+      for (auto child : *ctx->getChildren ())
+        if (saved.find (child) == saved.end ())
+          added.push_back (child);
+      for (auto child : added)
+        {
+          ctx->removeChild (child);
+          delete child;
+        }
+      return false;
     }
 
-  st->objStackPush (root);
   return true;
 }
 
 /**
- * @brief Ends the processing of \<ncl\> element.
- *
- * This function resolves all non-local references.
- *
- * @param st #ParserState.
- * @param elt Element wrapper.
+ * @brief Streams XML document into the current #Document.
+ * @param reader The XML reader to process.
  * @return \c true if successful, or \c false otherwise.
  */
 bool
-ParserState::popNcl (ParserState *st, unused (ParserElt *elt))
+ParserState::processStream (xmlTextReader *reader)
 {
-  list<ParserElt *> desc_list;
-  list<ParserElt *> media_list;
-  list<ParserElt *> switch_list;
-  list<ParserElt *> link_list;
+  int ret;
+  bool status;
 
-  // Resolve descriptor references to region/transition.
-  // (I.e., move region/transition attributes to associated descriptor.)
-  if (st->eltCacheIndexByTag ({ "descriptor" }, &desc_list) > 0)
+  g_assert_nonnull (reader);
+  g_assert_nonnull (_doc);
+  ret = 0;
+  g_assert_null (_xml);
+  _xml = xmlNewDoc (BAD_CAST "1.0");
+  g_assert_nonnull (_xml);
+  _xmlOwned = true;
+
+  status = true;
+  while (status && (ret = xmlTextReaderRead (reader)) == 1)
     {
-      for (auto desc_elt : desc_list)
+      switch (xmlTextReaderNodeType (reader))
         {
-          string region_id;
-          ParserElt *region_elt;
-
-          static const string trans_attr[] = { "transIn", "transOut" };
-          string trans_id;
-          ParserElt *trans_elt;
-
-          string desc_id;
-          g_assert (desc_elt->getAttribute ("id", &desc_id));
+        case XML_READER_TYPE_ELEMENT:
+          {
+            xmlNode *node = xmlTextReaderCurrentNode (reader);
+            g_assert_nonnull (node);
+            if (_xml->URL == nullptr && node->doc->URL != nullptr)
+              _xml->URL = xmlStrdup (node->doc->URL);
+
+            // Expand <head> in advance to start reading its imports.
+            // Keep a copy of it for processing editing commands later.
+            if (xmlTextReaderDepth (reader) == 1
+                && xmlStrEqual (node->name, BAD_CAST "head")
+                && xmlTextReaderExpand (reader) != nullptr)
+              {
+                this->importPrefetch (node, this->getURI ());
+                if (_editCtx == nullptr)
+                  {
+                    xmlBuffer *buf = xmlBufferCreate ();
+                    g_assert_nonnull (buf);
+                    if (xmlNodeDump (buf, node->doc, node, 0, 0) >= 0)
+                      {
+                        _doc->setData (
+                            "head",
+                            new string (
+                                (const char *) xmlBufferContent (buf),
+                                (size_t) xmlBufferLength (buf)),
+                            xstrdelete);
+                      }
+                    xmlBufferFree (buf);
+                  }
+              }
 
-          if (desc_elt->getAttribute ("region", &region_id))
-            {
+            status = this->startNode (node);
+            if (status && xmlTextReaderIsEmptyElement (reader))
+              status = this->endNode ();
+            break;
+          }
+        case XML_READER_TYPE_END_ELEMENT:
+          {
+            status = this->endNode ();
+            break;
+          }
+        default:
+          break;
+        }
+    }
+
+  if (status && (ret < 0 || xmlDocGetRootElement (_xml) == nullptr))
+    {
+      xmlError *err = xmlGetLastError ();
+      _error = ParserState::ERROR_XML;
+      _errorMsg = (err != nullptr) ? xmlGetLastErrorAsString ()
+                                   : "XML error: Document is empty";
+      status = false;
+    }
+
+  if (unlikely (!status))
+    return false;
+
+  g_assert (_streamStack.empty ());
+  return true;
+}
+
+// Region geometry.
+
+/// Geometry attributes of \<region\>, in resolution order.
+static const char *parser_region_attrs[] = {
+  "left", "top", "width", "height", "right", "bottom",
+};
+
+/// Prefix of the attributes that keep the source geometry of a region
+/// (see #ParserRegion): "_region.N.NAME" is attribute NAME of the N-th
+/// region in the chain.
+#define PARSER_REGION_PREFIX "_region."
+
+/// Resolves the geometry attributes \p attrs of a region into a rectangle,
+/// given the rectangle \p parent of its parent region (or screen).
+static Rect
+parser_region_resolve (Rect parent, const map<string, string> &attrs)
+{
+  Rect rect = parent;
+
+  for (auto name : parser_region_attrs)
+    {
+      auto it = attrs.find (name);
+      if (it == attrs.end ())
+        continue;
+
+      const string &str = it->second;
+      if (g_str_equal (name, "left"))
+        rect.x += ginga::parse_percent (str, parent.width, 0, G_MAXINT);
+      else if (g_str_equal (name, "top"))
+        rect.y += ginga::parse_percent (str, parent.height, 0, G_MAXINT);
+      else if (g_str_equal (name, "width"))
+        rect.width = ginga::parse_percent (str, parent.width, 0, G_MAXINT);
+      else if (g_str_equal (name, "height"))
+        rect.height
+            = ginga::parse_percent (str, parent.height, 0, G_MAXINT);
+      else if (g_str_equal (name, "right"))
+        rect.x += parent.width - rect.width
+                  - ginga::parse_percent (str, parent.width, 0, G_MAXINT);
+      else if (g_str_equal (name, "bottom"))
+        rect.y += parent.height - rect.height
+                  - ginga::parse_percent (str, parent.height, 0, G_MAXINT);
+    }
+  return rect;
+}
+
+/// Converts region rectangle \p rect into percentages of \p screen.
+static void
+parser_region_percent (Rect rect, Rect screen, map<string, string> *geom)
+{
+  (*geom)["left"] = xstrbuild ("%g%%", ((double) rect.x / screen.width)
+                                           * 100.);
+  (*geom)["top"] = xstrbuild ("%g%%", ((double) rect.y / screen.height)
+                                          * 100.);
+  (*geom)["width"] = xstrbuild (
+      "%g%%", ((double) rect.width / screen.width) * 100.);
+  (*geom)["height"] = xstrbuild (
+      "%g%%", ((double) rect.height / screen.height) * 100.);
+}
+
+/// Cleans up the #ParserRegion map attached to #Document.
+static void
+regionsCleanup (void *ptr)
+{
+  delete (map<string, ParserRegion> *) ptr;
+}
+
+// ParserState: push & pop.
+
+/**
+ * @brief Starts the processing of \<ncl\> element.
+ * @param st #ParserState.
+ * @param elt Element wrapper.
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+ParserState::pushNcl (ParserState *st, ParserElt *elt)
+{
+  Context *root;
+  string *id;
+
+  // When editing, the body stands for the edited context.
+  if (st->_editCtx != nullptr)
+    {
+      st->objStackPush (st->_editCtx);
+      return true;
+    }
+
+  root = st->_doc->getRoot ();
+  g_assert_nonnull (root);
+
+  // Compiled documents locate their contents relative to it.
+  if (st->getURI () != "")
+    st->_doc->setData ("uri", new string (st->getURI ()), xstrdelete);
+
+  id = new string ();
+  if (elt->getAttribute ("id", id))
+    {
+      root->addAlias (*id);
+      st->_doc->setData ("id", id, xstrdelete);
+    }
+  else
+    {
+      delete id;
+    }
+
+  st->objStackPush (root);
+  return true;
+}
+
+/**
+ * @brief Ends the processing of \<ncl\> element.
+ *
+ * This function resolves all non-local references.
+ *
+ * @param st #ParserState.
+ * @param elt Element wrapper.
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+ParserState::popNcl (ParserState *st, unused (ParserElt *elt))
+{
+  list<ParserElt *> desc_list;
+  list<ParserElt *> media_list;
+  list<ParserElt *> switch_list;
+  list<ParserElt *> link_list;
+
+  // Resolve descriptor references to region/transition.
+  // (I.e., move region/transition attributes to associated descriptor.)
+  if (st->eltCacheIndexByTag ({ "descriptor" }, &desc_list) > 0)
+    {
+      for (auto desc_elt : desc_list)
+        {
+          string region_id;
+          ParserElt *region_elt;
+
+          static const string trans_attr[] = { "transIn", "transOut" };
+          string trans_id;
+          ParserElt *trans_elt;
+
+          string desc_id;
+          g_assert (desc_elt->getAttribute ("id", &desc_id));
+
+          if (desc_elt->getAttribute ("region", &region_id))
+            {
               if (unlikely (!st->eltCacheIndexById (region_id, &region_elt,
                                                     { "region" })))
                 {
@@ -2440,6 +3123,8 @@ borderColor='%s'}",
 
           string desc_id;
           string refer;
+          map<int, map<string, string> > levels;
+          ParserRegion region;
 
           // Move descriptor attributes.
           if (media_elt->getAttribute ("descriptor", &desc_id))
@@ -2463,10 +3148,40 @@ borderColor='%s'}",
                 {
                   if (it.first == "id" || it.first == "region")
                     continue; // nothing to do
+                  if (xstrhasprefix (it.first, PARSER_REGION_PREFIX))
+                    {
+                      string key = it.first.substr (
+                          strlen (PARSER_REGION_PREFIX));
+                      size_t dot = key.find ('.');
+                      g_assert (dot != string::npos);
+                      levels[xstrtoint (key.substr (0, dot), 10)]
+                                [key.substr (dot + 1)]
+                          = it.second;
+                      continue; // source geometry of region
+                    }
                   if (media->getAttributionEvent (it.first) != nullptr)
                     continue; // already defined
                   media->addAttributionEvent (it.first);
                   media->setProperty (it.first, it.second);
+                  if (it.first == "left" || it.first == "top"
+                      || it.first == "width" || it.first == "height")
+                    region.props.insert (it.first);
+                }
+
+              // Keep the source geometry of the region, if used.
+              if (!levels.empty () && !region.props.empty ())
+                {
+                  map<string, ParserRegion> *regions;
+
+                  for (auto &it : levels)
+                    region.chain.push_back (it.second);
+                  if (!st->_doc->getData ("regions", (void **) &regions))
+                    {
+                      regions = new map<string, ParserRegion> ();
+                      st->_doc->setData ("regions", regions,
+                                         regionsCleanup);
+                    }
+                  (*regions)[media->getId ()] = region;
                 }
             }
 
@@ -2475,9 +3190,13 @@ borderColor='%s'}",
             {
               ParserElt *refer_elt;
 
-              if (unlikely (!st->eltCacheIndexById (refer, &refer_elt,
-                                                    { "media" })))
+              if (!st->eltCacheIndexById (refer, &refer_elt, { "media" }))
                 {
+                  // When editing, refer may point to a live media object.
+                  if (st->_editCtx != nullptr
+                      && instanceof (Media *,
+                                     st->_doc->getObjectByIdOrAlias (refer)))
+                    continue;
                   return st->errEltBadAttribute (media_elt->getNode (),
                                                  "refer", refer,
                                                  "no such media object");
@@ -2566,6 +3285,7 @@ borderColor='%s'}",
         {
           string conn_id;
           ParserElt *conn_elt;
+          string link_id;
           set<string> *tests;
           list<ParserConnRole> *roles;
           list<ParserLinkBind> *binds;
@@ -2831,7 +3551,8 @@ borderColor='%s'}",
               else
                 actions.push_back (act);
             }
-          ctx->addLink (conditions, actions);
+          g_assert (link_elt->getAttribute ("id", &link_id));
+          ctx->addLink (conditions, actions, link_id);
         }
     }
 
@@ -2844,7 +3565,8 @@ borderColor='%s'}",
  *
  * This function uses the initial screen dimensions stored in #ParserState
  * to convert into absolute values any relative values used in \<region\>
- * attributes.
+ * attributes.  The source values of the region and its ancestors are kept
+ * in "_region.*" attributes (see #ParserRegion).
  *
  * @fn ParserState::pushRegion
  * @param st #ParserState.
@@ -2854,57 +3576,41 @@ borderColor='%s'}",
 bool
 ParserState::pushRegion (ParserState *st, ParserElt *elt)
 {
-  static int last_zorder = 0;
   xmlNode *parent_node;
   Rect screen;
-  Rect parent;
   Rect rect;
   string str;
+  map<string, string> attrs;
+  map<string, string> geom;
+  int i;
 
   parent_node = elt->getParentNode ();
   g_assert_nonnull (parent_node);
 
+  for (auto name : parser_region_attrs)
+    if (elt->getAttribute (name, &str))
+      attrs[name] = str;
+
   screen = st->_rectStack.front ();
-  rect = parent = st->rectStackPeek ();
-  if (elt->getAttribute ("left", &str))
-    {
-      rect.x += ginga::parse_percent (str, parent.width, 0, G_MAXINT);
-    }
-  if (elt->getAttribute ("top", &str))
-    {
-      rect.y += ginga::parse_percent (str, parent.height, 0, G_MAXINT);
-    }
-  if (elt->getAttribute ("width", &str))
-    {
-      rect.width = ginga::parse_percent (str, parent.width, 0, G_MAXINT);
-    }
-  if (elt->getAttribute ("height", &str))
-    {
-      rect.height = ginga::parse_percent (str, parent.height, 0, G_MAXINT);
-    }
-  if (elt->getAttribute ("right", &str))
-    {
-      rect.x += parent.width - rect.width
-                - ginga::parse_percent (str, parent.width, 0, G_MAXINT);
-    }
-  if (elt->getAttribute ("bottom", &str))
+  rect = parser_region_resolve (st->rectStackPeek (), attrs);
+  st->rectStackPush (rect);
+  st->_regionStack.push_back (attrs);
+
+  i = 0;
+  for (auto &level : st->_regionStack)
     {
-      rect.y += parent.height - rect.height
-                - ginga::parse_percent (str, parent.height, 0, G_MAXINT);
+      for (auto &it : level)
+        elt->setAttribute (xstrbuild (PARSER_REGION_PREFIX "%d.%s", i,
+                                      it.first.c_str ()),
+                           it.second);
+      i++;
     }
 
   // Update region position to absolute values.
-  st->rectStackPush (rect);
-  double left = ((double) rect.x / screen.width) * 100.;
-  double top = ((double) rect.y / screen.height) * 100.;
-  double width = ((double) rect.width / screen.width) * 100.;
-  double height = ((double) rect.height / screen.height) * 100.;
-
-  elt->setAttribute ("zOrder", xstrbuild ("%d", last_zorder++));
-  elt->setAttribute ("left", xstrbuild ("%g%%", left));
-  elt->setAttribute ("top", xstrbuild ("%g%%", top));
-  elt->setAttribute ("width", xstrbuild ("%g%%", width));
-  elt->setAttribute ("height", xstrbuild ("%g%%", height));
+  parser_region_percent (rect, screen, &geom);
+  elt->setAttribute ("zOrder", xstrbuild ("%d", st->_zorder++));
+  for (auto &it : geom)
+    elt->setAttribute (it.first, it.second);
 
   return true;
 }
@@ -2919,6 +3625,7 @@ bool
 ParserState::popRegion (ParserState *st, unused (ParserElt *elt))
 {
   st->rectStackPop ();
+  st->_regionStack.pop_back ();
   return true;
 }
 
@@ -3429,7 +4136,23 @@ ParserState::pushRule (ParserState *st, ParserElt *elt)
  * @brief Starts the processing of \<importBase\> element.
  *
  * This function uses the #ParserState alias stack to collect and process
- * nested imports.
+ * nested imports.  Imported documents are read through a process-wide
+ * cache (see parser_import_cache_read()), so that a base imported by many
+ * documents is read and parsed only once.  The cached tree is shared
+ * read-only between parses.
+ *
+ * The processed base (regions, descriptors, connectors, rules, etc.) is
+ * also cached process-wide, keyed by the canonical path of the imported
+ * document, the kind of base, the import alias and the screen size (see
+ * parser_import_base_lookup()).  If the imported document and the
+ * documents it imports have the same mtime (in microseconds) and size as
+ * when the base was processed, the base is replayed (see
+ * ParserState::importReplay()) instead of being processed again.
+ *
+ * The imports of a \<head\> are read concurrently by a pool of worker
+ * threads as soon as the \<head\> is seen (see
+ * ParserState::importPrefetch()); this function only waits for the
+ * document it needs.
  *
  * @fn ParserState::pushImportBase
  * @param st #ParserState.
@@ -3439,64 +4162,366 @@ ParserState::pushRule (ParserState *st, ParserElt *elt)
  * @todo Check for circular imports.
  */
 
-/// Cleans up the document associated with \<importBase\> element.
+/// Maximum number of documents in the cache of imported documents.
+#define PARSER_IMPORT_CACHE_MAX 32
+
+/// Entry in the cache of imported documents.
+typedef struct ParserImportCacheEntry
+{
+  shared_ptr<xmlDoc> xml; ///< Imported document (read-only).
+  guint64 mtime;          ///< Modification time of source file (in usec).
+  goffset size;           ///< Size of source file.
+  guint64 used;           ///< Value of #parser_import_cache_clock at last use.
+} ParserImportCacheEntry;
+
+/// Cache of imported documents indexed by canonical path.
+static map<string, ParserImportCacheEntry> parser_import_cache;
+static guint64 parser_import_cache_clock;
+G_LOCK_DEFINE_STATIC (parser_import_cache);
+
+/// Gets the canonical path, mtime (in microseconds) and size of the local
+/// file at \p uri.  Returns false if \p uri is not a local file.
+static bool
+parser_import_stat (const string &uri, string *path, guint64 *mtime,
+                    goffset *size)
+{
+  GFile *file;
+  GFileInfo *info;
+  gchar *str;
+
+  // GFile paths are canonical: "." and ".." are already resolved.
+  file = g_file_new_for_uri (uri.c_str ());
+  g_assert_nonnull (file);
+  str = g_file_get_path (file);
+  info = (str == nullptr)
+             ? nullptr
+             : g_file_query_info (file,
+                                  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                                  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                                  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                                  G_FILE_QUERY_INFO_NONE, nullptr, nullptr);
+  g_object_unref (file);
+  if (info == nullptr)
+    {
+      g_free (str);
+      return false;
+    }
+
+  tryset (path, string (str));
+  g_free (str);
+  tryset (mtime, g_file_info_get_attribute_uint64 (
+                     info, G_FILE_ATTRIBUTE_TIME_MODIFIED)
+                         * G_USEC_PER_SEC
+                     + g_file_info_get_attribute_uint32 (
+                         info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC));
+  tryset (size, g_file_info_get_size (info));
+  g_object_unref (info);
+  return true;
+}
+
+/// Reads imported document, possibly from the cache of imported documents.
+/// Only local files are cached; entries are invalidated when the file's
+/// mtime (in microseconds) or size changes.  The cache keeps at most
+/// #PARSER_IMPORT_CACHE_MAX documents and evicts the least recently used.
+static shared_ptr<xmlDoc>
+parser_import_cache_read (const string &uri)
+{
+  shared_ptr<xmlDoc> xml;
+  xmlDoc *doc;
+  guint64 mtime;
+  goffset size;
+  string key;
+
+  if (!parser_import_stat (uri, &key, &mtime, &size))
+    {
+      doc = xmlReadFile (uri.c_str (), nullptr, PARSER_LIBXML_FLAGS);
+      if (doc == nullptr)
+        return nullptr;
+      return shared_ptr<xmlDoc> (doc, xmlFreeDoc);
+    }
+
+  G_LOCK (parser_import_cache);
+  auto it = parser_import_cache.find (key);
+  if (it != parser_import_cache.end () && it->second.mtime == mtime
+      && it->second.size == size)
+    {
+      xml = it->second.xml;
+      it->second.used = ++parser_import_cache_clock;
+    }
+  G_UNLOCK (parser_import_cache);
+
+  if (xml != nullptr)
+    return xml;
+
+  doc = xmlReadFile (uri.c_str (), nullptr, PARSER_LIBXML_FLAGS);
+  if (doc == nullptr)
+    return nullptr;
+
+  xml = shared_ptr<xmlDoc> (doc, xmlFreeDoc);
+  G_LOCK (parser_import_cache);
+  parser_import_cache[key]
+      = { xml, mtime, size, ++parser_import_cache_clock };
+  if (parser_import_cache.size () > PARSER_IMPORT_CACHE_MAX)
+    {
+      auto lru = parser_import_cache.begin ();
+      for (auto jt = lru; jt != parser_import_cache.end (); ++jt)
+        if (jt->second.used < lru->second.used)
+          lru = jt;
+      parser_import_cache.erase (lru); // parses using it keep their ref
+    }
+  G_UNLOCK (parser_import_cache);
+
+  return xml;
+}
+
+/// Worker thread pool for reading imported documents.
+static GThreadPool *parser_import_pool;
+
+/// Reads imported document in worker thread.
+static void
+parser_import_fetch_run (gpointer data, unused (gpointer user_data))
+{
+  ParserImportFetch *fetch = (ParserImportFetch *) data;
+  shared_ptr<xmlDoc> xml;
+  string errmsg;
+
+  xml = parser_import_cache_read (fetch->uri);
+  if (xml == nullptr)
+    errmsg = xmlGetLastErrorAsString ();
+
+  g_mutex_lock (&fetch->mutex);
+  fetch->xml = xml;
+  fetch->errmsg = errmsg;
+  fetch->done = true;
+  g_cond_broadcast (&fetch->cond);
+  g_mutex_unlock (&fetch->mutex);
+}
+
+/// Gets worker thread pool (or null, if threads are not available).
+static GThreadPool *
+parser_import_pool_get ()
+{
+  static gsize init = 0;
+  if (g_once_init_enter (&init))
+    {
+      xmlInitParser ();
+      parser_import_pool = g_thread_pool_new (
+          parser_import_fetch_run, nullptr,
+          (gint) MAX (g_get_num_processors (), 2), FALSE, nullptr);
+      g_once_init_leave (&init, 1);
+    }
+  return parser_import_pool;
+}
+
+/// Resolves \<importBase\> document URI relative to importing document.
+static string
+parser_import_resolve_uri (const string &uri, const string &main_uri)
+{
+  string result = uri;
+  if (!xpathisabs (result) && main_uri != "")
+    result = xpathbuild (xpathdirname (xpathfromuri (main_uri)), result);
+  return xurifromsrc (result, "");
+}
+
+/**
+ * @brief Starts reading the documents imported by a \<head\>.
+ *
+ * Each distinct document is read only once per parse, by a worker thread.
+ *
+ * @param head The \<head\> node.
+ * @param main_uri URI of the document containing \p head.
+ */
+void
+ParserState::importPrefetch (xmlNode *head, const string &main_uri)
+{
+  GThreadPool *pool = parser_import_pool_get ();
+
+  for (xmlNode *base = head->children; base; base = base->next)
+    {
+      if (base->type != XML_ELEMENT_NODE)
+        continue;
+
+      for (xmlNode *child = base->children; child; child = child->next)
+        {
+          ParserImportFetch *fetch;
+          xmlChar *str;
+          string uri;
+
+          if (child->type != XML_ELEMENT_NODE
+              || !xmlStrEqual (child->name, BAD_CAST "importBase"))
+            continue;
+
+          str = xmlGetProp (child, BAD_CAST "documentURI");
+          if (str == nullptr)
+            continue;
+          uri = parser_import_resolve_uri (toCPPString (str), main_uri);
+          xmlFree (str);
+
+          if (_importFetches.find (uri) != _importFetches.end ())
+            continue;
+
+          fetch = new ParserImportFetch ();
+          fetch->uri = uri;
+          fetch->done = false;
+          g_mutex_init (&fetch->mutex);
+          g_cond_init (&fetch->cond);
+          _importFetches[uri] = fetch;
+
+          if (pool == nullptr
+              || !g_thread_pool_push (pool, fetch, nullptr))
+            parser_import_fetch_run (fetch, nullptr);
+        }
+    }
+}
+
+/**
+ * @brief Gets imported document, waiting for it to be read if necessary.
+ *
+ * If the document was not prefetched, it is read by the calling thread.
+ *
+ * @param uri Document URI.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return The imported document if successful, or null otherwise.
+ */
+shared_ptr<xmlDoc>
+ParserState::importJoin (const string &uri, string *errmsg)
+{
+  ParserImportFetch *fetch;
+  shared_ptr<xmlDoc> xml;
+
+  auto it = _importFetches.find (uri);
+  if (it == _importFetches.end ())
+    {
+      xml = parser_import_cache_read (uri);
+      if (xml == nullptr)
+        tryset (errmsg, xmlGetLastErrorAsString ());
+      return xml;
+    }
+
+  fetch = it->second;
+  g_mutex_lock (&fetch->mutex);
+  while (!fetch->done)
+    g_cond_wait (&fetch->cond, &fetch->mutex);
+  xml = fetch->xml;
+  if (xml == nullptr)
+    tryset (errmsg, fetch->errmsg);
+  g_mutex_unlock (&fetch->mutex);
+
+  return xml;
+}
+
+/// Releases the document associated with \<importBase\> element.
 static void
 xmlDocCleanup (void *ptr)
 {
-  xmlFreeDoc ((xmlDoc *) ptr);
+  delete (shared_ptr<xmlDoc> *) ptr;
 }
 
-bool
-ParserState::pushImportBase (ParserState *st, ParserElt *elt)
+/// Entry in the cache of processed imported bases.
+typedef struct ParserImportBaseEntry
 {
-  ParserElt *parent_elt;
-  string alias;
-  string imported_uri;
-  string main_uri;
+  shared_ptr<const ParserImportBase> base; ///< Processed base.
+  guint64 used; ///< Value of #parser_import_base_cache_clock at last use.
+} ParserImportBaseEntry;
 
-  xmlDoc *xml;
-  xmlNode *root;
-  xmlNode *head;
+/// Cache of processed imported bases (see parser_import_base_key()).
+static map<string, ParserImportBaseEntry> parser_import_base_cache;
+static guint64 parser_import_base_cache_clock;
+G_LOCK_DEFINE_STATIC (parser_import_base_cache);
 
-  list<xmlNode *> children;
-  bool status;
+/// Builds the key of a processed imported base.  Returns false if the
+/// imported document is not a local file.
+static bool
+parser_import_base_key (const string &uri, const string &tag,
+                        const string &alias, Rect screen, Rect parent,
+                        string *key)
+{
+  string path;
 
-  g_assert (st->eltCacheIndexParent (elt->getNode (), &parent_elt));
-  g_assert (elt->getAttribute ("alias", &alias));
-  g_assert (elt->getAttribute ("documentURI", &imported_uri));
+  if (!parser_import_stat (uri, &path, nullptr, nullptr))
+    return false;
 
-  // Resolve alias
-  if (!st->aliasStackPeek (nullptr, &main_uri))
-    main_uri = st->getURI ();
+  tryset (key, xstrbuild ("%s\n%s\n%s\n%d,%d,%d,%d\n%d,%d,%d,%d",
+                          path.c_str (), tag.c_str (), alias.c_str (),
+                          screen.x, screen.y, screen.width, screen.height,
+                          parent.x, parent.y, parent.width,
+                          parent.height));
+  return true;
+}
 
-  // if imported_uri is relative path build a new path based in main_uri
-  if (!xpathisabs (imported_uri) && main_uri != "")
+/// Gets processed imported base from the cache.  Returns null if there is
+/// no such base or if some of the documents it was processed from changed.
+static shared_ptr<const ParserImportBase>
+parser_import_base_lookup (const string &key)
+{
+  shared_ptr<const ParserImportBase> base;
+
+  G_LOCK (parser_import_base_cache);
+  auto it = parser_import_base_cache.find (key);
+  if (it != parser_import_base_cache.end ())
     {
-      imported_uri = xpathbuild (xpathdirname (xpathfromuri (main_uri)),
-                                 imported_uri);
+      base = it->second.base;
+      it->second.used = ++parser_import_base_cache_clock;
     }
-  imported_uri = xurifromsrc (imported_uri, "");
+  G_UNLOCK (parser_import_base_cache);
 
-  // Push import alias and path onto alias stack.
-  if (unlikely (!st->aliasStackPush (alias, imported_uri)))
+  if (base == nullptr)
+    return nullptr;
+
+  for (auto &dep : base->deps)
     {
-      return st->errEltImport (elt->getNode (), "circular import");
+      guint64 mtime;
+      goffset size;
+
+      if (!parser_import_stat (dep.uri, nullptr, &mtime, &size)
+          || mtime != dep.mtime || size != dep.size)
+        return nullptr;
     }
 
-  // Read the imported document.
-  xml = xmlReadFile (imported_uri.c_str (), nullptr, PARSER_LIBXML_FLAGS);
-  if (unlikely (xml == nullptr))
+  return base;
+}
+
+/// Stores processed imported base in the cache.  The cache keeps at most
+/// #PARSER_IMPORT_CACHE_MAX bases and evicts the least recently used.
+static void
+parser_import_base_store (const string &key,
+                          shared_ptr<const ParserImportBase> base)
+{
+  G_LOCK (parser_import_base_cache);
+  parser_import_base_cache[key]
+      = { base, ++parser_import_base_cache_clock };
+  if (parser_import_base_cache.size () > PARSER_IMPORT_CACHE_MAX)
     {
-      string errmsg = xmlGetLastErrorAsString ();
-      return st->errEltImport (elt->getNode (), errmsg);
+      auto lru = parser_import_base_cache.begin ();
+      for (auto jt = lru; jt != parser_import_base_cache.end (); ++jt)
+        if (jt->second.used < lru->second.used)
+          lru = jt;
+      parser_import_base_cache.erase (lru);
     }
+  G_UNLOCK (parser_import_base_cache);
+}
+
+/**
+ * @brief Processes the bases of an imported document.
+ * @param elt The \<importBase\> element.
+ * @param parent_elt The base element containing \p elt.
+ * @param xml The imported document.
+ * @param uri URI of the imported document.
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+ParserState::importProcess (ParserElt *elt, ParserElt *parent_elt,
+                            xmlDoc *xml, const string &uri)
+{
+  xmlNode *root;
+  xmlNode *head;
+  list<xmlNode *> children;
 
-  UDATA_SET (elt, "xmlDoc", xml, xmlDocCleanup);
   root = xmlDocGetRootElement (xml);
   g_assert_nonnull (root);
 
   // Check imported document root.
-  if (unlikely (st->checkNode (root, nullptr, nullptr) == nullptr))
+  if (unlikely (this->checkNode (root, nullptr, nullptr) == nullptr))
     return false;
 
   // Get imported document head.
@@ -3507,9 +4532,12 @@ ParserState::pushImportBase (ParserState *st, ParserElt *elt)
   // Check imported document head.
   // (We're assuming that there is only one imported head.)
   head = children.front ();
-  if (unlikely (st->checkNode (head, nullptr, nullptr) == nullptr))
+  if (unlikely (this->checkNode (head, nullptr, nullptr) == nullptr))
     return false;
 
+  // Start reading nested imports.
+  this->importPrefetch (head, uri);
+
   // Get all occurrences of the desired base.
   children = xmlFindAllChildren (head, parent_elt->getTag ());
   if (unlikely (children.size () == 0))
@@ -3527,15 +4555,270 @@ ParserState::pushImportBase (ParserState *st, ParserElt *elt)
 
   // Process all imported base.
   for (auto base : children)
-    if (unlikely (!(status = st->processNode (base))))
-      break;
+    if (unlikely (!this->processNode (base)))
+      return false;
 
-  g_assert (st->aliasStackPop (nullptr, nullptr));
-  return status;
+  return true;
 
 fail_no_such_base:
-  return st->errEltImport (elt->getNode (), "no <" + parent_elt->getTag ()
-                                                + "> in imported document");
+  return this->errEltImport (elt->getNode (), "no <" + parent_elt->getTag ()
+                                                  + "> in imported document");
+}
+
+/**
+ * @brief Adds document to the imported bases being recorded.
+ * @param dep The document read.
+ * @param local Whether \p dep is a local file (otherwise, the bases being
+ * recorded cannot be cached).
+ */
+void
+ParserState::importRecordDep (const ParserImportDep &dep, bool local)
+{
+  for (auto rec : _importRecords)
+    {
+      if (!local)
+        rec->cacheable = false;
+      rec->deps.push_back (dep);
+    }
+}
+
+/**
+ * @brief Builds processed imported base from its recording.
+ *
+ * Copies what later parses need from the elements cached while the base
+ * was processed.  Predicates are cloned, as the ones in the elements are
+ * freed with them.
+ *
+ * @param rec The recording.
+ * @return The processed base.
+ */
+shared_ptr<ParserImportBase>
+ParserState::importSnapshot (ParserImportRecord *rec)
+{
+  shared_ptr<ParserImportBase> base;
+
+  base = shared_ptr<ParserImportBase> (new ParserImportBase ());
+  base->deps = rec->deps;
+  base->ids = rec->ids;
+  base->zorder = rec->zorder;
+  base->nregions = _zorder - rec->zorder;
+
+  for (auto elt : rec->elts)
+    {
+      ParserImportElt saved;
+      string tag;
+      Predicate *pred;
+      shared_ptr<xmlDoc> *xml;
+
+      saved.node = elt->getNode ();
+      saved.attrs = *elt->getAttributes ();
+      tag = elt->getTag ();
+      if (tag == "causalConnector")
+        {
+          set<string> *tests;
+          list<ParserConnRole> *roles;
+
+          UDATA_GET (elt, "tests", &tests);
+          UDATA_GET (elt, "roles", &roles);
+          saved.tests = *tests;
+          saved.roles = *roles;
+          for (auto &role : saved.roles)
+            role.predicate = nullptr; // set when links are resolved
+        }
+      else if ((tag == "compoundCondition" || tag == "rule"
+                || tag == "compositeRule")
+               && elt->getData ("pred", (void **) &pred))
+        {
+          saved.pred = shared_ptr<Predicate> (pred->clone ());
+        }
+      else if (tag == "importBase"
+               && elt->getData ("xmlDoc", (void **) &xml))
+        {
+          saved.xml = *xml;
+        }
+      base->elts.push_back (saved);
+    }
+
+  return base;
+}
+
+/**
+ * @brief Replays processed imported base.
+ *
+ * Does what processing the base would do: caches its elements, marks its
+ * ids as seen and allocates the z-orders of its regions.  Fails, doing
+ * nothing, if the base cannot be replayed in this parse (e.g., because
+ * some of its documents or ids were already seen); the base must then be
+ * processed.
+ *
+ * @param elt The \<importBase\> element.
+ * @param base The processed base.
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+ParserState::importReplay (ParserElt *elt, const ParserImportBase *base)
+{
+  int delta;
+
+  for (auto &dep : base->deps)
+    if (_importDocs.find (dep.xml.get ()) != _importDocs.end ())
+      return false;
+  for (auto &id : base->ids)
+    if (this->isInUniqueSet (id))
+      return false;
+
+  for (auto &dep : base->deps)
+    {
+      _importDocs.insert (dep.xml.get ());
+      this->importRecordDep (dep, true);
+    }
+  for (auto &id : base->ids)
+    this->addToUniqueSet (id);
+
+  UDATA_SET (elt, "xmlDoc",
+             new shared_ptr<xmlDoc> (base->deps.front ().xml),
+             xmlDocCleanup);
+
+  delta = _zorder - base->zorder;
+  for (auto &saved : base->elts)
+    {
+      ParserElt *copy;
+      string tag;
+      string str;
+
+      copy = new ParserElt (saved.node);
+      for (auto &it : saved.attrs)
+        copy->setAttribute (it.first, it.second);
+
+      tag = copy->getTag ();
+      if (tag == "region")
+        {
+          g_assert (copy->getAttribute ("zOrder", &str));
+          copy->setAttribute ("zOrder",
+                              xstrbuild ("%d", xstrtoint (str, 10) + delta));
+        }
+      else if (tag == "causalConnector")
+        {
+          UDATA_SET (copy, "tests", new set<string> (saved.tests),
+                     testsCleanup);
+          UDATA_SET (copy, "roles", new list<ParserConnRole> (saved.roles),
+                     rolesCleanup);
+        }
+      else if (tag == "compoundCondition" && saved.pred != nullptr)
+        {
+          UDATA_SET (copy, "pred", saved.pred->clone (), predCleanup);
+        }
+      else if ((tag == "rule" || tag == "compositeRule")
+               && saved.pred != nullptr)
+        {
+          UDATA_SET (copy, "pred", saved.pred->clone (), rulePredCleanup);
+        }
+      else if (tag == "importBase" && saved.xml != nullptr)
+        {
+          UDATA_SET (copy, "xmlDoc", new shared_ptr<xmlDoc> (saved.xml),
+                     xmlDocCleanup);
+        }
+      else if (tag == "font")
+        {
+          // Fonts are registered with fontconfig by each parse.
+          ParserState::pushFont (this, copy);
+        }
+      g_assert (this->eltCacheAdd (copy));
+    }
+  _zorder += base->nregions;
+
+  return true;
+}
+
+bool
+ParserState::pushImportBase (ParserState *st, ParserElt *elt)
+{
+  ParserElt *parent_elt;
+  string alias;
+  string imported_uri;
+  string main_uri;
+  string errmsg;
+  string key;
+  bool cacheable;
+
+  shared_ptr<xmlDoc> xml;
+  shared_ptr<const ParserImportBase> base;
+  ParserImportRecord rec;
+  ParserImportDep dep;
+  bool status;
+
+  g_assert (st->eltCacheIndexParent (elt->getNode (), &parent_elt));
+  g_assert (elt->getAttribute ("alias", &alias));
+  g_assert (elt->getAttribute ("documentURI", &imported_uri));
+
+  // Resolve alias
+  if (!st->aliasStackPeek (nullptr, &main_uri))
+    main_uri = st->getURI ();
+
+  // if imported_uri is relative path build a new path based in main_uri
+  imported_uri = parser_import_resolve_uri (imported_uri, main_uri);
+
+  // Push import alias and path onto alias stack.
+  if (unlikely (!st->aliasStackPush (alias, imported_uri)))
+    {
+      return st->errEltImport (elt->getNode (), "circular import");
+    }
+
+  // Replay the base if some previous parse processed it.
+  cacheable = parser_import_base_key (
+      imported_uri, parent_elt->getTag (), st->aliasStackCombine (),
+      st->_rectStack.front (), st->rectStackPeek (), &key);
+  if (cacheable)
+    {
+      base = parser_import_base_lookup (key);
+      if (base != nullptr && st->importReplay (elt, base.get ()))
+        {
+          TRACE ("replayed <%s> of '%s'", parent_elt->getTag ().c_str (),
+                 imported_uri.c_str ());
+          g_assert (st->aliasStackPop (nullptr, nullptr));
+          return true;
+        }
+    }
+
+  // Stat before reading, so that a document that changes meanwhile is
+  // not cached with its new contents and its old mtime.
+  dep.uri = imported_uri;
+  dep.mtime = 0;
+  dep.size = 0;
+  if (cacheable
+      && !parser_import_stat (imported_uri, nullptr, &dep.mtime, &dep.size))
+    cacheable = false;
+
+  // Get the imported document.
+  xml = st->importJoin (imported_uri, &errmsg);
+  if (unlikely (xml == nullptr))
+    return st->errEltImport (elt->getNode (), errmsg);
+
+  // Elements are cached by node, so if this parse has already processed
+  // the shared tree (e.g., same document imported under another alias), we
+  // process a private copy of it instead.
+  if (!st->_importDocs.insert (xml.get ()).second)
+    xml = shared_ptr<xmlDoc> (xmlCopyDoc (xml.get (), 1), xmlFreeDoc);
+
+  UDATA_SET (elt, "xmlDoc", new shared_ptr<xmlDoc> (xml), xmlDocCleanup);
+
+  // Record what processing leaves behind, so that later parses can replay
+  // it.
+  rec.cacheable = cacheable;
+  rec.zorder = st->_zorder;
+  st->_importRecords.push_back (&rec);
+  dep.xml = xml;
+  st->importRecordDep (dep, cacheable);
+  status = st->importProcess (elt, parent_elt, xml.get (), imported_uri);
+  st->_importRecords.pop_back ();
+  if (unlikely (!status))
+    return false;
+
+  if (rec.cacheable)
+    parser_import_base_store (key, st->importSnapshot (&rec));
+
+  g_assert (st->aliasStackPop (nullptr, nullptr));
+  return true;
 }
 
 /**
@@ -4270,12 +5553,12 @@ ParserState::pushFont (ParserState *st, ParserElt *elt)
 
 /// Helper function used by Parser::parseBuffer() and Parser::parseFile().
 static Document *
-process (xmlDoc *xml, int width, int height, string *errmsg)
+process (xmlTextReader *reader, int width, int height, string *errmsg)
 {
   ParserState st (width, height);
   Document *doc;
 
-  doc = st.process (xml);
+  doc = st.process (reader);
   if (unlikely (doc == nullptr))
     {
       g_assert (st.getError (errmsg) != ParserState::ERROR_NONE);
@@ -4299,19 +5582,19 @@ Document *
 Parser::parseBuffer (const void *buf, size_t size, int width, int height,
                      string *errmsg)
 {
-  xmlDoc *xml;
+  xmlTextReader *reader;
   Document *doc;
 
-  xml = xmlReadMemory ((const char *) buf, (int) size, nullptr, nullptr,
-                       PARSER_LIBXML_FLAGS);
-  if (unlikely (xml == nullptr))
+  reader = xmlReaderForMemory ((const char *) buf, (int) size, nullptr,
+                               nullptr, PARSER_LIBXML_FLAGS);
+  if (unlikely (reader == nullptr))
     {
       tryset (errmsg, xmlGetLastErrorAsString ());
       return nullptr;
     }
 
-  doc = process (xml, width, height, errmsg);
-  xmlFreeDoc (xml);
+  doc = process (reader, width, height, errmsg);
+  xmlFreeTextReader (reader);
   return doc;
 }
 
@@ -4327,7 +5610,7 @@ Document *
 Parser::parseFile (const string &path, int width, int height,
                    string *errmsg)
 {
-  xmlDoc *xml;
+  xmlTextReader *reader;
   Document *doc;
   string uri = path;
 
@@ -4337,18 +5620,175 @@ Parser::parseFile (const string &path, int width, int height,
 
   uri = xurifromsrc (uri, "");
 
-  xml = xmlReadFile (uri.c_str (), nullptr, PARSER_LIBXML_FLAGS);
-  if (unlikely (xml == nullptr))
+  reader = xmlReaderForFile (uri.c_str (), nullptr, PARSER_LIBXML_FLAGS);
+  if (unlikely (reader == nullptr))
     {
       tryset (errmsg, xmlGetLastErrorAsString ());
 
       return nullptr;
     }
 
-  doc = process (xml, width, height, errmsg);
-  xmlFreeDoc (xml);
+  doc = process (reader, width, height, errmsg);
+  xmlFreeTextReader (reader);
 
   return doc;
 }
 
+/// Checks whether the objects in NCL fragment can be added to \p doc.
+static bool
+parser_fragment_check_ids (xmlNode *node, Document *doc, string *errmsg)
+{
+  for (; node != nullptr; node = node->next)
+    {
+      xmlChar *str;
+
+      if (node->type != XML_ELEMENT_NODE)
+        continue;
+
+      if (xmlStrEqual (node->name, BAD_CAST "media")
+          || xmlStrEqual (node->name, BAD_CAST "context")
+          || xmlStrEqual (node->name, BAD_CAST "switch"))
+        {
+          str = xmlGetProp (node, BAD_CAST "id");
+          if (str != nullptr)
+            {
+              string id = toCPPString (str);
+              xmlFree (str);
+              if (unlikely (doc->getObjectByIdOrAlias (id) != nullptr))
+                {
+                  tryset (errmsg,
+                          xstrbuild ("Element <%s> at line %d: Bad value "
+                                     "'%s' for attribute 'id' (already "
+                                     "in document)",
+                                     toCString (node->name),
+                                     (int) node->line, id.c_str ()));
+                  return false;
+                }
+            }
+        }
+
+      if (!parser_fragment_check_ids (node->children, doc, errmsg))
+        return false;
+    }
+  return true;
+}
+
+/**
+ * @brief Parses NCL fragment into a running document.
+ *
+ * This function is used to apply NCL editing commands.  The fragment must
+ * be a single \<media\>, \<context\>, \<switch\> or \<link\> element,
+ * which is parsed as if it were a child of \p ctx in the original
+ * document, i.e., it may refer to the regions, descriptors, connectors and
+ * rules in the original \<head\> (kept by the #Document under the key
+ * "head") and to the children of \p ctx.  The new objects are created
+ * sleeping.
+ *
+ * @param buf Buffer.
+ * @param size Buffer size in bytes.
+ * @param path Path of the original document (used to resolve relative
+ * URIs), or the empty string.
+ * @param ctx The context to add the fragment to.
+ * @param width Screen width (in pixels).
+ * @param height Screen height (in pixels).
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+Parser::parseFragment (const void *buf, size_t size, const string &path,
+                       Context *ctx, int width, int height, string *errmsg)
+{
+  Document *doc;
+  xmlDoc *xml;
+  xmlNode *root;
+  string *head;
+  string uri;
+  string str;
+  xmlTextReader *reader;
+  bool status;
+
+  g_assert_nonnull (ctx);
+  doc = ctx->getDocument ();
+  g_assert_nonnull (doc);
+
+  // Check fragment.
+  xml = xmlReadMemory ((const char *) buf, (int) size, nullptr, nullptr,
+                       PARSER_LIBXML_FLAGS);
+  if (unlikely (xml == nullptr))
+    {
+      tryset (errmsg, xmlGetLastErrorAsString ());
+      return false;
+    }
+
+  root = xmlDocGetRootElement (xml);
+  g_assert_nonnull (root);
+  if (unlikely (!xmlStrEqual (root->name, BAD_CAST "media")
+                && !xmlStrEqual (root->name, BAD_CAST "context")
+                && !xmlStrEqual (root->name, BAD_CAST "switch")
+                && !xmlStrEqual (root->name, BAD_CAST "link")))
+    {
+      tryset (errmsg, xstrbuild ("Unexpected element <%s> in fragment",
+                                 toCString (root->name)));
+      xmlFreeDoc (xml);
+      return false;
+    }
+  status = parser_fragment_check_ids (root, doc, errmsg);
+  xmlFreeDoc (xml);
+  if (unlikely (!status))
+    return false;
+
+  // Wrap fragment into the original head.
+  str = "<ncl>";
+  if (doc->getData ("head", (void **) &head))
+    str += *head;
+  str += "<body>";
+  str.append ((const char *) buf, size);
+  str += "</body></ncl>";
+
+  if (path != "")
+    uri = xurifromsrc (xpathisabs (path) ? path : xpathmakeabs (path), "");
+
+  reader = xmlReaderForMemory (str.c_str (), (int) str.length (),
+                               (uri != "") ? uri.c_str () : nullptr,
+                               nullptr, PARSER_LIBXML_FLAGS);
+  if (unlikely (reader == nullptr))
+    {
+      tryset (errmsg, xmlGetLastErrorAsString ());
+      return false;
+    }
+
+  ParserState st (width, height);
+  status = st.processEdit (reader, ctx);
+  if (unlikely (!status))
+    g_assert (st.getError (errmsg) != ParserState::ERROR_NONE);
+  xmlFreeTextReader (reader);
+
+  return status;
+}
+
+/**
+ * @brief Resolves region geometry for a given screen size.
+ *
+ * Gives the same values the parser sets on a media object placed in the
+ * region when parsing for a \p width x \p height screen.
+ *
+ * @param region Source geometry of region (see #ParserRegion).
+ * @param width Screen width (in pixels).
+ * @param height Screen height (in pixels).
+ * @param[out] geom Variable to store the "left", "top", "width" and
+ * "height" properties (in percent).
+ */
+void
+Parser::resolveRegion (const ParserRegion &region, int width, int height,
+                       map<string, string> *geom)
+{
+  Rect screen = { 0, 0, width, height };
+  Rect rect = screen;
+
+  g_assert_nonnull (geom);
+  for (auto &attrs : region.chain)
+    rect = parser_region_resolve (rect, attrs);
+  parser_region_percent (rect, screen, geom);
+}
+
 }
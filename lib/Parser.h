@@ -22,11 +22,34 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 
 namespace ginga {
 
+class Context;
+
+/**
+ * @brief Region geometry of a media object, as given in the source.
+ *
+ * The parser resolves region geometry into percentages of the screen it
+ * parses for.  The source values are kept in the document data "regions"
+ * (a map from media id to #ParserRegion), so that compiled documents can
+ * be resolved for another screen (see Parser::resolveRegion()).
+ */
+typedef struct ParserRegion
+{
+  /// Geometry attributes of the region and its ancestors, outermost first.
+  list<map<string, string> > chain;
+
+  /// Media properties set from the region.
+  set<string> props;
+} ParserRegion;
+
 class Parser
 {
 public:
   static Document *parseBuffer (const void *, size_t, int, int, string *);
   static Document *parseFile (const string &, int, int, string *);
+  static bool parseFragment (const void *, size_t, const string &,
+                             Context *, int, int, string *);
+  static void resolveRegion (const ParserRegion &, int, int,
+                             map<string, string> *);
 };
 
 }
@@ -0,0 +1,1127 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "aux-ginga.h"
+#include "ParserBinary.h"
+
+#include "Context.h"
+#include "Media.h"
+#include "MediaSettings.h"
+#include "Parser.h"
+#include "Switch.h"
+#include "Predicate.h"
+
+#include <libxml/uri.h>
+
+namespace ginga {
+
+/* Compiled document format (all integers are little-endian):
+
+   header:   magic "GNCB", u32 version, u32 width, u32 height (of the
+             screen the document was compiled for), u32 #strings,
+             u32 #objects
+   strings:  #strings x (u32 length, bytes, '\0')
+   document: str id
+   objects:  #objects x (u32 kind, str id, obj parent, u32 #props,
+             #props x (str name, str value), region, u32 #events,
+             #events x (u32 type, str id, u64 begin, u64 end, str label,
+             u32 #params, #params x (str name, str value)))
+   bindings: #objects x (u32 #aliases, #aliases x (str alias, obj parent),
+             then, if context, u32 links status, u32 #ports, #ports x evt,
+             u32 #links, #links x (str id, u32 #conds, #conds x act,
+             u32 #acts, #acts x act), or, if switch, u32 #rules,
+             #rules x (obj, pred), u32 #swports, #swports x (str id,
+             u32 #evts, #evts x evt))
+
+   where str is an index in the string table, obj is an index in the
+   object table (or PARSER_BINARY_NONE), evt is (obj, u32 type, str id),
+   act is (evt, u32 transition, pred, str value, str duration, str delay),
+   and pred is u32 type (or PARSER_BINARY_NONE), followed by (str left,
+   u32 test, str right) if atom, or by (u32 #children, #children x pred)
+   otherwise.
+
+   Region is the source geometry of the region of a media object (see
+   ParserRegion): u32 #levels, #levels x (u32 #attrs, #attrs x (str name,
+   str value)), u32 #rprops, #rprops x str name; it is empty for other
+   objects.  The properties named in it are resolved again at load time,
+   for the screen the document is loaded at.
+
+   The "uri" of local media objects is stored relative to the source
+   document and resolved against the location of the compiled document
+   at load time.
+
+   Objects are stored in pre-order, so parents always come before their
+   children.  Bindings are stored after all objects (and their events)
+   because aliases, ports, links and rules may refer to any of them.  */
+
+#define PARSER_BINARY_MAGIC "GNCB"
+#define PARSER_BINARY_VERSION 3
+#define PARSER_BINARY_NONE G_MAXUINT32
+#define PARSER_BINARY_MAX_DEPTH 256
+
+/// Object kinds.
+enum ParserBinaryKind
+{
+  PARSER_BINARY_CONTEXT = 0,
+  PARSER_BINARY_SWITCH,
+  PARSER_BINARY_MEDIA,
+  PARSER_BINARY_SETTINGS,
+};
+
+// Writer.
+
+/**
+ * @brief Compiled document writer state.
+ */
+class ParserBinaryWriter
+{
+public:
+  string body;                        ///< Encoded objects and bindings.
+  vector<const string *> strings;     ///< String table.
+  map<string, guint32> stringIndex;   ///< String table indexed by string.
+  vector<Object *> objects;           ///< Object table.
+  map<Object *, guint32> objectIndex; ///< Object table indexed by object.
+
+  void putU32 (guint32);
+  void putU64 (guint64);
+  void putStr (const string &);
+  bool putObj (Object *);
+  bool putEvt (Event *);
+  bool putAct (const Action &);
+  void putPred (Predicate *);
+  void putRegion (const ParserRegion *);
+  void collect (Object *);
+};
+
+void
+ParserBinaryWriter::putU32 (guint32 x)
+{
+  x = GUINT32_TO_LE (x);
+  body.append ((const char *) &x, sizeof (x));
+}
+
+void
+ParserBinaryWriter::putU64 (guint64 x)
+{
+  x = GUINT64_TO_LE (x);
+  body.append ((const char *) &x, sizeof (x));
+}
+
+void
+ParserBinaryWriter::putStr (const string &str)
+{
+  auto it = stringIndex.find (str);
+  if (it == stringIndex.end ())
+    {
+      it = stringIndex.insert (std::make_pair (str, strings.size ())).first;
+      strings.push_back (&it->first);
+    }
+  this->putU32 (it->second);
+}
+
+bool
+ParserBinaryWriter::putObj (Object *obj)
+{
+  if (obj == nullptr)
+    {
+      this->putU32 (PARSER_BINARY_NONE);
+      return true;
+    }
+  auto it = objectIndex.find (obj);
+  if (unlikely (it == objectIndex.end ()))
+    return false;
+  this->putU32 (it->second);
+  return true;
+}
+
+bool
+ParserBinaryWriter::putEvt (Event *evt)
+{
+  if (unlikely (evt == nullptr || !this->putObj (evt->getObject ())))
+    return false;
+  this->putU32 ((guint32) evt->getType ());
+  this->putStr (evt->getId ());
+  return true;
+}
+
+bool
+ParserBinaryWriter::putAct (const Action &act)
+{
+  if (unlikely (!this->putEvt (act.event)))
+    return false;
+  this->putU32 ((guint32) act.transition);
+  this->putPred (act.predicate);
+  this->putStr (act.value);
+  this->putStr (act.duration);
+  this->putStr (act.delay);
+  return true;
+}
+
+void
+ParserBinaryWriter::putPred (Predicate *pred)
+{
+  if (pred == nullptr)
+    {
+      this->putU32 (PARSER_BINARY_NONE);
+      return;
+    }
+
+  this->putU32 ((guint32) pred->getType ());
+  if (pred->getType () == Predicate::ATOM)
+    {
+      string left, right;
+      Predicate::Test test;
+
+      pred->getTest (&left, &test, &right);
+      this->putStr (left);
+      this->putU32 ((guint32) test);
+      this->putStr (right);
+    }
+  else
+    {
+      this->putU32 ((guint32) pred->getChildren ()->size ());
+      for (auto child : *pred->getChildren ())
+        this->putPred (child);
+    }
+}
+
+void
+ParserBinaryWriter::putRegion (const ParserRegion *region)
+{
+  if (region == nullptr)
+    {
+      this->putU32 (0);
+      this->putU32 (0);
+      return;
+    }
+
+  this->putU32 ((guint32) region->chain.size ());
+  for (auto &attrs : region->chain)
+    {
+      this->putU32 ((guint32) attrs.size ());
+      for (auto &it : attrs)
+        {
+          this->putStr (it.first);
+          this->putStr (it.second);
+        }
+    }
+  this->putU32 ((guint32) region->props.size ());
+  for (auto &name : region->props)
+    this->putStr (name);
+}
+
+/// Collects \p obj and its descendants in pre-order.
+void
+ParserBinaryWriter::collect (Object *obj)
+{
+  objectIndex[obj] = (guint32) objects.size ();
+  objects.push_back (obj);
+  if (instanceof (Composition *, obj))
+    for (auto child : *cast (Composition *, obj)->getChildren ())
+      this->collect (child);
+}
+
+/// Makes local file URI \p uri relative to the directory of file URI
+/// \p base.  Other URIs are returned unchanged.
+static string
+parser_binary_relative_uri (const string &uri, const string &base)
+{
+  string prefix;
+  string rel;
+  size_t i;
+
+  if (!xstrhasprefix (uri, "file:///") || !xstrhasprefix (base, "file:///"))
+    return uri;
+
+  prefix = base.substr (0, base.rfind ('/') + 1);
+  while (!xstrhasprefix (uri, prefix))
+    {
+      i = prefix.rfind ('/', prefix.length () - 2);
+      g_assert (i != string::npos && i >= strlen ("file://"));
+      prefix.erase (i + 1);
+      rel += "../";
+    }
+  rel += uri.substr (prefix.length ());
+
+  // A colon before the first slash would be taken as a scheme.
+  i = rel.find (':');
+  if (i != string::npos && i < rel.find ('/'))
+    rel = "./" + rel;
+
+  return rel;
+}
+
+// Reader.
+
+/**
+ * @brief Compiled document reader state.
+ */
+class ParserBinaryReader
+{
+public:
+  const guchar *p;           ///< Current position.
+  const guchar *end;         ///< End of buffer.
+  vector<const char *> strs; ///< String table (points into buffer).
+  vector<guint32> strlens;   ///< Length of strings in string table.
+  vector<Object *> objects;  ///< Object table.
+  string base;               ///< Base URI of relative media URIs.
+  int width;                 ///< Screen width.
+  int height;                ///< Screen height.
+
+  bool getU32 (guint32 *);
+  bool getU64 (guint64 *);
+  bool getStr (string *);
+  bool getObj (Object **);
+  bool getEvt (Event **);
+  bool getAct (Action *);
+  bool getPred (Predicate **, int);
+  bool getRegion (ParserRegion *);
+};
+
+bool
+ParserBinaryReader::getU32 (guint32 *x)
+{
+  if (unlikely ((size_t) (end - p) < sizeof (*x)))
+    return false;
+  memcpy (x, p, sizeof (*x));
+  *x = GUINT32_FROM_LE (*x);
+  p += sizeof (*x);
+  return true;
+}
+
+bool
+ParserBinaryReader::getU64 (guint64 *x)
+{
+  if (unlikely ((size_t) (end - p) < sizeof (*x)))
+    return false;
+  memcpy (x, p, sizeof (*x));
+  *x = GUINT64_FROM_LE (*x);
+  p += sizeof (*x);
+  return true;
+}
+
+bool
+ParserBinaryReader::getStr (string *str)
+{
+  guint32 i;
+  if (unlikely (!this->getU32 (&i) || i >= strs.size ()))
+    return false;
+  str->assign (strs[i], strlens[i]);
+  return true;
+}
+
+bool
+ParserBinaryReader::getObj (Object **obj)
+{
+  guint32 i;
+  if (unlikely (!this->getU32 (&i)))
+    return false;
+  if (i == PARSER_BINARY_NONE)
+    {
+      *obj = nullptr;
+      return true;
+    }
+  if (unlikely (i >= objects.size ()))
+    return false;
+  *obj = objects[i];
+  return true;
+}
+
+bool
+ParserBinaryReader::getEvt (Event **evt)
+{
+  Object *obj;
+  guint32 type;
+  string id;
+
+  if (unlikely (!this->getObj (&obj) || obj == nullptr
+                || !this->getU32 (&type) || type > Event::LOOKAT
+                || !this->getStr (&id)))
+    return false;
+
+  *evt = obj->getEvent ((Event::Type) type, id);
+  return *evt != nullptr;
+}
+
+bool
+ParserBinaryReader::getAct (Action *act)
+{
+  guint32 trans;
+
+  act->predicate = nullptr;
+  if (unlikely (!this->getEvt (&act->event) || !this->getU32 (&trans)
+                || trans > Event::STOP))
+    return false;
+  act->transition = (Event::Transition) trans;
+
+  if (unlikely (!this->getPred (&act->predicate, 0)))
+    return false;
+
+  if (unlikely (!this->getStr (&act->value)
+                || !this->getStr (&act->duration)
+                || !this->getStr (&act->delay)))
+    {
+      delete act->predicate;
+      act->predicate = nullptr;
+      return false;
+    }
+  return true;
+}
+
+bool
+ParserBinaryReader::getPred (Predicate **result, int depth)
+{
+  Predicate *pred;
+  guint32 type;
+
+  *result = nullptr;
+  if (unlikely (depth > PARSER_BINARY_MAX_DEPTH || !this->getU32 (&type)))
+    return false;
+  if (type == PARSER_BINARY_NONE)
+    return true;
+  if (unlikely (type > Predicate::DISJUNCTION))
+    return false;
+
+  pred = new Predicate ((Predicate::Type) type);
+  if (type == Predicate::ATOM)
+    {
+      string left, right;
+      guint32 test;
+
+      if (unlikely (!this->getStr (&left) || !this->getU32 (&test)
+                    || test > Predicate::GE || !this->getStr (&right)))
+        goto fail;
+      pred->setTest (left, (Predicate::Test) test, right);
+    }
+  else
+    {
+      guint32 n;
+
+      if (unlikely (!this->getU32 (&n)))
+        goto fail;
+      for (guint32 i = 0; i < n; i++)
+        {
+          Predicate *child;
+          if (unlikely (!this->getPred (&child, depth + 1)
+                        || child == nullptr))
+            goto fail;
+          pred->addChild (child);
+        }
+    }
+
+  *result = pred;
+  return true;
+
+fail:
+  delete pred;
+  return false;
+}
+
+bool
+ParserBinaryReader::getRegion (ParserRegion *region)
+{
+  guint32 n;
+
+  if (unlikely (!this->getU32 (&n)))
+    return false;
+  for (guint32 i = 0; i < n; i++)
+    {
+      map<string, string> attrs;
+      guint32 m;
+
+      if (unlikely (!this->getU32 (&m)))
+        return false;
+      for (guint32 j = 0; j < m; j++)
+        {
+          string name, value;
+          if (unlikely (!this->getStr (&name) || !this->getStr (&value)))
+            return false;
+          attrs[name] = value;
+        }
+      region->chain.push_back (attrs);
+    }
+
+  if (unlikely (!this->getU32 (&n)))
+    return false;
+  for (guint32 i = 0; i < n; i++)
+    {
+      string name;
+      if (unlikely (!this->getStr (&name)))
+        return false;
+      region->props.insert (name);
+    }
+  return true;
+}
+
+/// Resolves the relative reference \p uri against \p base.
+static string
+parser_binary_resolve_uri (const string &uri, const string &base)
+{
+  xmlChar *s;
+  string result;
+
+  if (uri == "" || base == "")
+    return uri;
+
+  s = xmlBuildURI ((const xmlChar *) uri.c_str (),
+                   (const xmlChar *) base.c_str ());
+  if (unlikely (s == nullptr))
+    return uri;
+
+  result.assign ((const char *) s);
+  xmlFree (s);
+  return result;
+}
+
+/// Cleans up the #ParserRegion map attached to #Document.
+static void
+parser_binary_regions_cleanup (void *ptr)
+{
+  delete (map<string, ParserRegion> *) ptr;
+}
+
+/// Reads string table and objects.
+static bool
+parser_binary_read_objects (ParserBinaryReader *rd, Document *doc,
+                            guint32 nobjs)
+{
+  for (guint32 i = 0; i < nobjs; i++)
+    {
+      Object *obj;
+      Object *parent;
+      guint32 kind;
+      guint32 n;
+      string id;
+      list<pair<string, string> > props;
+      ParserRegion region;
+
+      if (unlikely (!rd->getU32 (&kind) || kind > PARSER_BINARY_SETTINGS
+                    || !rd->getStr (&id) || !rd->getObj (&parent)
+                    || !rd->getU32 (&n)))
+        return false;
+
+      for (guint32 j = 0; j < n; j++)
+        {
+          string name, value;
+          if (unlikely (!rd->getStr (&name) || !rd->getStr (&value)))
+            return false;
+          props.push_back (std::make_pair (name, value));
+        }
+
+      if (unlikely (!rd->getRegion (&region)))
+        return false;
+
+      if (kind == PARSER_BINARY_MEDIA)
+        {
+          map<string, string> geom;
+
+          if (!region.chain.empty ())
+            {
+              map<string, ParserRegion> *regions;
+
+              Parser::resolveRegion (region, rd->width, rd->height, &geom);
+              if (!doc->getData ("regions", (void **) &regions))
+                {
+                  regions = new map<string, ParserRegion> ();
+                  doc->setData ("regions", regions,
+                                parser_binary_regions_cleanup);
+                }
+              (*regions)[id] = region;
+            }
+
+          for (auto &it : props)
+            {
+              if (it.first == "uri")
+                it.second = parser_binary_resolve_uri (it.second, rd->base);
+              else if (region.props.count (it.first) > 0)
+                it.second = geom[it.first];
+            }
+        }
+
+      // Create object.
+      if (kind == PARSER_BINARY_SETTINGS)
+        {
+          obj = doc->getSettings ();
+        }
+      else if (parent == nullptr)
+        {
+          if (unlikely (kind != PARSER_BINARY_CONTEXT || i != 0))
+            return false;
+          obj = doc->getRoot ();
+        }
+      else
+        {
+          if (unlikely (!instanceof (Composition *, parent)))
+            return false;
+
+          switch (kind)
+            {
+            case PARSER_BINARY_CONTEXT:
+              obj = new Context (id);
+              break;
+            case PARSER_BINARY_SWITCH:
+              obj = new Switch (id);
+              break;
+            case PARSER_BINARY_MEDIA:
+              obj = new Media (id);
+              // Uri and type are set before the media is added to the
+              // document, as the document sorts medias by them.
+              for (auto &it : props)
+                if (it.first == "uri" || it.first == "type")
+                  obj->setProperty (it.first, it.second);
+              break;
+            default:
+              g_assert_not_reached ();
+            }
+
+          if (unlikely (doc->getObjectById (id) != nullptr))
+            {
+              delete obj;
+              return false;
+            }
+          cast (Composition *, parent)->addChild (obj);
+        }
+      rd->objects.push_back (obj);
+
+      for (auto &it : props)
+        obj->setProperty (it.first, it.second);
+
+      // Events.
+      if (unlikely (!rd->getU32 (&n)))
+        return false;
+      for (guint32 j = 0; j < n; j++)
+        {
+          Event *evt;
+          guint32 type;
+          guint64 begin, end;
+          guint32 nparams;
+          string label;
+
+          if (unlikely (!rd->getU32 (&type) || type > Event::LOOKAT
+                        || !rd->getStr (&id) || !rd->getU64 (&begin)
+                        || !rd->getU64 (&end) || !rd->getStr (&label)
+                        || !rd->getU32 (&nparams)))
+            return false;
+
+          switch (type)
+            {
+            case Event::ATTRIBUTION:
+              obj->addAttributionEvent (id);
+              break;
+            case Event::PRESENTATION:
+              obj->addPresentationEvent (id, begin, end);
+              break;
+            case Event::SELECTION:
+              obj->addSelectionEvent (id);
+              break;
+            case Event::LOOKAT:
+              obj->addLookAtEvent (id);
+              break;
+            default:
+              g_assert_not_reached ();
+            }
+
+          evt = obj->getEvent ((Event::Type) type, id);
+          g_assert_nonnull (evt);
+          evt->setInterval (begin, end);
+          if (label != "")
+            evt->setLabel (label);
+
+          for (guint32 k = 0; k < nparams; k++)
+            {
+              string name, value;
+              if (unlikely (!rd->getStr (&name) || !rd->getStr (&value)))
+                return false;
+              evt->setParameter (name, value);
+            }
+        }
+    }
+  return true;
+}
+
+/// Reads aliases, ports, links and rules.
+static bool
+parser_binary_read_bindings (ParserBinaryReader *rd)
+{
+  for (auto obj : rd->objects)
+    {
+      guint32 n;
+
+      // Aliases.
+      if (unlikely (!rd->getU32 (&n)))
+        return false;
+      for (guint32 i = 0; i < n; i++)
+        {
+          string alias;
+          Object *parent;
+
+          if (unlikely (!rd->getStr (&alias) || !rd->getObj (&parent)
+                        || (parent != nullptr
+                            && !instanceof (Composition *, parent))))
+            return false;
+          obj->addAlias (alias, cast (Composition *, parent));
+        }
+
+      if (instanceof (Context *, obj))
+        {
+          Context *ctx = cast (Context *, obj);
+          guint32 status;
+
+          if (unlikely (!rd->getU32 (&status)))
+            return false;
+          ctx->setLinksStatus (status != 0);
+
+          // Ports.
+          if (unlikely (!rd->getU32 (&n)))
+            return false;
+          for (guint32 i = 0; i < n; i++)
+            {
+              Event *evt;
+              if (unlikely (!rd->getEvt (&evt)))
+                return false;
+              ctx->addPort (evt);
+            }
+
+          // Links.
+          if (unlikely (!rd->getU32 (&n)))
+            return false;
+          for (guint32 i = 0; i < n; i++)
+            {
+              string id;
+              list<Action> conds;
+              list<Action> acts;
+              list<Action> *lists[2] = { &conds, &acts };
+
+              if (unlikely (!rd->getStr (&id)))
+                return false;
+              for (auto lst : lists)
+                {
+                  guint32 m;
+                  bool ok = rd->getU32 (&m);
+                  for (guint32 j = 0; ok && j < m; j++)
+                    {
+                      Action act;
+                      if ((ok = rd->getAct (&act)))
+                        lst->push_back (act);
+                    }
+                  if (unlikely (!ok))
+                    {
+                      for (auto &act : conds)
+                        delete act.predicate;
+                      for (auto &act : acts)
+                        delete act.predicate;
+                      return false;
+                    }
+                }
+              ctx->addLink (conds, acts, id);
+            }
+        }
+      else if (instanceof (Switch *, obj))
+        {
+          Switch *swtch = cast (Switch *, obj);
+
+          // Rules.
+          if (unlikely (!rd->getU32 (&n)))
+            return false;
+          for (guint32 i = 0; i < n; i++)
+            {
+              Object *target;
+              Predicate *pred;
+
+              if (unlikely (!rd->getObj (&target) || target == nullptr
+                            || !rd->getPred (&pred, 0)))
+                return false;
+              if (unlikely (pred == nullptr))
+                return false;
+              swtch->addRule (target, pred);
+            }
+
+          // Switch ports.
+          if (unlikely (!rd->getU32 (&n)))
+            return false;
+          for (guint32 i = 0; i < n; i++)
+            {
+              string id;
+              list<Event *> evts;
+              guint32 m;
+
+              if (unlikely (!rd->getStr (&id) || !rd->getU32 (&m)))
+                return false;
+              for (guint32 j = 0; j < m; j++)
+                {
+                  Event *evt;
+                  if (unlikely (!rd->getEvt (&evt)))
+                    return false;
+                  evts.push_back (evt);
+                }
+              swtch->addSwitchPort (id, evts);
+            }
+        }
+    }
+  return true;
+}
+
+/// Helper function used by ParserBinary::parseBuffer() and
+/// ParserBinary::parseFile().  Relative media URIs are resolved against
+/// \p base.
+static Document *
+parser_binary_parse (const void *buf, size_t size, int width, int height,
+                     const string &base, string *errmsg)
+{
+  ParserBinaryReader rd;
+  Document *doc;
+  guint32 version, w, h, nstrs, nobjs;
+  string id;
+
+  rd.p = (const guchar *) buf;
+  rd.end = rd.p + size;
+  rd.base = base;
+  rd.width = width;
+  rd.height = height;
+
+  if (unlikely (size < 4 || memcmp (rd.p, PARSER_BINARY_MAGIC, 4) != 0))
+    {
+      tryset (errmsg, "Not a compiled NCL document");
+      return nullptr;
+    }
+  rd.p += 4;
+
+  if (unlikely (!rd.getU32 (&version) || !rd.getU32 (&w)
+                || !rd.getU32 (&h) || !rd.getU32 (&nstrs)
+                || !rd.getU32 (&nobjs)))
+    goto corrupted;
+
+  if (unlikely (version != PARSER_BINARY_VERSION))
+    {
+      tryset (errmsg, xstrbuild ("Unsupported compiled document version %u",
+                                 (guint) version));
+      return nullptr;
+    }
+
+  if (unlikely (w == 0 || h == 0))
+    goto corrupted;
+
+  // String table.
+  if (unlikely (nstrs > size / sizeof (guint32)))
+    goto corrupted;
+  rd.strs.reserve (nstrs);
+  rd.strlens.reserve (nstrs);
+  for (guint32 i = 0; i < nstrs; i++)
+    {
+      guint32 len;
+      if (unlikely (!rd.getU32 (&len) || (size_t) (rd.end - rd.p) <= len
+                    || rd.p[len] != '\0'))
+        goto corrupted;
+      rd.strs.push_back ((const char *) rd.p);
+      rd.strlens.push_back (len);
+      rd.p += len + 1;
+    }
+
+  // Objects.
+  if (unlikely (!rd.getStr (&id) || nobjs < 2))
+    goto corrupted;
+  doc = (id != "") ? new Document (id) : new Document ();
+  if (unlikely (!parser_binary_read_objects (&rd, doc, nobjs)
+                || !parser_binary_read_bindings (&rd) || rd.p != rd.end))
+    {
+      delete doc;
+      goto corrupted;
+    }
+
+  return doc;
+
+corrupted:
+  tryset (errmsg, "Corrupted compiled NCL document");
+  return nullptr;
+}
+
+// External API.
+
+/**
+ * @brief Loads compiled document from memory buffer.
+ *
+ * The buffer must have been generated by ParserBinary::writeBuffer().
+ * Region geometry is resolved for the given screen size, as
+ * Parser::parseBuffer() would do for the source document.  Relative media
+ * URIs are resolved against the current directory.  Strings are copied
+ * from the buffer, which can be freed once this function returns.
+ *
+ * @fn ParserBinary::parseBuffer
+ * @param buf Buffer.
+ * @param size Buffer size in bytes.
+ * @param width Initial screen width (in pixels).
+ * @param height Initial screen height (in pixels).
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return The resulting #Document if successful, or null otherwise.
+ */
+Document *
+ParserBinary::parseBuffer (const void *buf, size_t size, int width,
+                           int height, string *errmsg)
+{
+  // The last segment of the base URI, here ".", is ignored.
+  return parser_binary_parse (buf, size, width, height,
+                              xurifromsrc (xpathmakeabs ("."), ""), errmsg);
+}
+
+/**
+ * @brief Loads compiled document from file.
+ *
+ * The file is mapped into memory for decoding.  Relative media URIs are
+ * resolved against the directory of \p path.
+ *
+ * @param path File path.
+ * @param width Initial screen width (in pixels).
+ * @param height Initial screen height (in pixels).
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return The resulting #Document if successful, or null otherwise.
+ */
+Document *
+ParserBinary::parseFile (const string &path, int width, int height,
+                         string *errmsg)
+{
+  GMappedFile *file;
+  GError *err = nullptr;
+  Document *doc;
+  string uri;
+
+  file = g_mapped_file_new (path.c_str (), FALSE, &err);
+  if (unlikely (file == nullptr))
+    {
+      g_assert_nonnull (err);
+      tryset (errmsg, string (err->message));
+      g_error_free (err);
+      return nullptr;
+    }
+
+  uri = xurifromsrc (xpathmakeabs (path), "");
+  doc = parser_binary_parse (g_mapped_file_get_contents (file),
+                             g_mapped_file_get_length (file), width, height,
+                             uri, errmsg);
+  g_mapped_file_unref (file);
+  if (doc != nullptr)
+    doc->setData ("uri", new string (uri), xstrdelete);
+  return doc;
+}
+
+/**
+ * @brief Compiles document into memory buffer.
+ *
+ * Serializes the objects, events, properties, ports, links (with their
+ * actions and predicates) and switch rules of \p doc.  Strings are
+ * stored only once.  Region geometry is stored as given in the source
+ * (see #ParserRegion), and local media URIs relative to the source
+ * document.
+ *
+ * @param doc Document (as returned by Parser::parseFile()).
+ * @param width Screen width used to parse \p doc.
+ * @param height Screen height used to parse \p doc.
+ * @param[out] buf Variable to store the compiled document.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+ParserBinary::writeBuffer (Document *doc, int width, int height,
+                           string *buf, string *errmsg)
+{
+  ParserBinaryWriter wr;
+  string head;
+  string *uri;
+  map<string, ParserRegion> *regions;
+
+  g_assert_nonnull (doc);
+  g_assert_nonnull (buf);
+
+  if (!doc->getData ("uri", (void **) &uri))
+    uri = nullptr;
+  if (!doc->getData ("regions", (void **) &regions))
+    regions = nullptr;
+
+  wr.putStr (doc->getId ());
+  wr.collect (doc->getRoot ());
+
+  // Objects.
+  for (auto obj : wr.objects)
+    {
+      guint32 kind;
+
+      if (instanceof (MediaSettings *, obj))
+        kind = PARSER_BINARY_SETTINGS;
+      else if (instanceof (Media *, obj))
+        kind = PARSER_BINARY_MEDIA;
+      else if (instanceof (Context *, obj))
+        kind = PARSER_BINARY_CONTEXT;
+      else if (instanceof (Switch *, obj))
+        kind = PARSER_BINARY_SWITCH;
+      else
+        g_assert_not_reached ();
+
+      wr.putU32 (kind);
+      wr.putStr (obj->getId ());
+      g_assert (wr.putObj (obj->getParent ()));
+
+      wr.putU32 ((guint32) obj->getProperties ()->size ());
+      for (auto &it : *obj->getProperties ())
+        {
+          wr.putStr (it.first);
+          if (kind == PARSER_BINARY_MEDIA && it.first == "uri"
+              && uri != nullptr)
+            wr.putStr (parser_binary_relative_uri (it.second, *uri));
+          else
+            wr.putStr (it.second);
+        }
+
+      if (kind == PARSER_BINARY_MEDIA && regions != nullptr
+          && regions->count (obj->getId ()) > 0)
+        wr.putRegion (&regions->at (obj->getId ()));
+      else
+        wr.putRegion (nullptr);
+
+      wr.putU32 ((guint32) obj->getEvents ()->size ());
+      for (auto evt : *obj->getEvents ())
+        {
+          Time begin, end;
+
+          evt->getInterval (&begin, &end);
+          wr.putU32 ((guint32) evt->getType ());
+          wr.putStr (evt->getId ());
+          wr.putU64 (begin);
+          wr.putU64 (end);
+          wr.putStr (evt->getLabel ());
+          wr.putU32 ((guint32) evt->getParameters ()->size ());
+          for (auto &it : *evt->getParameters ())
+            {
+              wr.putStr (it.first);
+              wr.putStr (it.second);
+            }
+        }
+    }
+
+  // Bindings.
+  for (auto obj : wr.objects)
+    {
+      wr.putU32 ((guint32) obj->getAliases ()->size ());
+      for (auto &it : *obj->getAliases ())
+        {
+          wr.putStr (it.first);
+          if (unlikely (!wr.putObj (it.second)))
+            goto dangling;
+        }
+
+      if (instanceof (Context *, obj))
+        {
+          Context *ctx = cast (Context *, obj);
+
+          wr.putU32 (ctx->getLinksStatus () ? 1 : 0);
+          wr.putU32 ((guint32) ctx->getPorts ()->size ());
+          for (auto evt : *ctx->getPorts ())
+            if (unlikely (!wr.putEvt (evt)))
+              goto dangling;
+
+          wr.putU32 ((guint32) ctx->getLinks ()->size ());
+          auto it_id = ctx->getLinkIds ()->begin ();
+          for (auto &link : *ctx->getLinks ())
+            {
+              wr.putStr (*it_id++);
+              wr.putU32 ((guint32) link.first.size ());
+              for (auto &act : link.first)
+                if (unlikely (!wr.putAct (act)))
+                  goto dangling;
+              wr.putU32 ((guint32) link.second.size ());
+              for (auto &act : link.second)
+                if (unlikely (!wr.putAct (act)))
+                  goto dangling;
+            }
+        }
+      else if (instanceof (Switch *, obj))
+        {
+          Switch *swtch = cast (Switch *, obj);
+
+          wr.putU32 ((guint32) swtch->getRules ()->size ());
+          for (auto &rule : *swtch->getRules ())
+            {
+              if (unlikely (!wr.putObj (rule.first)))
+                goto dangling;
+              wr.putPred (rule.second);
+            }
+
+          wr.putU32 ((guint32) swtch->getSwitchPorts ()->size ());
+          for (auto &it : *swtch->getSwitchPorts ())
+            {
+              wr.putStr (it.first);
+              wr.putU32 ((guint32) it.second.size ());
+              for (auto evt : it.second)
+                if (unlikely (!wr.putEvt (evt)))
+                  goto dangling;
+            }
+        }
+    }
+
+  // Header and string table.
+  std::swap (head, wr.body);
+  wr.body.append (PARSER_BINARY_MAGIC, 4);
+  wr.putU32 (PARSER_BINARY_VERSION);
+  wr.putU32 ((guint32) width);
+  wr.putU32 ((guint32) height);
+  wr.putU32 ((guint32) wr.strings.size ());
+  wr.putU32 ((guint32) wr.objects.size ());
+  for (auto str : wr.strings)
+    {
+      wr.putU32 ((guint32) str->length ());
+      wr.body.append (str->c_str (), str->length () + 1);
+    }
+  wr.body.append (head);
+
+  std::swap (*buf, wr.body);
+  return true;
+
+dangling:
+  tryset (errmsg, "Document refers to an object not in document");
+  return false;
+}
+
+/**
+ * @brief Compiles document into file.
+ * @param doc Document (as returned by Parser::parseFile()).
+ * @param width Screen width used to parse \p doc.
+ * @param height Screen height used to parse \p doc.
+ * @param path File path.
+ * @param[out] errmsg Variable to store the error message (if any).
+ * @return \c true if successful, or \c false otherwise.
+ */
+bool
+ParserBinary::writeFile (Document *doc, int width, int height,
+                         const string &path, string *errmsg)
+{
+  GError *err = nullptr;
+  string buf;
+
+  if (unlikely (!ParserBinary::writeBuffer (doc, width, height, &buf,
+                                            errmsg)))
+    return false;
+
+  if (unlikely (!g_file_set_contents (path.c_str (), buf.data (),
+                                      (gssize) buf.size (), &err)))
+    {
+      g_assert_nonnull (err);
+      tryset (errmsg, string (err->message));
+      g_error_free (err);
+      return false;
+    }
+  return true;
+}
+
+}
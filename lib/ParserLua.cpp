@@ -17,6 +17,7 @@
 
 #include "aux-ginga.h"
 #include "ParserLua.h"
+#include "LuaCache.h"
 
 #include "Context.h"
 #include "Media.h"
@@ -827,7 +828,10 @@ ParserLua::parseFile (const string &path, string *errmsg)
   luaL_openlibs (L);
 
   doc = nullptr;
-  err = luaL_dofile (L, path.c_str ());
+  if (unlikely (!LuaCache::loadFile (L, path, errmsg)))
+    goto done;
+
+  err = lua_pcall (L, 0, LUA_MULTRET, 0);
   if (unlikely (err != LUA_OK))
   {
     tryset (errmsg, g_strdup (luaL_checkstring (L, -1)));
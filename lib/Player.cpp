@@ -21,6 +21,7 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 #include "Player.h"
 #include "Media.h"
 
+#include "PlayerAudio.h"
 #include "PlayerImage.h"
 #include "PlayerText.h"
 #include "PlayerVideo.h"
@@ -38,7 +39,7 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 namespace ginga {
 
 // Mime-type table.
-static map<string, string> mime_table = {
+static const map<string, string> mime_table = {
   { "ac3", "audio/ac3" },
   { "avi", "video/x-msvideo" },
   { "avif", "image/avif" },
@@ -88,7 +89,7 @@ static map<string, string> mime_table = {
 static bool
 mime_table_index (const string &key, string *result)
 {
-  map<string, string>::iterator it;
+  map<string, string>::const_iterator it;
   if ((it = mime_table.find (key)) == mime_table.end ())
     return false;
   tryset (result, it->second);
@@ -103,7 +104,7 @@ typedef struct PlayerPropertyInfo
   string defval;         // default value
 } PlayerPropertyInfo;
 
-static map<string, PlayerPropertyInfo> player_property_map = {
+static const map<string, PlayerPropertyInfo> player_property_map = {
   { "background", { Player::PROP_BACKGROUND, true, "" } },
   { "balance", { Player::PROP_BALANCE, false, "0.0" } },
   { "bass", { Player::PROP_BASS, false, "0" } },
@@ -151,7 +152,7 @@ static map<string, PlayerPropertyInfo> player_property_map = {
   { "type", { Player::PROP_TYPE, true, "application/x-ginga-timer" } },
 };
 
-static map<string, string> player_property_aliases = {
+static const map<string, string> player_property_aliases = {
   { "backgroundColor", "background" },
   { "balanceLevel", "balance" },
   { "bassLevel", "bass" },
@@ -161,6 +162,62 @@ static map<string, string> player_property_aliases = {
   { "trebleLevel", "treble" },
 };
 
+// Reaper.
+
+/// Resource handed to the reaper thread.
+typedef struct
+{
+  void (*func) (gpointer); // release function
+  gpointer data;           // resource to release
+} PlayerReapJob;
+
+/// Reaper thread (single-threaded pool) and its pending job count.
+static GThreadPool *player_reaper;
+static guint player_reaper_pending;
+static GMutex player_reaper_mutex;
+static GCond player_reaper_cond;
+
+/// Releases resource in reaper thread.
+static void
+player_reaper_run (gpointer data, unused (gpointer user_data))
+{
+  PlayerReapJob *job = (PlayerReapJob *) data;
+
+  job->func (job->data);
+  delete job;
+
+  g_mutex_lock (&player_reaper_mutex);
+  player_reaper_pending--;
+  g_cond_broadcast (&player_reaper_cond);
+  g_mutex_unlock (&player_reaper_mutex);
+}
+
+/// Releases the pending resources and joins the reaper thread at exit.
+static void
+player_reaper_shutdown (void)
+{
+  if (player_reaper == nullptr)
+    return;
+  g_thread_pool_free (player_reaper, FALSE, TRUE);
+  player_reaper = nullptr;
+}
+
+/// Gets reaper thread (or null, if threads are not available).
+static GThreadPool *
+player_reaper_get ()
+{
+  static gsize init = 0;
+  if (g_once_init_enter (&init))
+    {
+      player_reaper = g_thread_pool_new (player_reaper_run, nullptr,
+                                         1, FALSE, nullptr);
+      if (player_reaper != nullptr)
+        atexit (player_reaper_shutdown);
+      g_once_init_leave (&init, 1);
+    }
+  return player_reaper;
+}
+
 // Public.
 
 Player::Player (Formatter *formatter, Media *media)
@@ -171,15 +228,23 @@ Player::Player (Formatter *formatter, Media *media)
   g_assert_nonnull (media);
   _media = media;
   _id = media->getId ();
+  _kind = "timer";
 
   _state = SLEEPING;
   _time = 0;
   _eos = false;
   _dirty = true;
+  _evictable = false;
+  _lastDrawn = 0;
+  _inputStamp = GINGA_TIME_NONE;
   _animator = new PlayerAnimator (_formatter, &_time);
   _surface = nullptr;
   _opengl = _formatter->getOptionBool ("opengl");
   _gltexture = 0;
+  _layout.left = _layout.top = _layout.right = _layout.bottom = { 0, false };
+  _layout.width = _layout.height = { 1., true };
+  _layout.fromRight = false;
+  _layout.fromBottom = false;
   this->resetProperties ();
 }
 
@@ -209,7 +274,14 @@ Player::getZ (int *zindex, int *zorder)
 bool
 Player::isFocused ()
 {
-  return _prop.focusIndex != "" && _prop.focusIndex == _currentFocus;
+  Document *doc;
+
+  if (_prop.focusIndex == "")
+    return false;
+
+  doc = _media->getDocument ();
+  g_assert_nonnull (doc);
+  return _prop.focusIndex == doc->getCurrentFocus ();
 }
 
 Time
@@ -256,6 +328,7 @@ Player::start ()
   _time = 0;
   _eos = false;
   this->reload ();
+  this->stampInput ();
   _animator->scheduleTransition ("start", &_prop.rect, &_prop.bgColor,
                                  &_prop.alpha, &_crop);
 }
@@ -266,6 +339,11 @@ Player::stop ()
   g_assert (_state != SLEEPING);
   _state = SLEEPING;
   this->resetProperties ();
+
+  // The player is gone by the next redraw, which presents the key press
+  // that stopped it (if any).
+  _formatter->setInputApplied (_formatter->getInputStamp ());
+  _inputStamp = GINGA_TIME_NONE;
 }
 
 void
@@ -273,6 +351,7 @@ Player::pause ()
 {
   g_assert (_state != PAUSED && _state != SLEEPING);
   _state = PAUSED;
+  this->stampInput ();
 }
 
 void
@@ -280,6 +359,7 @@ Player::resume ()
 {
   g_assert (_state == PAUSED);
   _state = OCCURRING;
+  this->stampInput ();
 }
 
 string
@@ -326,6 +406,7 @@ Player::setProperty (const string &name, const string &value)
 
 done:
   _properties[name] = _value;
+  this->stampInput ();
   return;
 }
 
@@ -339,7 +420,7 @@ Player::resetProperties ()
 }
 
 void
-Player::resetProperties (set<string> *props)
+Player::resetProperties (const set<string> *props)
 {
   for (auto name : *props)
     this->setProperty (name, "");
@@ -349,7 +430,89 @@ void
 Player::schedulePropertyAnimation (const string &name, const string &from,
                                    const string &to, Time dur)
 {
+  Property code;
+  list<string> lst;
+
   _animator->schedule (name, from, to, dur);
+
+  // Record the target geometry so that a later resize starts from the
+  // final value instead of the one that was in effect before animating.
+  code = Player::getPlayerProperty (name, nullptr);
+  switch (code)
+    {
+    case PROP_BOUNDS:
+      if (ginga::try_parse_list (to, ',', 4, 4, &lst))
+        {
+          auto it = lst.begin ();
+          this->setLayoutProperty (PROP_LEFT, *it++);
+          this->setLayoutProperty (PROP_TOP, *it++);
+          this->setLayoutProperty (PROP_WIDTH, *it++);
+          this->setLayoutProperty (PROP_HEIGHT, *it++);
+        }
+      break;
+    case PROP_LOCATION:
+      if (ginga::try_parse_list (to, ',', 2, 2, &lst))
+        {
+          auto it = lst.begin ();
+          this->setLayoutProperty (PROP_LEFT, *it++);
+          this->setLayoutProperty (PROP_TOP, *it++);
+        }
+      break;
+    case PROP_SIZE:
+      if (ginga::try_parse_list (to, ',', 2, 2, &lst))
+        {
+          auto it = lst.begin ();
+          this->setLayoutProperty (PROP_WIDTH, *it++);
+          this->setLayoutProperty (PROP_HEIGHT, *it++);
+        }
+      break;
+    default:
+      this->setLayoutProperty (code, to);
+      break;
+    }
+}
+
+/**
+ * @brief Recomputes player geometry from its layout constraints.
+ *
+ * Resolves the numeric constraints recorded by the left, top, width,
+ * height, right and bottom properties against the current screen size.
+ * The player is marked as dirty only if its rectangle actually changed.
+ */
+void
+Player::updateGeometry ()
+{
+  const GingaOptions *opts;
+  Rect rect;
+
+  opts = _formatter->getOptions ();
+  g_assert_nonnull (opts);
+
+#define RESOLVE(len, base)                                                 \
+  ((int) CLAMP ((len).percent ? lround ((len).value * (base))              \
+                              : lround ((len).value),                      \
+                0, G_MAXINT))
+
+  rect.width = RESOLVE (_layout.width, opts->width);
+  rect.height = RESOLVE (_layout.height, opts->height);
+  rect.x = (_layout.fromRight)
+               ? opts->width - rect.width - RESOLVE (_layout.right, opts->width)
+               : RESOLVE (_layout.left, opts->width);
+  rect.y = (_layout.fromBottom)
+               ? opts->height - rect.height
+                     - RESOLVE (_layout.bottom, opts->height)
+               : RESOLVE (_layout.top, opts->height);
+
+#undef RESOLVE
+
+  if (rect.x == _prop.rect.x && rect.y == _prop.rect.y
+      && rect.width == _prop.rect.width && rect.height == _prop.rect.height)
+    {
+      return; // nothing to do
+    }
+
+  _prop.rect = rect;
+  _dirty = true;
 }
 
 void
@@ -364,14 +527,24 @@ Player::redraw (cairo_t *cr)
   g_assert (_state != SLEEPING);
   _animator->update (&_prop.rect, &_prop.bgColor, &_prop.alpha, &_crop);
 
+  // This redraw presents the key press that changed the player, even if
+  // it is now hidden.
+  if (GINGA_TIME_IS_VALID (_inputStamp))
+    {
+      _formatter->setInputApplied (_inputStamp);
+      _inputStamp = GINGA_TIME_NONE;
+    }
+
   if (!_prop.visible || !(_prop.rect.width > 0 && _prop.rect.height > 0))
     {
       return; // nothing to do
     }
 
+  _lastDrawn = _formatter->getRedrawSerial ();
   if (_dirty)
     {
       this->reload ();
+      _formatter->setMemoryDirty ();
     }
 
   if (_prop.bgColor.alpha > 0)
@@ -485,33 +658,158 @@ void Player::sendKeyEvent (unused (const string &key), unused (bool press))
 {
 }
 
-// Public: Static.
-
-// Current focus index value.
-string Player::_currentFocus = "";
+/**
+ * @brief Tests whether player has anything to draw.
+ *
+ * Players that return false are left out of the formatter's z-sorted draw
+ * list and are never redrawn.
+ *
+ * @return True if player draws on screen, or false otherwise.
+ */
+bool
+Player::isDrawable ()
+{
+  return true;
+}
 
+/**
+ * @brief Gets player kind.
+ * @return The kind of player ("video", "image", "lua", etc.).
+ */
 string
-Player::getCurrentFocus ()
+Player::getKind ()
 {
-  return _currentFocus;
+  return _kind;
 }
 
+/**
+ * @brief Gets player resource usage.
+ *
+ * The default implementation accounts for the player surface and OpenGL
+ * texture.  Subclasses that track more (dropped frames, script time)
+ * extend it.
+ *
+ * @param metrics Variable to store the resulting metrics.
+ */
 void
-Player::setCurrentFocus (const string &index)
+Player::getMetrics (Player::Metrics *metrics)
 {
-  _currentFocus = index;
+  g_assert_nonnull (metrics);
+  metrics->surfaceBytes = 0;
+  metrics->textureBytes = 0;
+  metrics->pipelineBytes = 0;
+  metrics->droppedFrames = 0;
+  metrics->cycleTime = 0;
+  metrics->lastDrawn = _lastDrawn;
+
+  if (_surface != nullptr
+      && cairo_surface_get_type (_surface) == CAIRO_SURFACE_TYPE_IMAGE)
+    {
+      metrics->surfaceBytes
+        = (guint64) cairo_image_surface_get_stride (_surface)
+        * (guint64) cairo_image_surface_get_height (_surface);
+    }
+
+  // Textures are uploaded at the size of the output rectangle or of the
+  // source surface; we use the former, as it is always known.
+  if (_opengl && _gltexture)
+    {
+      metrics->textureBytes = (guint64) MAX (_prop.rect.width, 0)
+        * (guint64) MAX (_prop.rect.height, 0) * 4;
+    }
+}
+
+/**
+ * @brief Releases the player surface and OpenGL texture.
+ *
+ * Only players whose reload() regenerates these backing stores can be
+ * evicted; they are marked as dirty and get reloaded on the next redraw
+ * in which they are visible.
+ *
+ * @return The number of bytes released.
+ */
+guint64
+Player::evict ()
+{
+  Player::Metrics metrics;
+
+  if (!_evictable || (_surface == nullptr && !_gltexture))
+    return 0;
+
+  this->getMetrics (&metrics);
+  if (_surface != nullptr)
+    {
+      cairo_surface_destroy (_surface);
+      _surface = nullptr;
+    }
+  if (_gltexture)
+    GL::delete_texture (&_gltexture);
+  _dirty = true;
+
+  return metrics.surfaceBytes + metrics.textureBytes;
+}
+
+// Public: Static.
+
+/**
+ * @brief Releases resource asynchronously.
+ *
+ * Hands \p data to the reaper thread, which calls \p func on it.  Used by
+ * players to tear down GStreamer pipelines without blocking the caller.
+ * Resources whose release runs code bound to the main context (e.g.,
+ * NCLua states) must not be handed to it.  Resources still pending at
+ * process exit are released before the reaper thread is joined.  If
+ * threads are not available, \p func is called immediately.
+ *
+ * @param func Release function.
+ * @param data Resource to release.
+ */
+void
+Player::reap (void (*func) (gpointer), gpointer data)
+{
+  GThreadPool *pool;
+  PlayerReapJob *job;
+
+  pool = player_reaper_get ();
+  if (unlikely (pool == nullptr))
+    {
+      func (data);
+      return;
+    }
+
+  job = new PlayerReapJob;
+  job->func = func;
+  job->data = data;
+
+  g_mutex_lock (&player_reaper_mutex);
+  player_reaper_pending++;
+  g_mutex_unlock (&player_reaper_mutex);
+
+  g_thread_pool_push (pool, job, nullptr);
+}
+
+/**
+ * @brief Waits until all resources handed to reaper have been released.
+ */
+void
+Player::waitReaped ()
+{
+  g_mutex_lock (&player_reaper_mutex);
+  while (player_reaper_pending > 0)
+    g_cond_wait (&player_reaper_cond, &player_reaper_mutex);
+  g_mutex_unlock (&player_reaper_mutex);
 }
 
 Player::Property
 Player::getPlayerProperty (const string &name, string *defval)
 {
-  map<string, PlayerPropertyInfo>::iterator it;
-  PlayerPropertyInfo *info;
+  map<string, PlayerPropertyInfo>::const_iterator it;
+  const PlayerPropertyInfo *info;
   string _name = name;
 
   if ((it = player_property_map.find (_name)) == player_property_map.end ())
     {
-      map<string, string>::iterator italias;
+      map<string, string>::const_iterator italias;
       if ((italias = player_property_aliases.find (_name))
           == player_property_aliases.end ())
         {
@@ -568,26 +866,36 @@ Player::createPlayer (Formatter *formatter, Media *media, const string &uri,
     {
       ERROR_NOT_IMPLEMENTED ("NCL as Media object is not supported");
     }
-  else if (xstrhasprefix (mime, "audio") || xstrhasprefix (mime, "video"))
+  else if (xstrhasprefix (mime, "audio"))
+    {
+      player = new PlayerAudio (formatter, media);
+      player->_kind = "audio";
+    }
+  else if (xstrhasprefix (mime, "video"))
     {
       player = new PlayerVideo (formatter, media);
+      player->_kind = "video";
     }
   else if (mime == "application/x-ginga-siggen")
     {
       player = new PlayerSigGen (formatter, media);
+      player->_kind = "siggen";
     }
   else if (xstrhasprefix (mime, "image"))
     {
       player = new PlayerImage (formatter, media);
+      player->_kind = "image";
     }
   else if (mime == "text/plain")
     {
       player = new PlayerText (formatter, media);
+      player->_kind = "text";
     }
   // if has WS setted a remotePlayerBaseURL
   else if (PlayerRemote::usesPlayerRemote (media))
     {
       player = new PlayerRemote (formatter, media);
+      player->_kind = "remote";
       WARNING ("Create a PlayerRemote for Media '%s'",
                media->getId ().c_str ());
     }
@@ -595,15 +903,18 @@ Player::createPlayer (Formatter *formatter, Media *media, const string &uri,
   else if (xstrhasprefix (mime, "text/html"))
     {
       player = new PlayerHTML (formatter, media);
+      player->_kind = "html";
     }
 #endif // WITH_CEF
   else if (xstrhasprefix (mime, "image/svg"))
     {
       player = new PlayerSvg (formatter, media);
+      player->_kind = "svg";
     }
   else if (mime == "application/x-ginga-NCLua")
     {
       player = new PlayerLua (formatter, media);
+      player->_kind = "lua";
     }
   else
     {
@@ -697,58 +1008,15 @@ Player::doSetProperty (Property code, unused (const string &name),
         break;
       }
     case PROP_LEFT:
-      {
-        int width = _formatter->getOptionInt ("width");
-        _prop.rect.x = ginga::parse_percent (value, width, 0, G_MAXINT);
-        _dirty = true;
-        break;
-      }
     case PROP_RIGHT:
-      {
-        int width = _formatter->getOptionInt ("width");
-        _prop.rect.x = width - _prop.rect.width
-                       - ginga::parse_percent (value, width, 0, G_MAXINT);
-        _dirty = true;
-        break;
-      }
     case PROP_TOP:
-      {
-        int height = _formatter->getOptionInt ("height");
-        _prop.rect.y = ginga::parse_percent (value, height, 0, G_MAXINT);
-        _dirty = true;
-        break;
-      }
     case PROP_BOTTOM:
-      {
-        int height = _formatter->getOptionInt ("height");
-        _prop.rect.y = height - _prop.rect.height
-                       - ginga::parse_percent (value, _prop.rect.height, 0,
-                                               G_MAXINT);
-        _dirty = true;
-        break;
-      }
     case PROP_WIDTH:
-      {
-        int width = _formatter->getOptionInt ("width");
-        _prop.rect.width = ginga::parse_percent (value, width, 0, G_MAXINT);
-        _dirty = true;
-
-        string right = _media->getProperty ("right");
-        if (right != "")
-          _media->setProperty ("right", right);
-        break;
-      }
     case PROP_HEIGHT:
       {
-        int height = _formatter->getOptionInt ("height");
-        _prop.rect.height
-            = ginga::parse_percent (value, height, 0, G_MAXINT);
-        _dirty = true;
-
-        string bottom = _media->getProperty ("bottom");
-        if (bottom != "")
-          _media->setProperty ("bottom", bottom);
-
+        if (unlikely (!this->setLayoutProperty (code, value)))
+          return false;
+        this->updateGeometry ();
         break;
       }
     case PROP_Z_INDEX:
@@ -806,6 +1074,26 @@ Player::doSetProperty (Property code, unused (const string &name),
   return true;
 }
 
+/**
+ * @brief Marks player as changed by the key press being dispatched.
+ *
+ * Keeps the stamp of that key press (if any) until the next redraw, which
+ * reports it to the formatter as applied.  Players call this when
+ * something they draw changes.
+ */
+void
+Player::stampInput ()
+{
+  Time stamp;
+
+  if (GINGA_TIME_IS_VALID (_inputStamp) || !this->isDrawable ())
+    return;
+
+  stamp = _formatter->getInputStamp ();
+  if (GINGA_TIME_IS_VALID (stamp))
+    _inputStamp = stamp;
+}
+
 // Private.
 
 void
@@ -848,4 +1136,59 @@ Player::redrawDebuggingInfo (cairo_t *cr)
   cairo_surface_destroy (debug);
 }
 
+/**
+ * @brief Records a geometry property as a numeric layout constraint.
+ * @param code Property code.
+ * @param value Property value (pixels or percentage of the screen).
+ * @return True if successful, or false if property is not a geometry one.
+ */
+bool
+Player::setLayoutProperty (Property code, const string &value)
+{
+  Length len;
+
+  switch (code)
+    {
+    case PROP_LEFT:
+    case PROP_RIGHT:
+    case PROP_TOP:
+    case PROP_BOTTOM:
+    case PROP_WIDTH:
+    case PROP_HEIGHT:
+      break;
+    default:
+      return false;
+    }
+
+  len.value = xstrtodorpercent (value, &len.percent);
+  switch (code)
+    {
+    case PROP_LEFT:
+      _layout.left = len;
+      _layout.fromRight = false;
+      break;
+    case PROP_RIGHT:
+      _layout.right = len;
+      _layout.fromRight = true;
+      break;
+    case PROP_TOP:
+      _layout.top = len;
+      _layout.fromBottom = false;
+      break;
+    case PROP_BOTTOM:
+      _layout.bottom = len;
+      _layout.fromBottom = true;
+      break;
+    case PROP_WIDTH:
+      _layout.width = len;
+      break;
+    case PROP_HEIGHT:
+      _layout.height = len;
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+  return true;
+}
+
 }
@@ -84,6 +84,16 @@ public:
     PROP_REMOTE_PLAYER_BASE_URL
   };
 
+  struct Metrics // resource usage exported by /metrics
+  {
+    guint64 surfaceBytes;  // bytes held by the decoded surface
+    guint64 textureBytes;  // bytes held by the OpenGL texture (estimate)
+    guint64 pipelineBytes; // bytes queued in the decoding pipeline
+    guint64 droppedFrames; // frames dropped by the decoder
+    Time cycleTime;        // time spent running scripts
+    guint64 lastDrawn;     // redraw serial of the last frame it was drawn
+  };
+
   Player (Formatter *, Media *);
   virtual ~Player ();
 
@@ -91,13 +101,13 @@ public:
   void getZ (int *, int *);
   bool isFocused ();
 
-  Time getTime ();
+  virtual Time getTime ();
   void incTime (Time);
 
   Time getDuration ();
   void setDuration (Time);
 
-  bool getEOS ();
+  virtual bool getEOS ();
   void setEOS (bool);
 
   virtual void start ();
@@ -108,14 +118,20 @@ public:
   virtual string getProperty (const string &);
   virtual void setProperty (const string &, const string &);
   void resetProperties ();
-  void resetProperties (set<string> *);
+  void resetProperties (const set<string> *);
   void schedulePropertyAnimation (const string &, const string &,
                                   const string &, Time);
+  void updateGeometry ();
   virtual void reload ();
   virtual void redraw (cairo_t *);
+  virtual bool isDrawable ();
 
   virtual void sendKeyEvent (const string &, bool);
 
+  string getKind ();
+  virtual void getMetrics (Player::Metrics *);
+  guint64 evict ();
+
   // For now, only for the PlayerLua and PlayerRemote (which reimplements it).
   virtual void
   sendPresentationEvent (const string &, const string &)
@@ -123,17 +139,18 @@ public:
   }
 
   // Static.
-  static string getCurrentFocus ();
-  static void setCurrentFocus (const string &);
   static Property getPlayerProperty (const string &, string *);
   static bool getMimeForURI (const string &, string*);
   static Player *createPlayer (Formatter *, Media *, const string &,
                                const string &type = "");
+  static void reap (void (*) (gpointer), gpointer);
+  static void waitReaped ();
 
 protected:
   Formatter *_formatter;     // formatter handle
   Media *_media;             // associated media object
   string _id;                // id of the associated media object
+  string _kind;              // player kind ("video", "image", etc.)
   State _state;              // current state
   Time _time;                // playback time
   bool _eos;                 // true if content was exhausted
@@ -141,6 +158,9 @@ protected:
   bool _opengl;              // true if OpenGL is used
   guint _gltexture;          // OpenGL texture (if OpenGL is used)
   bool _dirty;               // true if surface should be reloaded
+  bool _evictable;           // true if reload() regenerates surface
+  guint64 _lastDrawn;        // redraw serial of the last frame drawn
+  Time _inputStamp;          // key press not yet drawn (see stampInput)
   PlayerAnimator *_animator; // associated animator
   list<int> _crop;           // polygon for cropping effect
 
@@ -164,14 +184,30 @@ protected:
     string uri;        // content URI
   } _prop;
 
+  struct Length
+  {
+    double value;      // pixels, or fraction of screen if percent is true
+    bool percent;      // true if value is relative to screen size
+  };
+  struct
+  {
+    Length left;       // distance from the left edge of the screen
+    Length top;        // distance from the top edge of the screen
+    Length width;      // width
+    Length height;     // height
+    Length right;      // distance from the right edge of the screen
+    Length bottom;     // distance from the bottom edge of the screen
+    bool fromRight;    // true if x is anchored to the right edge
+    bool fromBottom;   // true if y is anchored to the bottom edge
+  } _layout;
+
 protected:
   virtual bool doSetProperty (Property, const string &, const string &);
+  void stampInput ();
 
 private:
   void redrawDebuggingInfo (cairo_t *);
-
-  // Static.
-  static string _currentFocus; // current (global) focus index
+  bool setLayoutProperty (Property, const string &);
 };
 
 }
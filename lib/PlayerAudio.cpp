@@ -0,0 +1,491 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "aux-ginga.h"
+#include "PlayerAudio.h"
+#include "AudioMixer.h"
+
+namespace ginga {
+
+/// Detaches input from the mixer in reaper thread.
+static void
+player_audio_reap (gpointer data)
+{
+  AudioMixer::detach ((GstPad *) data);
+}
+
+/// Links the audio pad exposed by decoder to the filters.
+static void
+player_audio_pad_added (unused (GstElement *decoder), GstPad *pad,
+                        gpointer data)
+{
+  GstPad *sink;
+
+  sink = gst_element_get_static_pad (GST_ELEMENT (data), "sink");
+  g_assert_nonnull (sink);
+  if (!gst_pad_is_linked (sink)
+      && unlikely (gst_pad_link (pad, sink) != GST_PAD_LINK_OK))
+    WARNING ("cannot link %s", GST_PAD_NAME (pad));
+  gst_object_unref (sink);
+}
+
+/// Holds the data flow while the player is paused.
+static GstPadProbeReturn
+player_audio_block (unused (GstPad *pad), unused (GstPadProbeInfo *info),
+                    unused (gpointer data))
+{
+  return GST_PAD_PROBE_OK;
+}
+
+/// Flags that the input reached end of stream; runs in the streaming
+/// thread.  A flushing seek clears the flag, as decoding restarts.
+static GstPadProbeReturn
+player_audio_drain (unused (GstPad *pad), GstPadProbeInfo *info,
+                    gpointer data)
+{
+  switch (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)))
+    {
+    case GST_EVENT_EOS:
+      g_atomic_int_set ((gint *) data, 1);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      g_atomic_int_set ((gint *) data, 0);
+      break;
+    default:
+      break;
+    }
+  return GST_PAD_PROBE_OK;
+}
+
+// Public.
+
+PlayerAudio::PlayerAudio (Formatter *formatter, Media *media)
+    : Player (formatter, media)
+{
+  // GStreamer is initialized by the Formatter.
+  g_assert (gst_is_initialized ());
+
+  _bin = nullptr;
+  _pad = nullptr;
+  _audio = {};
+  _offset = 0;
+  _base = 0;
+  _pausedAt = 0;
+  _block = 0;
+  _drained = nullptr;
+  _drain = 0;
+  _duration = GINGA_TIME_NONE;
+
+  // Initialize handled properties.
+  static const set<string> handled = {
+    "balance", "bass", "mute", "treble", "volume",
+  };
+  this->resetProperties (&handled);
+}
+
+PlayerAudio::~PlayerAudio ()
+{
+  this->reapBin ();
+}
+
+void
+PlayerAudio::start ()
+{
+  GstCaps *caps;
+  GstPad *pad;
+  GstPad *ghost;
+
+  g_assert (_state != OCCURRING);
+  g_assert_null (_bin);
+  TRACE ("starting");
+
+  // Decode audio only: other streams are not even decoded.
+  _bin = gst_bin_new (nullptr);
+  g_assert_nonnull (_bin);
+  _audio.decoder = gst_element_factory_make ("uridecodebin", "decoder");
+  g_assert_nonnull (_audio.decoder);
+  caps = gst_caps_new_empty_simple ("audio/x-raw");
+  g_assert_nonnull (caps);
+  g_object_set (_audio.decoder, "uri", Player::_prop.uri.c_str (), "caps",
+                caps, nullptr);
+  gst_caps_unref (caps);
+
+  _audio.convert = gst_element_factory_make ("audioconvert", "convert");
+  g_assert_nonnull (_audio.convert);
+  _audio.pan = gst_element_factory_make ("audiopanorama", "pan");
+  g_assert_nonnull (_audio.pan);
+  _audio.equalizer
+      = gst_element_factory_make ("equalizer-3bands", "equalizer");
+  g_assert_nonnull (_audio.equalizer);
+  _audio.output = gst_element_factory_make ("audioconvert", "output");
+  g_assert_nonnull (_audio.output);
+
+  gst_bin_add_many (GST_BIN (_bin), _audio.decoder, _audio.convert,
+                    _audio.pan, _audio.equalizer, _audio.output, nullptr);
+  g_assert (gst_element_link_many (_audio.convert, _audio.pan,
+                                   _audio.equalizer, _audio.output,
+                                   nullptr));
+  g_signal_connect (_audio.decoder, "pad-added",
+                    G_CALLBACK (player_audio_pad_added), _audio.convert);
+
+  pad = gst_element_get_static_pad (_audio.output, "src");
+  g_assert_nonnull (pad);
+  ghost = gst_ghost_pad_new ("src", pad);
+  g_assert_nonnull (ghost);
+  g_assert (gst_element_add_pad (_bin, ghost));
+  gst_object_unref (pad);
+
+  // The flag is owned by the probe, so that it outlives a callback still
+  // running when the probe is removed.
+  _drained = g_new0 (gint, 1);
+  _drain = gst_pad_add_probe (
+      ghost,
+      (GstPadProbeType) (GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM
+                         | GST_PAD_PROBE_TYPE_EVENT_FLUSH),
+      player_audio_drain, _drained, g_free);
+  _duration = GINGA_TIME_NONE;
+
+  g_object_set (_audio.pan, "panorama", _prop.balance, nullptr);
+  g_object_set (_audio.equalizer, "band0", _prop.bass, "band1",
+                _prop.treble, "band2", _prop.treble, nullptr);
+
+  // Schedule the first sample to be mixed now.
+  _base = 0;
+  this->setOffset (AudioMixer::getRunningTime ());
+
+  _pad = AudioMixer::attach (_bin);
+  if (unlikely (_pad == nullptr))
+    {
+      WARNING ("cannot play %s: no audio mixer", _id.c_str ());
+      _bin = nullptr;
+      _audio = {};
+      _drained = nullptr;
+      _drain = 0;
+    }
+  else
+    {
+      g_object_set (_pad, "volume", _prop.volume, "mute", _prop.mute,
+                    nullptr);
+    }
+
+  Player::start ();
+}
+
+void
+PlayerAudio::stop ()
+{
+  g_assert (_state != SLEEPING);
+  TRACE ("stopping");
+
+  this->reapBin ();
+  Player::stop ();
+}
+
+void
+PlayerAudio::pause ()
+{
+  GstPad *src;
+
+  g_assert (_state != PAUSED && _state != SLEEPING);
+  TRACE ("pausing");
+
+  if (_bin != nullptr)
+    {
+      _pausedAt = AudioMixer::getRunningTime ();
+      src = gst_element_get_static_pad (_bin, "src");
+      g_assert_nonnull (src);
+      _block = gst_pad_add_probe (src, GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM,
+                                  player_audio_block, nullptr, nullptr);
+      gst_object_unref (src);
+    }
+  Player::pause ();
+}
+
+void
+PlayerAudio::resume ()
+{
+  GstPad *src;
+
+  g_assert (_state == PAUSED);
+  TRACE ("resuming");
+
+  if (_bin != nullptr)
+    {
+      // Shift the input by the time it was paused.
+      this->setOffset (_offset + AudioMixer::getRunningTime () - _pausedAt);
+      src = gst_element_get_static_pad (_bin, "src");
+      g_assert_nonnull (src);
+      gst_pad_remove_probe (src, _block);
+      _block = 0;
+      gst_object_unref (src);
+    }
+  Player::resume ();
+}
+
+/**
+ * @brief Tests whether player has anything to draw.
+ *
+ * Audio players have no visual output, so they never enter the
+ * formatter's draw list.
+ *
+ * @return False.
+ */
+bool
+PlayerAudio::isDrawable ()
+{
+  return false;
+}
+
+/**
+ * @brief Gets the playback position.
+ *
+ * The position is derived from the running time of the audio mixer, i.e.,
+ * it is the position of the sample being mixed.  Falls back to the
+ * tick-driven player time if the player is not attached to the mixer.
+ *
+ * @return The player time.
+ */
+Time
+PlayerAudio::getTime ()
+{
+  Time now;
+  Time start;
+  Time time;
+  Time dur;
+
+  if (_pad == nullptr || _state == SLEEPING)
+    return Player::getTime ();
+
+  now = (_state == PAUSED) ? _pausedAt : AudioMixer::getRunningTime ();
+  start = _offset + AudioMixer::getLatency ();
+  time = (now > start) ? _base + now - start : _base;
+
+  dur = this->getStreamDuration ();
+  if (GINGA_TIME_IS_VALID (dur) && time > dur)
+    time = dur;
+  return time;
+}
+
+/**
+ * @brief Tests whether player has exhausted its content.
+ *
+ * Besides the flag set by setEOS(), this checks whether the decoding bin
+ * has pushed end of stream into the audio mixer.
+ *
+ * @return True if content was exhausted, or false otherwise.
+ */
+bool
+PlayerAudio::getEOS ()
+{
+  if (_drained != nullptr && g_atomic_int_get (_drained))
+    Player::setEOS (true);
+  return Player::getEOS ();
+}
+
+/**
+ * @brief Gets the duration of the content being played.
+ *
+ * The duration is queried from the decoding bin, and kept once known.
+ *
+ * @return The stream duration, or \c GINGA_TIME_NONE if it is not known
+ * (yet).
+ */
+Time
+PlayerAudio::getStreamDuration ()
+{
+  gint64 dur;
+
+  if (GINGA_TIME_IS_VALID (_duration) || _bin == nullptr)
+    return _duration;
+
+  if (gst_element_query_duration (_bin, GST_FORMAT_TIME, &dur)
+      && dur >= 0)
+    _duration = (Time) dur;
+  return _duration;
+}
+
+void
+PlayerAudio::getMetrics (Player::Metrics *metrics)
+{
+  GstIterator *it;
+  GValue item = G_VALUE_INIT;
+
+  Player::getMetrics (metrics);
+  if (_bin == nullptr)
+    return;
+
+  // Queues report how many bytes they are holding.
+  it = gst_bin_iterate_recurse (GST_BIN (_bin));
+  while (gst_iterator_next (it, &item) == GST_ITERATOR_OK)
+    {
+      GObject *elt = G_OBJECT (g_value_get_object (&item));
+      if (g_object_class_find_property (G_OBJECT_GET_CLASS (elt),
+                                        "current-level-bytes"))
+        {
+          guint level = 0;
+          g_object_get (elt, "current-level-bytes", &level, nullptr);
+          metrics->pipelineBytes += level;
+        }
+      g_value_reset (&item);
+    }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+}
+
+// Protected.
+
+bool
+PlayerAudio::doSetProperty (Property code, const string &name,
+                            const string &value)
+{
+  switch (code)
+    {
+    case PROP_BALANCE:
+      _prop.balance = xstrtodorpercent (value, nullptr);
+      if (_audio.pan != nullptr)
+        g_object_set (_audio.pan, "panorama", _prop.balance, nullptr);
+      break;
+    case PROP_BASS:
+      _prop.bass = xstrtodorpercent (value, nullptr);
+      if (_audio.equalizer != nullptr)
+        g_object_set (_audio.equalizer, "band0", _prop.bass, nullptr);
+      break;
+    case PROP_MUTE:
+      _prop.mute = ginga::parse_bool (value);
+      if (_pad != nullptr)
+        g_object_set (_pad, "mute", _prop.mute, nullptr);
+      break;
+    case PROP_TREBLE:
+      _prop.treble = xstrtodorpercent (value, nullptr);
+      if (_audio.equalizer != nullptr)
+        g_object_set (_audio.equalizer, "band1", _prop.treble, "band2",
+                      _prop.treble, nullptr);
+      break;
+    case PROP_VOLUME:
+      _prop.volume = xstrtodorpercent (value, nullptr);
+      if (_pad != nullptr)
+        g_object_set (_pad, "volume", _prop.volume, nullptr);
+      break;
+    case PROP_TIME:
+      {
+        Time t;
+        Time cur;
+
+        if (_state == SLEEPING || value == "indefinite" || value == "")
+          break;
+        if (unlikely (!try_parse_time (value, &t)))
+          {
+            WARNING ("bad time '%s'", value.c_str ());
+            break;
+          }
+
+        cur = this->getTime ();
+        if (xstrhasprefix (value, "+"))
+          {
+            Time dur = this->getStreamDuration ();
+            t = cur + t;
+            if (GINGA_TIME_IS_VALID (dur) && t >= dur)
+              Player::setEOS (true);
+          }
+        else if (xstrhasprefix (value, "-"))
+          t = (t > cur) ? 0 : cur - t;
+        this->seek (t);
+        break;
+      }
+    default:
+      return Player::doSetProperty (code, name, value);
+    }
+  return true;
+}
+
+// Private.
+
+// Seeks decoder to \p time and schedules the new position to be mixed
+// now.
+void
+PlayerAudio::seek (Time time)
+{
+  GstPad *src;
+  GstEvent *evt;
+  Time now;
+
+  if (_bin == nullptr)
+    return;
+
+  evt = gst_event_new_seek (
+      1.0, GST_FORMAT_TIME,
+      (GstSeekFlags) (GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE),
+      GST_SEEK_TYPE_SET, (gint64) time, GST_SEEK_TYPE_NONE,
+      (gint64) GST_CLOCK_TIME_NONE);
+  g_assert_nonnull (evt);
+
+  src = gst_element_get_static_pad (_bin, "src");
+  g_assert_nonnull (src);
+  if (unlikely (!gst_pad_send_event (src, evt)))
+    WARNING ("seek to %" GINGA_TIME_FORMAT " failed",
+             GINGA_TIME_ARGS (time));
+  gst_object_unref (src);
+
+  now = AudioMixer::getRunningTime ();
+  if (_state == PAUSED)
+    _pausedAt = now;
+  _base = time;
+  this->setOffset (now);
+}
+
+// Sets the mixer running time at which the input's running time zero is
+// mixed.
+void
+PlayerAudio::setOffset (Time offset)
+{
+  GstPad *src;
+
+  _offset = offset;
+  src = gst_element_get_static_pad (_bin, "src");
+  g_assert_nonnull (src);
+  gst_pad_set_offset (src, (gint64) offset);
+  gst_object_unref (src);
+}
+
+// Hands input to the reaper thread, which detaches it from the mixer.  The
+// input is muted first, so that it stops being heard right away.
+void
+PlayerAudio::reapBin ()
+{
+  GstPad *src;
+
+  if (_pad == nullptr)
+    return;
+
+  // Removing the probe frees the EOS flag, once no callback is running.
+  src = gst_element_get_static_pad (_bin, "src");
+  g_assert_nonnull (src);
+  gst_pad_remove_probe (src, _drain);
+  gst_object_unref (src);
+
+  g_object_set (_pad, "mute", TRUE, nullptr);
+  Player::reap (player_audio_reap, _pad);
+  _pad = nullptr;
+  _bin = nullptr;
+  _audio = {};
+  _block = 0;
+  _drained = nullptr;
+  _drain = 0;
+  _duration = GINGA_TIME_NONE;
+}
+
+}
@@ -0,0 +1,76 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#ifndef PLAYER_AUDIO_H
+#define PLAYER_AUDIO_H
+
+#include "Player.h"
+
+namespace ginga {
+
+class PlayerAudio : public Player
+{
+public:
+  PlayerAudio (Formatter *, Media *);
+  ~PlayerAudio ();
+  void start () override;
+  void stop () override;
+  void pause () override;
+  void resume () override;
+  bool isDrawable () override;
+  Time getTime () override;
+  bool getEOS () override;
+  Time getStreamDuration ();
+  void getMetrics (Player::Metrics *) override;
+
+protected:
+  bool doSetProperty (Property, const string &, const string &) override;
+
+private:
+  GstElement *_bin; // decoding bin, attached to the audio mixer
+  GstPad *_pad;     // mixer pad (volume and mute are set here)
+  struct
+  {                        // audio pipeline
+    GstElement *decoder;   // uri decoder
+    GstElement *convert;   // convert audio format for the filters
+    GstElement *pan;       // balance filter
+    GstElement *equalizer; // equalizer filter
+    GstElement *output;    // convert audio format for the mixer
+  } _audio;
+  struct
+  {
+    bool mute;      // true if mute is on
+    double balance; // balance sound level
+    double volume;  // sound level
+    double treble;  // treble level (Default: 0; Range: -24 and +12)
+    double bass;    // bass level (Default: 0; Range: -24 and +12)
+  } _prop;
+  Time _offset;   // mixer running time at which position was _base
+  Time _base;     // playback position at _offset
+  Time _pausedAt; // mixer running time at the last pause
+  gulong _block;  // id of the probe blocking output while paused
+  gint *_drained; // set by the probe below when the input reaches EOS
+  gulong _drain;  // id of the probe watching for EOS
+  Time _duration; // stream duration (or GINGA_TIME_NONE if unknown)
+
+  void seek (Time);
+  void setOffset (Time);
+  void reapBin ();
+};
+
+}
+
+#endif // PLAYER_AUDIO_H
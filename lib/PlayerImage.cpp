@@ -87,6 +87,7 @@ cairox_surface_create_from_uri (const char *path, cairo_surface_t **dup)
 PlayerImage::PlayerImage (Formatter *formatter, Media *media)
     : Player (formatter, media)
 {
+  _evictable = true;
 }
 
 PlayerImage::~PlayerImage ()
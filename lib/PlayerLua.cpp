@@ -19,6 +19,7 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 #include "aux-gl.h"
 
 #include "PlayerLua.h"
+#include "LuaCache.h"
 #include "Media.h"
 
 namespace ginga {
@@ -36,7 +37,7 @@ namespace ginga {
 #define evt_key_send ncluaw_send_key_event
 
 /// Conversion from NCLua actions to NCL transitions
-static map<string, Event::Transition> nclua_act_to_ncl = {
+static const map<string, Event::Transition> nclua_act_to_ncl = {
   { "start", Event::START },   { "pause", Event::PAUSE },
   { "resume", Event::RESUME }, { "stop", Event::STOP },
   { "abort", Event::ABORT },
@@ -49,6 +50,7 @@ PlayerLua::PlayerLua (Formatter *formatter, Media *media)
 {
   _nw = NULL;
   _init_rect = { 0, 0, 0, 0 };
+  _cycleTime = 0;
 }
 
 PlayerLua::~PlayerLua ()
@@ -72,8 +74,19 @@ PlayerLua::start ()
 
   this->pwdSave (filename);
   _init_rect = _prop.rect;
-  _nw = ncluaw_open (filename, _init_rect.width, _init_rect.height,
+
+  // Try the compiled chunk first; fall back to the source if the cached
+  // chunk cannot be loaded by the NCLua state.
+  string chunk = LuaCache::getCachedPath (filename);
+  _nw = ncluaw_open (chunk.c_str (), _init_rect.width, _init_rect.height,
                      &errmsg);
+  if (unlikely (_nw == nullptr && chunk != filename))
+    {
+      TRACE ("cannot open cached chunk '%s': %s", chunk.c_str (), errmsg);
+      free (errmsg);
+      _nw = ncluaw_open (filename, _init_rect.width, _init_rect.height,
+                         &errmsg);
+    }
   g_free (filename);
 
   if (unlikely (_nw == nullptr))
@@ -93,10 +106,11 @@ PlayerLua::stop ()
 
   evt_ncl_send_presentation (_nw, "stop", "");
 
-  this->pwdSave ();
-  ncluaw_cycle (_nw);
-  this->pwdRestore ();
+  this->cycle ();
 
+  // The state is closed here, not in the reaper thread: closing it runs
+  // the script's finalizers and drops the sources NCLua (tcp, http, etc.)
+  // attached to the main context, which must not race with this thread.
   ncluaw_close (_nw);
   _nw = nullptr;
 
@@ -125,6 +139,10 @@ PlayerLua::sendKeyEvent (const string &key, bool press)
 {
   g_assert_nonnull (_nw);
   evt_key_send (_nw, press ? "press" : "release", key.c_str ());
+
+  // The script handles the key in the next cycle, which runs right before
+  // its canvas is drawn.
+  this->stampInput ();
 }
 
 void
@@ -134,6 +152,13 @@ PlayerLua::sendPresentationEvent (const string &action, const string &label)
   evt_ncl_send_presentation (_nw, action.c_str (), label.c_str ());
 }
 
+void
+PlayerLua::getMetrics (Player::Metrics *metrics)
+{
+  Player::getMetrics (metrics);
+  metrics->cycleTime = _cycleTime;
+}
+
 void
 PlayerLua::redraw (cairo_t *cr)
 {
@@ -143,9 +168,7 @@ PlayerLua::redraw (cairo_t *cr)
   g_assert (_state != SLEEPING);
   g_assert_nonnull (_nw);
 
-  this->pwdSave ();
-  ncluaw_cycle (_nw);
-  this->pwdRestore ();
+  this->cycle ();
 
   sfc = (cairo_surface_t *) ncluaw_debug_get_surface (_nw);
   g_assert_nonnull (sfc);
@@ -267,4 +290,17 @@ PlayerLua::pwdRestore ()
   do_chdir (_saved_pwd);
 }
 
+// Runs one NCLua cycle from the script's directory and accounts its time.
+void
+PlayerLua::cycle ()
+{
+  gint64 t0;
+
+  this->pwdSave ();
+  t0 = g_get_monotonic_time ();
+  ncluaw_cycle (_nw);
+  _cycleTime += (Time) (g_get_monotonic_time () - t0) * GINGA_USECOND;
+  this->pwdRestore ();
+}
+
 }
@@ -36,6 +36,7 @@ public:
   void redraw (cairo_t *) override;
   void sendKeyEvent (const string &, bool) override;
   void sendPresentationEvent (const string &, const string &) override;
+  void getMetrics (Player::Metrics *) override;
 
 protected:
   virtual bool doSetProperty (Property, const string &,
@@ -46,10 +47,12 @@ private:
   Rect _init_rect;   // initial output rectangle
   string _pwd;       // script's working dir
   string _saved_pwd; // saved working dir
+  Time _cycleTime;   // total time spent in ncluaw_cycle()
 
   void pwdSave (const string &);
   void pwdSave ();
   void pwdRestore ();
+  void cycle ();
 };
 
 }
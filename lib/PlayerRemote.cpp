@@ -34,7 +34,7 @@ namespace ginga {
 PlayerRemote::PlayerRemote (Formatter *fmt, Media *media)
     : Player (fmt, media)
 {
-  _session = nullptr;
+  _ws = fmt->getWebServices ();
 }
 
 /**
@@ -57,73 +57,62 @@ PlayerRemote::usesPlayerRemote (Media *media)
 
 PlayerRemote::~PlayerRemote ()
 {
-  g_object_unref (_session);
 }
 
-static void
-cb_action (SoupSession *session, SoupMessage *msg, gpointer user_data)
+// Builds the body of remote player action \p action.
+Json::Value
+PlayerRemote::buildAction (const string &action)
 {
-  string url;
-  auto player = (PlayerRemote *) user_data;
-  if (!msg->status_code == SOUP_STATUS_OK)
-    WARNING ("Failed to perform request to %s",
-             player->getProperty ("remotePlayerBaseURL").c_str ());
+  Json::Value body;
+  body["action"] = action;
+  body["delay"] = "0";
+  return body;
 }
 
+// Queues action \p body to the remote player.  The WebServices outbound
+// queue of the device coalesces and sends it at the end of the tick.
 void
-PlayerRemote::sendAction (const string &body, const string &label = "")
+PlayerRemote::sendAction (const Json::Value &body, const string &label = "")
 {
-  guint status;
-  SoupMessage *msg;
-
-  if (!_session)
-    _session = soup_session_new ();
-
-  string url = xstrbuild ("%s" REMOTE_PLAYER_ROUTE_NODES "%s",
-                          getProperty ("remotePlayerBaseURL").c_str (),
-                          (label == "") ? _media->getId ().c_str ()
-                                        : label.c_str ());
-
-  msg = soup_message_new (SOUP_METHOD_POST, url.c_str ());
-  soup_message_set_request (msg, "application/json", SOUP_MEMORY_COPY,
-                            body.c_str (), strlen (body.c_str ()));
-  soup_session_queue_message (_session, msg, cb_action, this);
+  g_assert_nonnull (_ws);
+  _ws->queueRemotePlayerAction (getProperty ("remotePlayerBaseURL"),
+                                (label == "") ? _media->getId () : label,
+                                body);
 }
 
 void
 PlayerRemote::start ()
 {
-  string zOrder = getProperty ("zOrder");
-  string body_props = xstrbuild (
-      REMOTE_PLAYER_JSON_ACT_WITH_PROPS, "start", 0,
-      getProperty ("top").c_str (), getProperty ("left").c_str (),
-      getProperty ("width").c_str (), getProperty ("height").c_str (),
-      getProperty ("zOrder").c_str (), "0%");
-  sendAction (body_props);
+  Json::Value body = this->buildAction ("start");
+  Json::Value &props = body["properties"];
+  props["bounds"]["top"] = getProperty ("top");
+  props["bounds"]["left"] = getProperty ("left");
+  props["bounds"]["width"] = getProperty ("width");
+  props["bounds"]["height"] = getProperty ("height");
+  props["zIndex"] = getProperty ("zOrder");
+  props["transparency"] = "0%";
+  sendAction (body);
   Player::start ();
 }
 
 void
 PlayerRemote::stop ()
 {
-  string body = xstrbuild (REMOTE_PLAYER_JSON_ACT, "stop", 0);
-  sendAction (body);
+  sendAction (this->buildAction ("stop"));
   Player::stop ();
 }
 
 void
 PlayerRemote::pause ()
 {
-  string body = xstrbuild (REMOTE_PLAYER_JSON_ACT, "pause", 0);
-  sendAction (body);
+  sendAction (this->buildAction ("pause"));
   Player::pause ();
 }
 
 void
 PlayerRemote::resume ()
 {
-  string body = xstrbuild (REMOTE_PLAYER_JSON_ACT, "resume", 0);
-  sendAction (body.c_str ());
+  sendAction (this->buildAction ("resume"));
   Player::resume ();
 }
 
@@ -131,8 +120,7 @@ void
 PlayerRemote::sendPresentationEvent (const string &action,
                                      const string &label)
 {
-  string body = xstrbuild (REMOTE_PLAYER_JSON_ACT, action.c_str (), 0);
-  sendAction (body, label);
+  sendAction (this->buildAction (action), label);
 }
 
 void
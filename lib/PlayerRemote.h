@@ -20,29 +20,12 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include "Player.h"
 #include <libsoup/soup.h>
+#include <json/json.h>
 
 namespace ginga {
 
 class WebServices;
 
-#define REMOTE_PLAYER_JSON_ACT                                             \
-  "{\
-     \"action\": \"%s\",\
-     \"delay\": \"%d\"\
-   }"
-
-#define REMOTE_PLAYER_JSON_ACT_WITH_PROPS                                  \
-  "{\
-     \"action\": \"%s\",\
-     \"delay\": \"%d\",\
-     \"properties\": \
-     {\
-        \"bounds\": {\"top\": \"%s\",\"left\": \"%s\",\"width\": \"%s\",\"height\": \"%s\"},\
-        \"zIndex\" : \"%s\",\
-        \"transparency\" : \"%s\"\
-      }\
-   }"
-
 #define REMOTE_PLAYER_JSON_MEDIA                                           \
   "{\
      \"appId\": \"%s\",\
@@ -73,10 +56,9 @@ public:
   void sendPresentationEvent (const string &, const string &);
 
 protected:
-  void sendAction (const string &, const string &);
-  bool _sessionStarted;
+  Json::Value buildAction (const string &);
+  void sendAction (const Json::Value &, const string &);
   WebServices *_ws;
-  SoupSession *_session;
 };
 
 }
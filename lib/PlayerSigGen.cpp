@@ -18,159 +18,112 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 #include "aux-ginga.h"
 #include "aux-gl.h"
 #include "PlayerSigGen.h"
+#include "AudioMixer.h"
 
 namespace ginga {
 
-#define gstx_element_get_state(elt, st, pend, tout)                        \
-  g_assert (gst_element_get_state ((elt), (st), (pend), (tout))            \
-            != GST_STATE_CHANGE_FAILURE)
-
-#define gstx_element_get_state_sync(elt, st, pend)                         \
-  gstx_element_get_state ((elt), (st), (pend), GST_CLOCK_TIME_NONE)
-
-#define gstx_element_set_state(elt, st)                                    \
-  g_assert (gst_element_set_state ((elt), (st)) != GST_STATE_CHANGE_FAILURE)
-
-#define gstx_element_set_state_sync(elt, st)                               \
-  G_STMT_START                                                             \
-  {                                                                        \
-    gstx_element_set_state ((elt), (st));                                  \
-    gstx_element_get_state_sync ((elt), nullptr, nullptr);                 \
-  }                                                                        \
-  G_STMT_END
+/// Detaches input from the mixer in reaper thread.
+static void
+player_siggen_reap (gpointer data)
+{
+  AudioMixer::detach ((GstPad *) data);
+}
 
-// Public.
+/// Holds the data flow while the player is paused.
+static GstPadProbeReturn
+player_siggen_block (unused (GstPad *pad), unused (GstPadProbeInfo *info),
+                     unused (gpointer data))
+{
+  return GST_PAD_PROBE_OK;
+}
 
-PlayerSigGen::PlayerSigGen (Formatter *formatter, Media *media)
-    : Player (formatter, media)
+/// Video (scope) branch being removed from a running pipeline.
+typedef struct
 {
-  GstBus *bus;
-  gulong ret;
-
-  _pipeline = nullptr;
-  _audio.src = nullptr;
-  _audio.convert = nullptr;
-  _audio.tee = nullptr;
-  _audio.audioQueue = nullptr;
-  _audio.audioSink = nullptr;
-  _audio.videoQueue = nullptr;
-  _audio.videoScope = nullptr;
-  _audio.videoConvert = nullptr;
-  _audio.videoSink = nullptr;
+  GstElement *bin;      // input bin (ref)
+  GstElement *tee;      // tee (ref)
+  GstPad *teePad;       // tee pad feeding the branch (ref)
+  GstElement *elts[4];  // queue, scope, convert and sink
+  bool unlinked;        // true if branch was unlinked from tee
+} PlayerSigGenScope;
+
+/// Stops branch elements and releases them in reaper thread.
+static void
+player_siggen_reap_scope (gpointer data)
+{
+  PlayerSigGenScope *scope = (PlayerSigGenScope *) data;
 
-  if (!gst_is_initialized ())
+  for (auto elt : scope->elts)
     {
-      GError *error = nullptr;
-      if (unlikely (!gst_init_check (nullptr, nullptr, &error)))
-        {
-          g_assert_nonnull (error);
-          ERROR ("%s", error->message);
-          g_error_free (error);
-        }
+      gst_element_set_state (elt, GST_STATE_NULL);
+      gst_bin_remove (GST_BIN (scope->bin), elt);
     }
+  gst_element_release_request_pad (scope->tee, scope->teePad);
+  gst_object_unref (scope->teePad);
+  gst_object_unref (scope->tee);
+  gst_object_unref (scope->bin);
+  delete scope;
+}
 
-  _pipeline = gst_pipeline_new ("pipeline");
-  g_assert_nonnull (_pipeline);
-
-  bus = gst_pipeline_get_bus (GST_PIPELINE (_pipeline));
-  g_assert_nonnull (bus);
-  ret = gst_bus_add_watch (bus, (GstBusFunc) cb_Bus, this);
-  g_assert (ret > 0);
-  gst_object_unref (bus);
-
-  // Setup audio pipeline.
-  _audio.src = gst_element_factory_make ("audiotestsrc", "audio.src");
-  g_assert_nonnull (_audio.src);
-  _audio.convert
-      = gst_element_factory_make ("audioconvert", "audioconvert");
-  g_assert_nonnull (_audio.convert);
-  _audio.tee = gst_element_factory_make ("tee", "teesplit");
-  g_assert_nonnull (_audio.tee);
-
-  // Audio thread
-  _audio.audioQueue = gst_element_factory_make ("queue", "audioqueue");
-  g_assert_nonnull (_audio.audioQueue);
-  // Try to use ALSA if available.
-  _audio.audioSink = gst_element_factory_make ("alsasink", "audio.sink");
-  if (_audio.audioSink == nullptr)
-    _audio.audioSink
-        = gst_element_factory_make ("autoaudiosink", "audio.sink");
-  g_assert_nonnull (_audio.audioSink);
-
-  // Video thread
-  _audio.videoQueue = gst_element_factory_make ("queue", "videoqueue");
-  g_assert_nonnull (_audio.videoQueue);
-  _audio.videoScope = gst_element_factory_make ("spectrascope", "scope");
-  g_assert_nonnull (_audio.videoScope);
-  _audio.videoConvert
-      = gst_element_factory_make ("videoconvert", "videoconvert");
-  g_assert_nonnull (_audio.videoConvert);
-  _audio.videoSink = gst_element_factory_make ("appsink", "videosink");
-  g_assert_nonnull (_audio.videoSink);
-  g_object_set (_audio.videoSink, "max-buffers", 100, "drop", true,
-                nullptr);
-
-  // Pipeline add
-  g_assert (gst_bin_add (GST_BIN (_pipeline), _audio.src));
-  g_assert (gst_bin_add (GST_BIN (_pipeline), _audio.convert));
-  g_assert (gst_bin_add (GST_BIN (_pipeline), _audio.tee));
-  g_assert (gst_bin_add (GST_BIN (_pipeline), _audio.audioQueue));
-  g_assert (gst_bin_add (GST_BIN (_pipeline), _audio.audioSink));
-  g_assert (gst_bin_add (GST_BIN (_pipeline), _audio.videoQueue));
-  g_assert (gst_bin_add (GST_BIN (_pipeline), _audio.videoScope));
-  g_assert (gst_bin_add (GST_BIN (_pipeline), _audio.videoConvert));
-  g_assert (gst_bin_add (GST_BIN (_pipeline), _audio.videoSink));
-
-  // Pipeline common link
-  g_assert (gst_element_link (_audio.src, _audio.convert));
-  g_assert (gst_element_link (_audio.convert, _audio.tee));
-
-  // Pipeline audio link
-  g_assert (gst_element_link (_audio.audioQueue, _audio.audioSink));
-
-  // Pipeline video link
-  g_assert (gst_element_link (_audio.videoQueue, _audio.videoScope));
-  g_assert (gst_element_link (_audio.videoScope, _audio.videoConvert));
-  g_assert (gst_element_link (_audio.videoConvert, _audio.videoSink));
-
-  // Audio pad linking
-  _audio.teeAudioPad = gst_element_get_request_pad (_audio.tee, "src_%u");
-  g_assert_nonnull (_audio.teeAudioPad);
-  _audio.queueAudioPad
-      = gst_element_get_static_pad (_audio.audioQueue, "sink");
-  g_assert_nonnull (_audio.queueAudioPad);
+/// Unlinks branch from tee once no buffer is flowing through tee pad.
+static GstPadProbeReturn
+player_siggen_unlink_scope (GstPad *pad, unused (GstPadProbeInfo *info),
+                            gpointer data)
+{
+  PlayerSigGenScope *scope = (PlayerSigGenScope *) data;
+  GstPad *peer;
 
-  if (gst_pad_link (_audio.teeAudioPad, _audio.queueAudioPad)
-      != GST_PAD_LINK_OK)
+  peer = gst_pad_get_peer (pad);
+  if (peer != nullptr)
     {
-      ERROR ("Tee and audio queue not linked");
+      gst_pad_unlink (pad, peer);
+      gst_object_unref (peer);
     }
+  scope->unlinked = true;
+  return GST_PAD_PROBE_REMOVE;
+}
 
-  // Video pad linking
-  _audio.teeVideoPad = gst_element_get_request_pad (_audio.tee, "src_%u");
-  g_assert_nonnull (_audio.teeVideoPad);
-  _audio.queueVideoPad
-      = gst_element_get_static_pad (_audio.videoQueue, "sink");
-  g_assert_nonnull (_audio.queueVideoPad);
+/// Hands unlinked branch to reaper.  Called when the unlink probe is
+/// removed, either after it ran or because the bin was destroyed first;
+/// in the latter case, the branch goes with the bin.
+static void
+player_siggen_unlink_scope_done (gpointer data)
+{
+  PlayerSigGenScope *scope = (PlayerSigGenScope *) data;
 
-  if (gst_pad_link (_audio.teeVideoPad, _audio.queueVideoPad)
-      != GST_PAD_LINK_OK)
+  if (scope->unlinked)
     {
-      ERROR ("Tee and video queue not linked");
+      Player::reap (player_siggen_reap_scope, scope);
+      return;
     }
+  gst_object_unref (scope->teePad);
+  gst_object_unref (scope->tee);
+  gst_object_unref (scope->bin);
+  delete scope;
+}
 
-  gst_object_unref (_audio.queueAudioPad);
-  gst_object_unref (_audio.queueVideoPad);
+// Public.
+
+PlayerSigGen::PlayerSigGen (Formatter *formatter, Media *media)
+    : Player (formatter, media)
+{
+  // GStreamer is initialized by the Formatter.
+  g_assert (gst_is_initialized ());
+
+  _bin = nullptr;
+  _pad = nullptr;
+  _audio = {};
+  _offset = 0;
+  _pausedAt = 0;
+  _block = 0;
 
   // Callbacks.
   _callbacks.eos = nullptr;
   _callbacks.new_preroll = nullptr;
   _callbacks.new_sample = cb_NewSample;
-  gst_app_sink_set_callbacks (GST_APP_SINK (_audio.videoSink), &_callbacks,
-                              this, nullptr);
 
   // Initialize handled properties.
-  static set<string> handled = {
+  static const set<string> handled = {
     "freq", "wave", "volume",
   };
   this->resetProperties (&handled);
@@ -178,34 +131,79 @@ PlayerSigGen::PlayerSigGen (Formatter *formatter, Media *media)
 
 PlayerSigGen::~PlayerSigGen ()
 {
+  this->reapBin ();
 }
 
 void
 PlayerSigGen::start ()
 {
-  GstCaps *caps;
-  GstStructure *st;
-  GstStateChangeReturn ret;
+  GstPad *pad;
+  GstPad *ghost;
 
   g_assert (_state != OCCURRING);
+  g_assert_null (_bin);
   TRACE ("starting");
 
-  st = gst_structure_new_empty ("audio/x-raw");
-  gst_structure_set (st, "format", G_TYPE_STRING, "BGRA", nullptr);
-
-  caps = gst_caps_new_full (st, nullptr);
-  g_assert_nonnull (caps);
-
   Player::setEOS (false);
   g_atomic_int_set (&_sample_flag, 0);
 
+  // Setup the input bin: the generated signal is split between the mixer
+  // and, while the media is visible, the scope.
+  _bin = gst_bin_new (nullptr);
+  g_assert_nonnull (_bin);
+  _audio.src = gst_element_factory_make ("audiotestsrc", "audio.src");
+  g_assert_nonnull (_audio.src);
+  _audio.convert
+      = gst_element_factory_make ("audioconvert", "audioconvert");
+  g_assert_nonnull (_audio.convert);
+  _audio.tee = gst_element_factory_make ("tee", "teesplit");
+  g_assert_nonnull (_audio.tee);
+  _audio.audioQueue = gst_element_factory_make ("queue", "audioqueue");
+  g_assert_nonnull (_audio.audioQueue);
+
+  gst_bin_add_many (GST_BIN (_bin), _audio.src, _audio.convert,
+                    _audio.tee, _audio.audioQueue, nullptr);
+  g_assert (gst_element_link_many (_audio.src, _audio.convert, _audio.tee,
+                                   nullptr));
+
+  _audio.teeAudioPad = gst_element_get_request_pad (_audio.tee, "src_%u");
+  g_assert_nonnull (_audio.teeAudioPad);
+  _audio.queueAudioPad
+      = gst_element_get_static_pad (_audio.audioQueue, "sink");
+  g_assert_nonnull (_audio.queueAudioPad);
+  if (gst_pad_link (_audio.teeAudioPad, _audio.queueAudioPad)
+      != GST_PAD_LINK_OK)
+    {
+      ERROR ("Tee and audio queue not linked");
+    }
+  gst_object_unref (_audio.queueAudioPad);
+  _audio.queueAudioPad = nullptr;
+
+  pad = gst_element_get_static_pad (_audio.audioQueue, "src");
+  g_assert_nonnull (pad);
+  ghost = gst_ghost_pad_new ("src", pad);
+  g_assert_nonnull (ghost);
+  g_assert (gst_element_add_pad (_bin, ghost));
+  gst_object_unref (pad);
+
   // Initialize properties.
   g_object_set (_audio.src, "freq", _prop.freq, "wave", _prop.wave,
                 "volume", _prop.volume, nullptr);
 
-  ret = gst_element_set_state (_pipeline, GST_STATE_PLAYING);
-  if (unlikely (ret == GST_STATE_CHANGE_FAILURE))
-    Player::setEOS (true);
+  if (this->wantsScope ())
+    this->attachScope ();
+
+  // Schedule the first sample to be mixed now.
+  this->setOffset (AudioMixer::getRunningTime ());
+
+  _pad = AudioMixer::attach (_bin);
+  if (unlikely (_pad == nullptr))
+    {
+      WARNING ("cannot play %s: no audio mixer", _id.c_str ());
+      _bin = nullptr;
+      _audio = {};
+      Player::setEOS (true);
+    }
 
   Player::start ();
   TRACE ("started");
@@ -217,28 +215,49 @@ PlayerSigGen::stop ()
   g_assert (_state != SLEEPING);
   TRACE ("stopping");
 
-  gstx_element_set_state_sync (_pipeline, GST_STATE_NULL);
-  gst_object_unref (_pipeline);
+  this->reapBin ();
   Player::stop ();
 }
 
 void
 PlayerSigGen::pause ()
 {
+  GstPad *src;
+
   g_assert (_state != PAUSED && _state != SLEEPING);
   TRACE ("pausing");
 
-  gstx_element_set_state_sync (_pipeline, GST_STATE_PAUSED);
+  // Blocking the converter output stalls both the sound and the scope.
+  if (_bin != nullptr)
+    {
+      _pausedAt = AudioMixer::getRunningTime ();
+      src = gst_element_get_static_pad (_audio.convert, "src");
+      g_assert_nonnull (src);
+      _block = gst_pad_add_probe (src, GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM,
+                                  player_siggen_block, nullptr, nullptr);
+      gst_object_unref (src);
+    }
   Player::pause ();
 }
 
 void
 PlayerSigGen::resume ()
 {
+  GstPad *src;
+
   g_assert (_state == PAUSED);
   TRACE ("resuming");
 
-  gstx_element_set_state_sync (_pipeline, GST_STATE_PLAYING);
+  if (_bin != nullptr)
+    {
+      // Shift the input by the time it was paused.
+      this->setOffset (_offset + AudioMixer::getRunningTime () - _pausedAt);
+      src = gst_element_get_static_pad (_audio.convert, "src");
+      g_assert_nonnull (src);
+      gst_pad_remove_probe (src, _block);
+      _block = 0;
+      gst_object_unref (src);
+    }
   Player::resume ();
 }
 
@@ -260,7 +279,13 @@ PlayerSigGen::redraw (cairo_t *cr)
 
   g_assert (_state != SLEEPING);
 
-  if (Player::getEOS ())
+  // Run the scope only while there is somewhere to show it.
+  if (_bin != nullptr && this->wantsScope ())
+    this->attachScope ();
+  else
+    this->detachScope ();
+
+  if (Player::getEOS () || _audio.videoSink == nullptr)
     goto done;
 
   if (!g_atomic_int_compare_and_exchange (&_sample_flag, 1, 0))
@@ -323,7 +348,7 @@ PlayerSigGen::doSetProperty (Property code, unused (const string &name),
     {
     case PROP_FREQ:
       _prop.freq = xstrtodorpercent (value, nullptr);
-      if (_state != SLEEPING)
+      if (_audio.src != nullptr)
         g_object_set (_audio.src, "freq", _prop.freq, nullptr);
       break;
     case PROP_WAVE:
@@ -357,7 +382,7 @@ PlayerSigGen::doSetProperty (Property code, unused (const string &name),
       else if (value == "violet-noise")
         _prop.wave = 12;
 
-      if (_state != SLEEPING)
+      if (_audio.src != nullptr)
         {
           g_object_set (_audio.src, "wave", _prop.wave, nullptr);
         }
@@ -365,7 +390,7 @@ PlayerSigGen::doSetProperty (Property code, unused (const string &name),
     case PROP_VOLUME:
       _prop.volume = xstrtodorpercent (value, nullptr);
       TRACE ("Vol: %f", _prop.volume);
-      if (_state != SLEEPING)
+      if (_audio.src != nullptr)
         g_object_set (_audio.src, "volume", _prop.volume, nullptr);
       break;
     default:
@@ -374,52 +399,152 @@ PlayerSigGen::doSetProperty (Property code, unused (const string &name),
   return true;
 }
 
-// Private: Static (GStreamer callbacks).
+// Private.
 
-gboolean
-PlayerSigGen::cb_Bus (GstBus *bus, GstMessage *msg, PlayerSigGen *player)
+// Tests whether the scope has somewhere to be shown.
+bool
+PlayerSigGen::wantsScope ()
 {
-  g_assert_nonnull (bus);
-  g_assert_nonnull (msg);
-  g_assert_nonnull (player);
+  return Player::_prop.visible && Player::_prop.rect.width > 0
+         && Player::_prop.rect.height > 0;
+}
+
+// Builds the video (scope) branch and links it to a new tee pad.  Does
+// nothing if the branch already exists.
+void
+PlayerSigGen::attachScope ()
+{
+  if (_audio.videoSink != nullptr)
+    return;
+
+  _audio.videoQueue = gst_element_factory_make ("queue", nullptr);
+  g_assert_nonnull (_audio.videoQueue);
+  _audio.videoScope = gst_element_factory_make ("spectrascope", nullptr);
+  g_assert_nonnull (_audio.videoScope);
+  _audio.videoConvert = gst_element_factory_make ("videoconvert", nullptr);
+  g_assert_nonnull (_audio.videoConvert);
+  _audio.videoSink = gst_element_factory_make ("appsink", nullptr);
+  g_assert_nonnull (_audio.videoSink);
+  g_object_set (_audio.videoSink, "max-buffers", 100, "drop", true,
+                nullptr);
+  gst_app_sink_set_callbacks (GST_APP_SINK (_audio.videoSink), &_callbacks,
+                              this, nullptr);
 
-  switch (GST_MESSAGE_TYPE (msg))
+  gst_bin_add_many (GST_BIN (_bin), _audio.videoQueue,
+                    _audio.videoScope, _audio.videoConvert,
+                    _audio.videoSink, nullptr);
+  g_assert (gst_element_link_many (_audio.videoQueue, _audio.videoScope,
+                                   _audio.videoConvert, _audio.videoSink,
+                                   nullptr));
+
+  // Bring the branch up before data reaches it.
+  gst_element_sync_state_with_parent (_audio.videoSink);
+  gst_element_sync_state_with_parent (_audio.videoConvert);
+  gst_element_sync_state_with_parent (_audio.videoScope);
+  gst_element_sync_state_with_parent (_audio.videoQueue);
+
+  _audio.teeVideoPad = gst_element_get_request_pad (_audio.tee, "src_%u");
+  g_assert_nonnull (_audio.teeVideoPad);
+  _audio.queueVideoPad
+      = gst_element_get_static_pad (_audio.videoQueue, "sink");
+  g_assert_nonnull (_audio.queueVideoPad);
+
+  if (gst_pad_link (_audio.teeVideoPad, _audio.queueVideoPad)
+      != GST_PAD_LINK_OK)
     {
-    case GST_MESSAGE_EOS:
-      {
-        TRACE ("EOS");
-        break;
-      }
-    case GST_MESSAGE_ERROR:
-    case GST_MESSAGE_WARNING:
-      {
-        GstObject *obj = nullptr;
-        GError *error = nullptr;
-
-        obj = GST_MESSAGE_SRC (msg);
-        g_assert_nonnull (obj);
-
-        if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
-          {
-            gst_message_parse_error (msg, &error, nullptr);
-            g_assert_nonnull (error);
-            ERROR ("%s", error->message);
-          }
-        else
-          {
-            gst_message_parse_warning (msg, &error, nullptr);
-            g_assert_nonnull (error);
-            WARNING ("%s", error->message);
-          }
-        g_error_free (error);
-        break;
-      }
-    default:
-      break;
+      ERROR ("Tee and video queue not linked");
     }
-  return TRUE;
+
+  gst_object_unref (_audio.queueVideoPad);
+  _audio.queueVideoPad = nullptr;
 }
 
+// Tears down the video (scope) branch.  The branch is unlinked from the
+// tee by an idle probe on the tee pad, i.e., between two buffers, and its
+// elements are released by the reaper thread.  Does nothing if there is
+// no branch.
+void
+PlayerSigGen::detachScope ()
+{
+  PlayerSigGenScope *scope;
+  GstAppSinkCallbacks none = {};
+
+  if (_audio.videoSink == nullptr)
+    return;
+
+  // Stop samples from reaching this player right away.
+  gst_app_sink_set_callbacks (GST_APP_SINK (_audio.videoSink), &none,
+                              nullptr, nullptr);
+  g_atomic_int_set (&_sample_flag, 0);
+
+  scope = new PlayerSigGenScope;
+  scope->bin = GST_ELEMENT (gst_object_ref (_bin));
+  scope->tee = GST_ELEMENT (gst_object_ref (_audio.tee));
+  scope->teePad = _audio.teeVideoPad;
+  scope->elts[0] = _audio.videoQueue;
+  scope->elts[1] = _audio.videoScope;
+  scope->elts[2] = _audio.videoConvert;
+  scope->elts[3] = _audio.videoSink;
+  scope->unlinked = false;
+
+  gst_pad_add_probe (_audio.teeVideoPad, GST_PAD_PROBE_TYPE_IDLE,
+                     player_siggen_unlink_scope, scope,
+                     player_siggen_unlink_scope_done);
+
+  _audio.teeVideoPad = nullptr;
+  _audio.videoQueue = nullptr;
+  _audio.videoScope = nullptr;
+  _audio.videoConvert = nullptr;
+  _audio.videoSink = nullptr;
+
+  // Drop the last frame of the scope.
+  if (_surface != nullptr)
+    {
+      cairo_surface_destroy (_surface);
+      _surface = nullptr;
+    }
+  if (_gltexture)
+    GL::delete_texture (&_gltexture);
+}
+
+// Sets the mixer running time at which the input's running time zero is
+// mixed.  The offset is set before the tee, so that the scope is shown in
+// sync with the mixed sound.
+void
+PlayerSigGen::setOffset (Time offset)
+{
+  GstPad *src;
+
+  _offset = offset;
+  src = gst_element_get_static_pad (_audio.convert, "src");
+  g_assert_nonnull (src);
+  gst_pad_set_offset (src, (gint64) offset);
+  gst_object_unref (src);
+}
+
+// Hands input to the reaper thread, which detaches it from the mixer.  The
+// input is muted and the scope disconnected from this player first.
+void
+PlayerSigGen::reapBin ()
+{
+  GstAppSinkCallbacks none = {};
+
+  if (_pad == nullptr)
+    return;
+
+  if (_audio.videoSink != nullptr)
+    gst_app_sink_set_callbacks (GST_APP_SINK (_audio.videoSink), &none,
+                                nullptr, nullptr);
+  g_object_set (_pad, "mute", TRUE, nullptr);
+  Player::reap (player_siggen_reap, _pad);
+  _pad = nullptr;
+  _bin = nullptr;
+  _audio = {};
+  _block = 0;
+}
+
+// Private: Static (GStreamer callbacks).
+
 GstFlowReturn
 PlayerSigGen::cb_NewSample (unused (GstAppSink *appsink), gpointer data)
 {
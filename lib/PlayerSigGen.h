@@ -37,14 +37,14 @@ protected:
   bool doSetProperty (Property, const string &, const string &) override;
 
 private:
-  GstElement *_pipeline; // pipeline
+  GstElement *_bin; // generator bin, attached to the audio mixer
+  GstPad *_pad;     // mixer pad
   struct
   {                           // audio pipeline
     GstElement *src;          // Audio Test Src format
     GstElement *convert;      // convert audio format
     GstElement *tee;          // splits pipeline
-    GstElement *audioQueue;   // links audio pipeline side
-    GstElement *audioSink;    // audio sink
+    GstElement *audioQueue;   // links audio pipeline side (to the mixer)
     GstElement *videoQueue;   // links video pipeline side
     GstElement *videoScope;   // video draw style
     GstElement *videoConvert; // convert video format
@@ -65,9 +65,17 @@ private:
     int wave;      // wave
     double volume; // sound level
   } _prop;
+  Time _offset;   // mixer running time at which the signal started
+  Time _pausedAt; // mixer running time at the last pause
+  gulong _block;  // id of the probe blocking output while paused
+
+  bool wantsScope ();
+  void attachScope ();
+  void detachScope ();
+  void setOffset (Time);
+  void reapBin ();
 
   // GStreamer callbacks.
-  static gboolean cb_Bus (GstBus *, GstMessage *, PlayerSigGen *);
   static GstFlowReturn cb_NewSample (GstAppSink *, gpointer);
 };
 
@@ -24,6 +24,7 @@ namespace ginga {
 PlayerSvg::PlayerSvg (Formatter *formatter, Media *media)
     : Player (formatter, media)
 {
+  _evictable = true;
 }
 
 PlayerSvg::~PlayerSvg ()
@@ -152,8 +152,10 @@ PlayerText::renderSurface (const string &text, const string &family,
 PlayerText::PlayerText (Formatter *formatter, Media *media)
     : Player (formatter, media)
 {
+  _evictable = true;
+
   // Initialize handled properties.
-  static set<string> handled = {
+  static const set<string> handled = {
     "fontColor",   "bgColor",    "fontFamily", "fontSize",  "fontStyle",
     "fontVariant", "fontWeight", "horzAlign",  "vertAlign",
   };
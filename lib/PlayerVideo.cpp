@@ -79,6 +79,103 @@ GINGA_PRAGMA_DIAG_IGNORE (-Wfloat-equal)
 
 namespace ginga {
 
+/// Stops and releases pipeline in reaper thread.
+static void
+player_video_reap (gpointer data)
+{
+  GstElement *playbin = GST_ELEMENT (data);
+  gstx_element_set_state_sync (playbin, GST_STATE_NULL);
+  gst_object_unref (playbin);
+}
+
+/// Clock and bus shared by the video pipelines when the "sharedClock"
+/// option is set (see player_video_shared_bus_get()).
+static GstClock *player_video_shared_clock;
+static GstBus *player_video_shared_bus;
+
+/// Players whose pipelines are attached to the shared bus, indexed by the
+/// serial number attached to their pipelines.  Serial numbers are never
+/// reused, so late messages from a reaped pipeline cannot reach the player
+/// of a new pipeline allocated at the same address.
+static map<guint, PlayerVideo *> player_video_shared_map;
+static guint player_video_shared_last_serial;
+G_LOCK_DEFINE_STATIC (player_video_shared);
+
+/// Gets the key of the pipeline's serial number.
+static GQuark
+player_video_serial_quark ()
+{
+  return g_quark_from_static_string ("ginga-player-video-serial");
+}
+
+/// Gets a new reference to the top-level element containing \p obj.
+static GstElement *
+player_video_get_pipeline (GstObject *obj)
+{
+  GstObject *parent;
+
+  gst_object_ref (obj);
+  while ((parent = gst_object_get_parent (obj)) != nullptr)
+    {
+      gst_object_unref (obj);
+      obj = parent;
+    }
+  return (GstElement *) obj;
+}
+
+/// Dispatches message posted on shared bus to the player that owns its
+/// source.  Messages from pipelines already handed to the reaper are
+/// dropped.  The dispatch runs with the map locked, so the player cannot
+/// be reaped under it.
+static gboolean
+player_video_shared_bus_cb (GstBus *bus, GstMessage *msg,
+                            unused (gpointer data))
+{
+  GstElement *pipeline;
+  guint serial;
+  map<guint, PlayerVideo *>::iterator it;
+
+  if (GST_MESSAGE_SRC (msg) == nullptr)
+    return TRUE;
+
+  pipeline = player_video_get_pipeline (GST_MESSAGE_SRC (msg));
+  serial = GPOINTER_TO_UINT (
+      g_object_get_qdata (G_OBJECT (pipeline), player_video_serial_quark ()));
+  gst_object_unref (pipeline);
+  if (serial == 0)
+    return TRUE;
+
+  G_LOCK (player_video_shared);
+  it = player_video_shared_map.find (serial);
+  if (it != player_video_shared_map.end ())
+    PlayerVideo::cb_Bus (bus, msg, it->second);
+  G_UNLOCK (player_video_shared);
+
+  return TRUE;
+}
+
+/// Gets the shared bus, creating it and the shared clock on first call.
+static GstBus *
+player_video_shared_bus_get ()
+{
+  static gsize init = 0;
+  if (g_once_init_enter (&init))
+    {
+      gulong ret;
+
+      player_video_shared_clock = gst_system_clock_obtain ();
+      g_assert_nonnull (player_video_shared_clock);
+      player_video_shared_bus = gst_bus_new ();
+      g_assert_nonnull (player_video_shared_bus);
+      ret = gst_bus_add_watch (player_video_shared_bus,
+                               (GstBusFunc) player_video_shared_bus_cb,
+                               nullptr);
+      g_assert (ret > 0);
+      g_once_init_leave (&init, 1);
+    }
+  return player_video_shared_bus;
+}
+
 // Public.
 
 PlayerVideo::PlayerVideo (Formatter *formatter, Media *media)
@@ -95,19 +192,8 @@ PlayerVideo::PlayerVideo (Formatter *formatter, Media *media)
 
   _TRACE ("");
 
-  // Initialize GStreamer.
-  if (!gst_is_initialized ())
-    {
-      GError *err = NULL;
-
-      if (unlikely (!gst_init_check (NULL, NULL, &err)))
-        {
-          g_assert_nonnull (err);
-          _ERROR ("%s", err->message);
-          g_error_free (err);
-        }
-      g_assert_null (err);
-    }
+  // GStreamer is initialized by the Formatter.
+  g_assert (gst_is_initialized ());
 
   // Create and initialize playbin.
   _playbin = gst_element_factory_make ("playbin", "playbin");
@@ -117,11 +203,34 @@ PlayerVideo::PlayerVideo (Formatter *formatter, Media *media)
     }
   g_assert_nonnull (_playbin);
 
-  bus = gst_pipeline_get_bus (GST_PIPELINE (_playbin));
-  g_assert_nonnull (bus);
-  ret = gst_bus_add_watch (bus, (GstBusFunc) cb_Bus, this);
-  g_assert (ret > 0);
-  gst_object_unref (bus);
+  // With the sharedClock option, all video pipelines run on the same
+  // clock and post to the same bus, which is watched once.
+  _serial = 0;
+  if (_formatter->getOptionBool ("sharedClock"))
+    {
+      bus = player_video_shared_bus_get ();
+      gst_pipeline_use_clock (GST_PIPELINE (_playbin),
+                              player_video_shared_clock);
+      // Otherwise the bus would be flushed whenever a pipeline stops.
+      gst_pipeline_set_auto_flush_bus (GST_PIPELINE (_playbin), FALSE);
+
+      G_LOCK (player_video_shared);
+      _serial = ++player_video_shared_last_serial;
+      player_video_shared_map[_serial] = this;
+      G_UNLOCK (player_video_shared);
+
+      g_object_set_qdata (G_OBJECT (_playbin), player_video_serial_quark (),
+                          GUINT_TO_POINTER (_serial));
+      gst_element_set_bus (_playbin, bus);
+    }
+  else
+    {
+      bus = gst_pipeline_get_bus (GST_PIPELINE (_playbin));
+      g_assert_nonnull (bus);
+      ret = gst_bus_add_watch (bus, (GstBusFunc) cb_Bus, this);
+      g_assert (ret > 0);
+      gst_object_unref (bus);
+    }
 
   // Setup video the processing bin.
   _video.bin = gst_bin_new ("video.bin");
@@ -158,8 +267,7 @@ PlayerVideo::PlayerVideo (Formatter *formatter, Media *media)
 PlayerVideo::~PlayerVideo ()
 {
   _TRACE ("");
-  gstx_element_set_state_sync (_playbin, GST_STATE_NULL);
-  gst_object_unref (_playbin);
+  this->reapPipeline ();
 }
 
 void
@@ -178,7 +286,7 @@ PlayerVideo::stop ()
   g_assert_nonnull (_playbin);
 
   _TRACE ("");
-  gstx_element_set_state (_playbin, GST_STATE_NULL);
+  this->reapPipeline ();
   Player::stop ();
 }
 
@@ -273,6 +381,9 @@ PlayerVideo::redraw (cairo_t *cr)
   // if (Player::getEOS ())
   //   goto done;
 
+  if (unlikely (_video.sink == nullptr))
+    goto done;
+
   sample = gst_app_sink_try_pull_sample (GST_APP_SINK (_video.sink), 0);
   if (sample == NULL)
     goto done;
@@ -307,6 +418,67 @@ done:
   Player::redraw (cr);
 }
 
+void
+PlayerVideo::getMetrics (Player::Metrics *metrics)
+{
+  GstStructure *stats;
+  guint64 dropped;
+  GstIterator *it;
+  GValue item = G_VALUE_INIT;
+
+  Player::getMetrics (metrics);
+  if (_playbin == nullptr)
+    return;
+
+  // Queues report how many bytes they are holding.
+  it = gst_bin_iterate_recurse (GST_BIN (_playbin));
+  while (gst_iterator_next (it, &item) == GST_ITERATOR_OK)
+    {
+      GObject *elt = G_OBJECT (g_value_get_object (&item));
+      if (g_object_class_find_property (G_OBJECT_GET_CLASS (elt),
+                                        "current-level-bytes"))
+        {
+          guint level = 0;
+          g_object_get (elt, "current-level-bytes", &level, nullptr);
+          metrics->pipelineBytes += level;
+        }
+      g_value_reset (&item);
+    }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  // Base sinks count the buffers they dropped for being late.
+  stats = nullptr;
+  g_object_get (_video.sink, "stats", &stats, nullptr);
+  if (stats == nullptr)
+    return;
+
+  dropped = 0;
+  if (gst_structure_get_uint64 (stats, "dropped", &dropped))
+    metrics->droppedFrames = dropped;
+  gst_structure_free (stats);
+}
+
+/**
+ * @brief Gets the number of video pipelines sharing clock and bus.
+ *
+ * Video pipelines share a single clock and bus watch only when the
+ * sharedClock option was set at the time their players were created.
+ *
+ * @return The number of pipelines attached to the shared bus.
+ */
+guint
+PlayerVideo::getSharedCount ()
+{
+  guint count;
+
+  G_LOCK (player_video_shared);
+  count = (guint) player_video_shared_map.size ();
+  G_UNLOCK (player_video_shared);
+
+  return count;
+}
+
 gint64
 PlayerVideo::getPipelineTime ()
 {
@@ -645,5 +817,36 @@ PlayerVideo::getPipelineState ()
   return gst_element_state_get_name (curr);
 }
 
+// Hands pipeline to the reaper thread, which brings it to the NULL state
+// and releases it.  The pipeline is detached from its bus watch first so
+// that no message reaches this player after it has been stopped.
+void
+PlayerVideo::reapPipeline ()
+{
+  GstBus *bus;
+
+  if (_playbin == nullptr)
+    return;
+
+  if (_serial > 0)
+    {
+      G_LOCK (player_video_shared);
+      player_video_shared_map.erase (_serial);
+      G_UNLOCK (player_video_shared);
+    }
+  else
+    {
+      bus = gst_pipeline_get_bus (GST_PIPELINE (_playbin));
+      g_assert_nonnull (bus);
+      gst_bus_remove_watch (bus);
+      gst_object_unref (bus);
+    }
+
+  Player::reap (player_video_reap, _playbin);
+  _playbin = nullptr;
+  _audio = {};
+  _video = {};
+}
+
 
 }
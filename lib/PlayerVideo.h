@@ -33,8 +33,12 @@ public:
   void pause () override;
   void resume () override;
   void redraw (cairo_t *) override;
+  void getMetrics (Player::Metrics *) override;
   // GStreamer callback.
   static gboolean cb_Bus (GstBus *, GstMessage *, PlayerVideo *);
+
+  // Static.
+  static guint getSharedCount ();
   
 protected:
   bool doSetProperty (Property, const string &, const string &) override;
@@ -48,6 +52,7 @@ protected:
 
 private:
   GstElement *_playbin; // pipeline
+  guint _serial;        // serial in the shared bus map, or zero
   struct
   {                        // audio pipeline
     GstElement *bin;       // audio bin
@@ -88,6 +93,7 @@ private:
   void doStackedActions ();
   bool getFreeze ();
   string getPipelineState ();
+  void reapPipeline (); // hand pipeline to reaper thread
 };
 
 }
@@ -64,6 +64,41 @@ Switch::toString ()
   return str;
 }
 
+void
+Switch::removeReferences (const set<Object *> &objs)
+{
+  Object::removeReferences (objs);
+
+  // Drop rules and switch port mappings that refer to removed objects.
+  for (auto it = _rules.begin (); it != _rules.end ();)
+    {
+      if (objs.find (it->first) != objs.end ())
+        {
+          delete it->second;
+          it = _rules.erase (it);
+        }
+      else
+        {
+          ++it;
+        }
+    }
+
+  for (auto &swport : _switchPorts)
+    {
+      auto &evts = swport.second;
+      for (auto it = evts.begin (); it != evts.end ();)
+        {
+          if (objs.find ((*it)->getObject ()) != objs.end ())
+            it = evts.erase (it);
+          else
+            ++it;
+        }
+    }
+
+  if (_selected != nullptr && objs.find (_selected) != objs.end ())
+    _selected = nullptr;
+}
+
 bool
 Switch::beforeTransition (Event *evt, Event::Transition transition)
 {
@@ -244,4 +279,16 @@ Switch::addSwitchPort (const string &id, const list<Event *> &evts)
   _switchPorts[id] = evts;
 }
 
+Object *
+Switch::getSelected ()
+{
+  return _selected;
+}
+
+void
+Switch::setSelected (Object *obj)
+{
+  _selected = obj;
+}
+
 }
@@ -32,6 +32,7 @@ public:
   // Object:
   string getObjectTypeAsString () override;
   string toString () override;
+  void removeReferences (const set<Object *> &) override;
   bool beforeTransition (Event *, Event::Transition) override;
   bool afterTransition (Event *, Event::Transition) override;
 
@@ -40,6 +41,8 @@ public:
   void addRule (Object *, Predicate *);
   const map<string, list<Event *> > *getSwitchPorts ();
   void addSwitchPort (const string &, const list<Event *> &);
+  Object *getSelected ();
+  void setSelected (Object *);
 
 private:
   map<string, list<Event *> > _switchPorts; ///< List of switchPorts.
@@ -21,6 +21,15 @@
 #define WS_DEFAULT_JSON_NOTIFY_EVTS                                        \
   "[\"selection\", \"onlookAt\", \"onlookAway\"]"
 
+// Serializes JSON value into a single-line string.
+static string
+ws_json_write (const Json::Value &value)
+{
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return Json::writeString (builder, value);
+}
+
 bool
 PlayerRemoteData::isValid ()
 {
@@ -39,10 +48,17 @@ WebServices::WebServices (Formatter *fmt)
   _client = nullptr;
   _server = nullptr;
   _state = WS_STATE_STOPPED;
+  _remoteSession = nullptr;
+  memset (&_remoteStats, 0, sizeof (_remoteStats));
 }
 
 WebServices::~WebServices ()
 {
+  if (_remoteSession != nullptr)
+    {
+      soup_session_abort (_remoteSession);
+      g_object_unref (_remoteSession);
+    }
   this->stop ();
   g_object_unref (_resource_group);
   g_object_unref (_client);
@@ -53,6 +69,12 @@ bool
 WebServices::stop ()
 {
   _state = WS_STATE_STOPPED;
+  // close event channel
+  while (!_eventSockets.empty ())
+    {
+      SoupWebsocketConnection *conn = _eventSockets.begin ()->first;
+      this->removeEventSocket (conn);
+    }
   // stop ssdp
   gssdp_resource_group_set_available (_resource_group, false);
   // stop http
@@ -136,23 +158,60 @@ cb_apps (SoupServer *server, SoupMessage *msg, const char *path,
   string errors;
   WebServices *ws = (WebServices *) user_data;
   bool status = false;
-  string action, interface, value;
-  Object *node;
-  Event *evt = nullptr;
-  Document *doc;
   const char *target = path + strlen (WS_ROUTE_APPS);
   gchar **params = g_strsplit (target, "/", 3);
 
-  doc = ws->getFormatter ()->getDocument ();
-  g_assert_nonnull (doc);
-  const char *appId = params[0]; // ignored
-  const char *docId = params[1]; // ignored
-  const char *nodeId = params[2];
-  if (!strlen (appId) || !strlen (docId) || !strlen (nodeId))
-    goto fail;
+  if (g_strv_length (params) < 3)
+    goto done;
+
+  {
+    const char *appId = params[0]; // ignored
+    const char *docId = params[1]; // ignored
+    const char *nodeId = params[2];
+    if (!strlen (appId) || !strlen (docId) || !strlen (nodeId))
+      goto done;
+
+    TRACE ("request %s: app=%s, docId=%s nodeId=%s", WS_ROUTE_APPS, appId,
+           docId, nodeId);
+    TRACE_SOUP_REQ_MSG (msg);
+
+    if (!reader->parse (msg->request_body->data,
+                        msg->request_body->data
+                            + msg->request_body->length,
+                        &root, &errors))
+      {
+        WARNING ("Error parsing request body");
+        goto done;
+      }
+
+    status = ws->applyAppAction (nodeId, root["action"].asString (),
+                                 root["interface"].asString (),
+                                 root["value"].asString ());
+  }
+
+done:
+  delete reader;
+  g_strfreev (params);
+  soup_message_set_status (msg,
+                           status ? SOUP_STATUS_OK : SOUP_STATUS_NOT_FOUND);
+}
+
+/* Applies the NCL editing commands in request body, a JSON object with
+   either a "command" string or a "commands" array of strings (see
+   Formatter::sendEditingCommand).  Stops at the first failing command and
+   replies its error message.  */
+static void
+cb_edit (SoupServer *server, SoupMessage *msg, const char *path,
+         GHashTable *query, SoupClientContext *client, gpointer user_data)
+{
+  Json::Value root;
+  Json::CharReaderBuilder builder;
+  Json::CharReader *reader = builder.newCharReader ();
+  string errors;
+  WebServices *ws = (WebServices *) user_data;
+  list<string> cmds;
+  string errmsg;
 
-  TRACE ("request %s: app=%s, docId=%s nodeId=%s", WS_ROUTE_APPS, appId,
-         docId, nodeId);
   TRACE_SOUP_REQ_MSG (msg);
 
   if (!reader->parse (msg->request_body->data,
@@ -160,56 +219,111 @@ cb_apps (SoupServer *server, SoupMessage *msg, const char *path,
                       &root, &errors))
     {
       WARNING ("Error parsing request body");
+      errmsg = "Bad request body: " + errors;
+      delete reader;
       goto fail;
     }
-  action = root["action"].asString ();
-  interface = root["interface"].asString ();
-  value = root["value"].asString ();
+  delete reader;
 
-  node = doc->getObjectById (nodeId);
-  g_strfreev (params);
-
-  if (!node)
-    goto fail;
-
-  if (action == "select")
+  if (!root.isObject ())
     {
-      evt = node->getSelectionEvent (value);
-      doc->evalAction (evt, Event::START);
-      doc->evalAction (evt, Event::STOP);
+      errmsg = "Request body must be a JSON object";
+      goto fail;
     }
-  else if (action == "lookAt")
+  if (root.isMember ("command"))
     {
-      if (!interface.empty ())
-        evt = node->getLookAtEvent (interface);
-      else
-        evt = node->getLookAtEvent ("@lambda");
-
-      if (evt != nullptr)
-        doc->evalAction (evt, Event::START);
-      else
-        goto fail;
+      if (!root["command"].isString ())
+        {
+          errmsg = "\"command\" must be a string";
+          goto fail;
+        }
+      cmds.push_back (root["command"].asString ());
     }
-  else if (action == "lookAway")
+  if (root.isMember ("commands"))
     {
-      if (!interface.empty ())
-        evt = node->getLookAtEvent (interface);
-      else
-        evt = node->getLookAtEvent ("@lambda");
-
-      if (evt != nullptr)
-        doc->evalAction (evt, Event::STOP);
-      else
-        goto fail;
+      if (!root["commands"].isArray ())
+        {
+          errmsg = "\"commands\" must be an array of strings";
+          goto fail;
+        }
+      for (const auto &item : root["commands"])
+        {
+          if (!item.isString ())
+            {
+              errmsg = "\"commands\" must be an array of strings";
+              goto fail;
+            }
+          cmds.push_back (item.asString ());
+        }
+    }
+  if (cmds.empty ())
+    {
+      errmsg = "No editing command";
+      goto fail;
     }
-  else
-    goto fail;
+
+  for (auto &cmd : cmds)
+    if (!ws->getFormatter ()->sendEditingCommand (cmd, &errmsg))
+      goto fail;
 
   soup_message_set_status (msg, SOUP_STATUS_OK);
   return;
 
 fail:
-  soup_message_set_status (msg, SOUP_STATUS_NOT_FOUND);
+  soup_message_set_status (msg, SOUP_STATUS_BAD_REQUEST);
+  soup_message_set_response (msg, "text/plain", SOUP_MEMORY_COPY,
+                             errmsg.c_str (), errmsg.length ());
+}
+
+static void
+cb_metrics (SoupServer *server, SoupMessage *msg, const char *path,
+            GHashTable *query, SoupClientContext *client,
+            gpointer user_data)
+{
+  WebServices *ws = (WebServices *) user_data;
+  string text;
+
+  text = ws->getMetrics ();
+  soup_message_set_status (msg, SOUP_STATUS_OK);
+  soup_message_set_response (msg, "text/plain; version=0.0.4",
+                             SOUP_MEMORY_COPY, text.c_str (),
+                             text.length ());
+}
+
+// Dispatches a text frame received on the event channel.
+static void
+cb_events_message (SoupWebsocketConnection *conn, gint type,
+                   GBytes *message, gpointer user_data)
+{
+  WebServices *ws = (WebServices *) user_data;
+  const char *data;
+  gsize size;
+
+  if (type != SOUP_WEBSOCKET_DATA_TEXT)
+    return;
+
+  data = (const char *) g_bytes_get_data (message, &size);
+  ws->handleEventMessage (conn, string (data, size));
+}
+
+// Forgets an event channel connection once it has been closed.
+static void
+cb_events_closed (SoupWebsocketConnection *conn, gpointer user_data)
+{
+  ((WebServices *) user_data)->removeEventSocket (conn);
+}
+
+// Accepts a new event channel connection.
+static void
+cb_events (SoupServer *server, SoupWebsocketConnection *conn,
+           const char *path, SoupClientContext *client, gpointer user_data)
+{
+  WebServices *ws = (WebServices *) user_data;
+
+  TRACE ("event channel connection at %s", path);
+  ws->addEventSocket (conn);
+  g_signal_connect (conn, "message", G_CALLBACK (cb_events_message), ws);
+  g_signal_connect (conn, "closed", G_CALLBACK (cb_events_closed), ws);
 }
 
 bool
@@ -268,6 +382,10 @@ WebServices::start ()
   WS_ADD_ROUTE (_server, WS_ROUTE_LOC, cb_locaction);
   WS_ADD_ROUTE (_server, WS_ROUTE_PLAYER, cb_remoteplayer);
   WS_ADD_ROUTE (_server, WS_ROUTE_APPS, cb_apps);
+  WS_ADD_ROUTE (_server, WS_ROUTE_EDIT, cb_edit);
+  WS_ADD_ROUTE (_server, WS_ROUTE_METRICS, cb_metrics);
+  soup_server_add_websocket_handler (_server, WS_ROUTE_EVENTS, nullptr,
+                                     nullptr, cb_events, this, nullptr);
   WS_ADD_ROUTE (_server, nullptr, cb_null);
 
   _state = WS_STATE_STARTED;
@@ -279,8 +397,21 @@ fail:
   return false;
 }
 
+/**
+ * @brief Binds a remote player to the remote medias it can present.
+ *
+ * If \p conn is given, the remote player registered through the event
+ * channel (see WebServices::handleEventMessage()): the media description
+ * and later player actions are pushed on \p conn instead of being posted
+ * to \p data.location.
+ *
+ * @param data Remote player description.
+ * @param conn Event channel connection of the remote player, or null.
+ * @return True if successful, or false otherwise.
+ */
 bool
-WebServices::machMediaThenSetPlayerRemote (PlayerRemoteData &data)
+WebServices::machMediaThenSetPlayerRemote (PlayerRemoteData &data,
+                                           SoupWebsocketConnection *conn)
 {
   if (!_formatter->getDocument ())
     return false;
@@ -300,7 +431,25 @@ WebServices::machMediaThenSetPlayerRemote (PlayerRemoteData &data)
         if (m->getProperty ("type") == mime)
           m->setProperty ("remotePlayerBaseURL", data.location);
 
-      if (m->getProperty ("remotePlayerBaseURL") != "")
+      if (m->getProperty ("remotePlayerBaseURL") == "")
+        continue;
+
+      if (conn != nullptr)
+        {
+          Json::Value frame;
+
+          _remoteSockets[data.location] = conn;
+          frame["appId"] = WS_DEFAULT_APPID;
+          frame["documentId"] = WS_DEFAULT_DOCID;
+          frame["sceneNode"] = m->getId ();
+          frame["sceneURL"] = m->getProperty ("uri");
+          frame["notifyEvents"].append ("selection");
+          frame["notifyEvents"].append ("onlookAt");
+          frame["notifyEvents"].append ("onlookAway");
+          soup_websocket_connection_send_text (
+              conn, ws_json_write (frame).c_str ());
+        }
+      else
         {
           SoupSession *session;
           SoupMessage *msg;
@@ -337,4 +486,702 @@ Formatter *
 WebServices::getFormatter ()
 {
   return _formatter;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Applies an action requested by a second-screen application.
+ * @param nodeId Id of the target object.
+ * @param action One of "select", "lookAt" or "lookAway".
+ * @param interface Target lookAt interface (empty means the whole object).
+ * @param value Key of the target selection event.
+ * @return True if successful, or false otherwise.
+ */
+bool
+WebServices::applyAppAction (const string &nodeId, const string &action,
+                             const string &interface, const string &value)
+{
+  Document *doc;
+  Object *node;
+  Event *evt;
+
+  doc = _formatter->getDocument ();
+  if (doc == nullptr)
+    return false;
+
+  node = doc->getObjectById (nodeId);
+  if (node == nullptr)
+    return false;
+
+  if (action == "select")
+    {
+      evt = node->getSelectionEvent (value);
+      if (evt == nullptr)
+        return false;
+      doc->evalAction (evt, Event::START);
+      doc->evalAction (evt, Event::STOP);
+      return true;
+    }
+
+  if (action == "lookAt" || action == "lookAway")
+    {
+      evt = node->getLookAtEvent (interface.empty () ? "@lambda"
+                                                     : interface);
+      if (evt == nullptr)
+        return false;
+      doc->evalAction (evt,
+                       (action == "lookAt") ? Event::START : Event::STOP);
+      return true;
+    }
+
+  return false;
+}
+
+/**
+ * @brief Adds a connection to the event channel.
+ *
+ * The connection receives no events until it subscribes to them (see
+ * WebServices::handleEventMessage()).
+ *
+ * @param conn The new connection.
+ */
+void
+WebServices::addEventSocket (SoupWebsocketConnection *conn)
+{
+  g_object_ref (conn);
+  _eventSockets[conn].clear ();
+}
+
+/**
+ * @brief Removes a connection from the event channel and closes it.
+ * @param conn The connection.
+ */
+void
+WebServices::removeEventSocket (SoupWebsocketConnection *conn)
+{
+  auto it = _eventSockets.find (conn);
+  if (it == _eventSockets.end ())
+    return;
+  _eventSockets.erase (it);
+
+  for (auto r = _remoteSockets.begin (); r != _remoteSockets.end ();)
+    {
+      if (r->second == conn)
+        r = _remoteSockets.erase (r);
+      else
+        ++r;
+    }
+
+  g_signal_handlers_disconnect_by_data (conn, this);
+  if (soup_websocket_connection_get_state (conn)
+      == SOUP_WEBSOCKET_STATE_OPEN)
+    soup_websocket_connection_close (conn, SOUP_WEBSOCKET_CLOSE_GOING_AWAY,
+                                     nullptr);
+  g_object_unref (conn);
+}
+
+// Gets the event type named \p name.
+static bool
+ws_event_type_from_string (const string &name, Event::Type *type)
+{
+  for (int i = Event::ATTRIBUTION; i <= Event::LOOKAT; i++)
+    {
+      if (Event::getEventTypeAsString ((Event::Type) i) == name)
+        {
+          tryset (type, (Event::Type) i);
+          return true;
+        }
+    }
+  return false;
+}
+
+// Gets the member \p key of \p root into \p value.  Absent members are
+// taken as the empty string; members of other types are rejected.
+static bool
+ws_json_get_string (const Json::Value &root, const char *key, string *value)
+{
+  if (!root.isMember (key))
+    {
+      tryset (value, "");
+      return true;
+    }
+  if (!root[key].isString ())
+    return false;
+  tryset (value, root[key].asString ());
+  return true;
+}
+
+// Appends the array of strings \p key of \p root to \p values.  Absent
+// members are taken as the empty array; members of other types are
+// rejected.
+static bool
+ws_json_get_strings (const Json::Value &root, const char *key,
+                     list<string> *values)
+{
+  if (!root.isMember (key))
+    return true;
+  if (!root[key].isArray ())
+    return false;
+  for (const auto &item : root[key])
+    if (!item.isString ())
+      return false;
+  for (const auto &item : root[key])
+    values->push_back (item.asString ());
+  return true;
+}
+
+/**
+ * @brief Handles a command received on the event channel.
+ *
+ * Commands are JSON objects whose "action" member is one of:
+ * - "subscribe": pushes the event types listed in "events" from now on
+ *   ("presentation", "attribution", "selection" or "lookAt"; all of them
+ *   if "events" is absent);
+ * - "unsubscribe": stops pushing events;
+ * - "register": registers a remote player, as in WS_ROUTE_PLAYER, whose
+ *   actions are then pushed on this connection (see
+ *   WebServices::flushRemotePlayerActions());
+ * - "edit": applies the editing commands in "command" or "commands", as in
+ *   WS_ROUTE_EDIT;
+ * - "select", "lookAt" or "lookAway": as in WS_ROUTE_APPS, with the target
+ *   object in "node".
+ *
+ * Every command is answered with a "reply" frame carrying its "status"
+ * ("ok" or "error"), the command "id" (if any), and an error "message".
+ *
+ * @param conn The connection that sent the command.
+ * @param text The command.
+ */
+void
+WebServices::handleEventMessage (SoupWebsocketConnection *conn,
+                                 const string &text)
+{
+  Json::Value root;
+  Json::Value reply;
+  Json::CharReaderBuilder builder;
+  Json::CharReader *reader;
+  string errors;
+  string action;
+  string errmsg;
+  bool status;
+
+  reader = builder.newCharReader ();
+  status = reader->parse (text.data (), text.data () + text.length (),
+                          &root, &errors);
+  delete reader;
+
+  if (!status || !root.isObject ())
+    {
+      status = false;
+      errmsg = "Bad command: " + errors;
+    }
+  else if (!ws_json_get_string (root, "action", &action))
+    {
+      status = false;
+      errmsg = "\"action\" must be a string";
+    }
+  else if (action == "subscribe")
+    {
+      set<Event::Type> types;
+      list<string> names;
+      Event::Type type;
+
+      if (!ws_json_get_strings (root, "events", &names))
+        {
+          errmsg = "\"events\" must be an array of strings";
+        }
+      else if (root.isMember ("events"))
+        {
+          for (const auto &name : names)
+            if (ws_event_type_from_string (name, &type))
+              types.insert (type);
+          if (types.empty ())
+            errmsg = "No known event type";
+        }
+      else
+        {
+          for (int i = Event::ATTRIBUTION; i <= Event::LOOKAT; i++)
+            types.insert ((Event::Type) i);
+        }
+
+      status = !types.empty ();
+      if (status)
+        _eventSockets[conn] = types;
+    }
+  else if (action == "unsubscribe")
+    {
+      _eventSockets[conn].clear ();
+      status = true;
+    }
+  else if (action == "register")
+    {
+      PlayerRemoteData pdata;
+
+      status = ws_json_get_string (root, "location", &pdata.location)
+               && ws_json_get_string (root, "deviceType", &pdata.deviceType)
+               && ws_json_get_strings (root, "supportedFormats",
+                                       &pdata.supportedFormats)
+               && ws_json_get_strings (root, "recognizableEvents",
+                                       &pdata.recognizedableEvents);
+      if (!status)
+        errmsg = "Bad remote player description";
+      else
+        status = pdata.isValid ()
+                 && this->machMediaThenSetPlayerRemote (pdata, conn);
+    }
+  else if (action == "edit")
+    {
+      list<string> cmds;
+      string first;
+
+      if (!ws_json_get_string (root, "command", &first))
+        {
+          status = false;
+          errmsg = "\"command\" must be a string";
+        }
+      else if (!ws_json_get_strings (root, "commands", &cmds))
+        {
+          status = false;
+          errmsg = "\"commands\" must be an array of strings";
+        }
+      else
+        {
+          if (!first.empty ())
+            cmds.push_front (first);
+          status = !cmds.empty ();
+          if (!status)
+            errmsg = "No editing command";
+          for (auto &cmd : cmds)
+            if (!(status = _formatter->sendEditingCommand (cmd, &errmsg)))
+              break;
+        }
+    }
+  else
+    {
+      string node, interface, value;
+
+      status = ws_json_get_string (root, "node", &node)
+               && ws_json_get_string (root, "interface", &interface)
+               && ws_json_get_string (root, "value", &value);
+      if (!status)
+        errmsg = "\"node\", \"interface\" and \"value\" must be strings";
+      else
+        status = this->applyAppAction (node, action, interface, value);
+    }
+
+  reply["reply"] = action;
+  reply["status"] = status ? "ok" : "error";
+  if (root.isObject () && root.isMember ("id"))
+    reply["id"] = root["id"];
+  if (!status)
+    reply["message"] = errmsg.empty () ? "Cannot apply " + action : errmsg;
+  soup_websocket_connection_send_text (conn, ws_json_write (reply).c_str ());
+}
+
+/**
+ * @brief Pushes an event transition to the event channel.
+ *
+ * Called by Document::evalAction() for each transition.  The event is sent
+ * to every open connection subscribed to its type, as a JSON object with
+ * the "event" type, "node" id, "interface" (event) id, "transition" name
+ * and, for attribution events, the attributed "value".
+ *
+ * @param evt The transitioned event.
+ * @param transition The transition.
+ */
+void
+WebServices::notifyEvent (Event *evt, Event::Transition transition)
+{
+  string text;
+
+  for (auto &it : _eventSockets)
+    {
+      if (it.second.find (evt->getType ()) == it.second.end ())
+        continue;
+
+      if (soup_websocket_connection_get_state (it.first)
+          != SOUP_WEBSOCKET_STATE_OPEN)
+        continue;
+
+      if (text.empty ())
+        {
+          Json::Value frame;
+          string value;
+
+          frame["event"] = Event::getEventTypeAsString (evt->getType ());
+          frame["node"] = evt->getObject ()->getId ();
+          frame["interface"] = evt->getId ();
+          frame["transition"]
+              = Event::getEventTransitionAsString (transition);
+          if (evt->getType () == Event::ATTRIBUTION
+              && evt->getParameter ("value", &value))
+            frame["value"] = value;
+          text = ws_json_write (frame);
+        }
+
+      soup_websocket_connection_send_text (it.first, text.c_str ());
+    }
+}
+
+// Tells whether remote player action \p next cancels the pending action
+// \p prev on the same node.
+static bool
+ws_remote_actions_cancel (const string &prev, const string &next)
+{
+  return (prev == "start" && next == "stop")
+         || (prev == "pause" && next == "resume")
+         || (prev == "resume" && next == "pause");
+}
+
+/**
+ * @brief Queues an action to a remote player.
+ *
+ * The action is held in the outbound queue of the device until the end of
+ * the current tick (see WebServices::flushRemotePlayerActions()).  If it
+ * cancels the last pending action on the same node, e.g., a stop after a
+ * start, both are dropped.
+ *
+ * @param location Location (base URL) of the remote player.
+ * @param node Id of the target node (media id or anchor label).
+ * @param body The action.
+ */
+void
+WebServices::queueRemotePlayerAction (const string &location,
+                                      const string &node,
+                                      const Json::Value &body)
+{
+  WebServicesRemoteDevice &dev = _remoteDevices[location];
+  string action = body["action"].asString ();
+
+  _remoteStats.queued++;
+  for (auto it = dev.pending.rbegin (); it != dev.pending.rend (); ++it)
+    {
+      if (it->node != node)
+        continue;
+      if (ws_remote_actions_cancel (it->body["action"].asString (),
+                                    action))
+        {
+          dev.pending.erase (std::next (it).base ());
+          _remoteStats.coalesced += 2;
+          return;
+        }
+      break;
+    }
+
+  WebServicesRemoteAction act;
+  act.node = node;
+  act.body = body;
+  dev.pending.push_back (act);
+}
+
+/**
+ * @brief Sends the actions queued to remote players in this tick.
+ *
+ * Called by Formatter::sendTick().  Remote players registered through the
+ * event channel get all their actions in a single frame with an "actions"
+ * array.  The others get them posted in order, one request at a time,
+ * over a shared keep-alive session.  Their backlog is bounded by
+ * WS_REMOTE_BACKLOG_MAX; on overflow, the oldest actions are dropped.
+ */
+void
+WebServices::flushRemotePlayerActions ()
+{
+  for (auto &it : _remoteDevices)
+    {
+      WebServicesRemoteDevice &dev = it.second;
+
+      if (dev.pending.empty ())
+        continue;
+
+      auto sock = _remoteSockets.find (it.first);
+      if (sock != _remoteSockets.end ()
+          && soup_websocket_connection_get_state (sock->second)
+                 == SOUP_WEBSOCKET_STATE_OPEN)
+        {
+          Json::Value frame;
+          for (auto &act : dev.pending)
+            {
+              Json::Value a = act.body;
+              a["node"] = act.node;
+              frame["actions"].append (a);
+            }
+          soup_websocket_connection_send_text (
+              sock->second, ws_json_write (frame).c_str ());
+          _remoteStats.sent += dev.pending.size ();
+          dev.pending.clear ();
+          continue;
+        }
+
+      dev.backlog.splice (dev.backlog.end (), dev.pending);
+      while (dev.backlog.size () > WS_REMOTE_BACKLOG_MAX)
+        {
+          dev.backlog.pop_front ();
+          _remoteStats.dropped++;
+        }
+      this->sendRemotePlayerActions (it.first);
+    }
+}
+
+// Request to a remote player in flight.
+typedef struct
+{
+  WebServices *ws;
+  string location;
+} WebServicesRemoteRequest;
+
+static void
+cb_remote_action (SoupSession *session, SoupMessage *msg, gpointer data)
+{
+  WebServicesRemoteRequest *req = (WebServicesRemoteRequest *) data;
+  req->ws->doneRemotePlayerAction (req->location, msg->status_code);
+  delete req;
+}
+
+/**
+ * @brief Posts the next action in the backlog of a remote player.
+ *
+ * Does nothing if a request to the same remote player is in flight; the
+ * next action is posted when it completes.
+ *
+ * @param location Location (base URL) of the remote player.
+ */
+void
+WebServices::sendRemotePlayerActions (const string &location)
+{
+  WebServicesRemoteDevice &dev = _remoteDevices[location];
+  WebServicesRemoteRequest *req;
+  SoupMessage *msg;
+  string url;
+  string data;
+
+  if (dev.inflight || dev.backlog.empty ())
+    return;
+
+  if (_remoteSession == nullptr)
+    _remoteSession = soup_session_new ();
+
+  WebServicesRemoteAction &act = dev.backlog.front ();
+  url = location + REMOTE_PLAYER_ROUTE_NODES + act.node;
+  data = ws_json_write (act.body);
+  dev.backlog.pop_front ();
+
+  msg = soup_message_new (SOUP_METHOD_POST, url.c_str ());
+  if (unlikely (msg == nullptr))
+    {
+      WARNING ("Bad remote player URL %s", url.c_str ());
+      _remoteStats.failed++;
+      this->sendRemotePlayerActions (location);
+      return;
+    }
+  soup_message_set_request (msg, "application/json", SOUP_MEMORY_COPY,
+                            data.c_str (), data.length ());
+
+  req = new WebServicesRemoteRequest;
+  req->ws = this;
+  req->location = location;
+  dev.inflight = true;
+  soup_session_queue_message (_remoteSession, msg, cb_remote_action, req);
+}
+
+/**
+ * @brief Finishes a request to a remote player and posts the next one.
+ * @param location Location (base URL) of the remote player.
+ * @param status HTTP status of the request.
+ */
+void
+WebServices::doneRemotePlayerAction (const string &location, guint status)
+{
+  WebServicesRemoteDevice &dev = _remoteDevices[location];
+
+  dev.inflight = false;
+  if (SOUP_STATUS_IS_SUCCESSFUL (status))
+    {
+      _remoteStats.sent++;
+    }
+  else
+    {
+      _remoteStats.failed++;
+      WARNING ("Failed to perform request to %s", location.c_str ());
+      if (status == SOUP_STATUS_CANCELLED)
+        return; // session is being aborted
+    }
+  this->sendRemotePlayerActions (location);
+}
+
+/**
+ * @brief Gets the counters of the remote player outbound queues.
+ * @param stats Variable to store the counters.
+ */
+void
+WebServices::getRemoteStats (WebServicesRemoteStats *stats)
+{
+  g_assert_nonnull (stats);
+  *stats = _remoteStats;
+}
+
+// Appends the HELP and TYPE lines of metric \p name to \p text.
+static void
+ws_metrics_header (string *text, const char *name, const char *type,
+                   const char *help)
+{
+  *text += xstrbuild ("# HELP %s %s\n# TYPE %s %s\n", name, help, name,
+                      type);
+}
+
+// Converts time to seconds.
+static double
+ws_metrics_seconds (Time time)
+{
+  return (double) time / GINGA_SECOND;
+}
+
+/**
+ * @brief Renders the current metrics in Prometheus text format.
+ *
+ * Counters are cumulative since the formatter was created (or, for the
+ * document ones, since the document was loaded); per-second rates are
+ * left to the scraper.  Player gauges cover the players that are alive.
+ *
+ * @return The metrics in Prometheus text exposition format 0.0.4.
+ */
+string
+WebServices::getMetrics ()
+{
+  FormatterMetrics fm;
+  WebServicesRemoteStats rs;
+  Document *doc;
+  map<string, guint64> players;
+  map<string, guint64> surfaceBytes;
+  map<string, guint64> textureBytes;
+  map<string, guint64> pipelineBytes;
+  guint64 total;
+  guint64 depth;
+  guint64 acc;
+  string text;
+
+  _formatter->getMetrics (&fm);
+  this->getRemoteStats (&rs);
+  doc = _formatter->getDocument ();
+
+  ws_metrics_header (&text, "ginga_redraw_seconds", "histogram",
+                     "Time spent redrawing a frame.");
+  acc = 0;
+  for (size_t i = 0; i < FORMATTER_REDRAW_BUCKETS; i++)
+    {
+      acc += fm.redrawBuckets[i];
+      text += xstrbuild ("ginga_redraw_seconds_bucket{le=\"%g\"} %"
+                         G_GUINT64_FORMAT "\n",
+                         ws_metrics_seconds (fm.redrawBounds[i]), acc);
+    }
+  text += xstrbuild ("ginga_redraw_seconds_bucket{le=\"+Inf\"} %"
+                     G_GUINT64_FORMAT "\n", fm.redrawCount);
+  text += xstrbuild ("ginga_redraw_seconds_sum %.17g\n",
+                     ws_metrics_seconds (fm.redrawSum));
+  text += xstrbuild ("ginga_redraw_seconds_count %" G_GUINT64_FORMAT "\n",
+                     fm.redrawCount);
+
+  ws_metrics_header (&text, "ginga_tick_seconds", "summary",
+                     "Time spent processing a tick.");
+  text += xstrbuild ("ginga_tick_seconds_sum %.17g\n",
+                     ws_metrics_seconds (fm.tickSum));
+  text += xstrbuild ("ginga_tick_seconds_count %" G_GUINT64_FORMAT "\n",
+                     fm.tickCount);
+
+  ws_metrics_header (&text, "ginga_actions_evaluated_total", "counter",
+                     "Actions evaluated by the document.");
+  text += xstrbuild ("ginga_actions_evaluated_total %" G_GUINT64_FORMAT
+                     "\n", doc ? doc->getActionCount () : 0);
+  ws_metrics_header (&text, "ginga_event_transitions_total", "counter",
+                     "Event transitions performed by the document.");
+  text += xstrbuild ("ginga_event_transitions_total %" G_GUINT64_FORMAT
+                     "\n", doc ? doc->getTransitionCount () : 0);
+  ws_metrics_header (&text, "ginga_links_scanned_total", "counter",
+                     "Links scanned while evaluating actions.");
+  text += xstrbuild ("ginga_links_scanned_total %" G_GUINT64_FORMAT "\n",
+                     doc ? doc->getLinkScanCount () : 0);
+
+  total = 0;
+  if (doc != nullptr)
+    {
+      for (auto media : *doc->getMedias ())
+        {
+          string kind;
+          Player::Metrics pm;
+
+          if (!media->getPlayerMetrics (&kind, &pm))
+            continue;
+          players[kind]++;
+          surfaceBytes[kind] += pm.surfaceBytes;
+          textureBytes[kind] += pm.textureBytes;
+          pipelineBytes[kind] += pm.pipelineBytes;
+          total += pm.surfaceBytes + pm.textureBytes + pm.pipelineBytes;
+        }
+    }
+
+  ws_metrics_header (&text, "ginga_players", "gauge",
+                     "Players alive, by kind.");
+  for (auto &it : players)
+    text += xstrbuild ("ginga_players{kind=\"%s\"} %" G_GUINT64_FORMAT
+                       "\n", it.first.c_str (), it.second);
+  ws_metrics_header (&text, "ginga_player_surface_bytes", "gauge",
+                     "Bytes held by decoded surfaces, by player kind.");
+  for (auto &it : surfaceBytes)
+    text += xstrbuild ("ginga_player_surface_bytes{kind=\"%s\"} %"
+                       G_GUINT64_FORMAT "\n", it.first.c_str (), it.second);
+  ws_metrics_header (&text, "ginga_player_texture_bytes", "gauge",
+                     "Bytes held by OpenGL textures, by player kind.");
+  for (auto &it : textureBytes)
+    text += xstrbuild ("ginga_player_texture_bytes{kind=\"%s\"} %"
+                       G_GUINT64_FORMAT "\n", it.first.c_str (), it.second);
+  ws_metrics_header (&text, "ginga_player_pipeline_bytes", "gauge",
+                     "Bytes queued in decoding pipelines, by player kind.");
+  for (auto &it : pipelineBytes)
+    text += xstrbuild ("ginga_player_pipeline_bytes{kind=\"%s\"} %"
+                       G_GUINT64_FORMAT "\n", it.first.c_str (), it.second);
+  ws_metrics_header (&text, "ginga_document_memory_bytes", "gauge",
+                     "Bytes held by all players of the document.");
+  text += xstrbuild ("ginga_document_memory_bytes %" G_GUINT64_FORMAT "\n",
+                     total);
+  ws_metrics_header (&text, "ginga_memory_budget_bytes", "gauge",
+                     "Memory budget for players, or zero if unlimited.");
+  text += xstrbuild ("ginga_memory_budget_bytes %" G_GUINT64_FORMAT "\n",
+                     (guint64) MAX (_formatter->getOptionInt ("memoryBudget"),
+                                    0) * 1024 * 1024);
+  ws_metrics_header (&text, "ginga_memory_evictions_total", "counter",
+                     "Players evicted to fit the memory budget.");
+  text += xstrbuild ("ginga_memory_evictions_total %" G_GUINT64_FORMAT "\n",
+                     fm.evictions);
+  ws_metrics_header (&text, "ginga_memory_evicted_bytes_total", "counter",
+                     "Bytes released by evictions.");
+  text += xstrbuild ("ginga_memory_evicted_bytes_total %" G_GUINT64_FORMAT
+                     "\n", fm.evictedBytes);
+  ws_metrics_header (&text, "ginga_video_dropped_frames_total", "counter",
+                     "Frames dropped by video players.");
+  text += xstrbuild ("ginga_video_dropped_frames_total %" G_GUINT64_FORMAT
+                     "\n", fm.droppedFrames);
+  ws_metrics_header (&text, "ginga_lua_cycle_seconds_total", "counter",
+                     "Time spent running NCLua players.");
+  text += xstrbuild ("ginga_lua_cycle_seconds_total %.17g\n",
+                     ws_metrics_seconds (fm.luaCycleSum));
+
+  depth = 0;
+  for (auto &it : _remoteDevices)
+    depth += it.second.pending.size () + it.second.backlog.size ();
+  ws_metrics_header (&text, "ginga_remote_queue_depth", "gauge",
+                     "Remote player actions waiting to be sent.");
+  text += xstrbuild ("ginga_remote_queue_depth %" G_GUINT64_FORMAT "\n",
+                     depth);
+  ws_metrics_header (&text, "ginga_remote_actions_total", "counter",
+                     "Remote player actions, by outcome.");
+  text += xstrbuild ("ginga_remote_actions_total{outcome=\"queued\"} %"
+                     G_GUINT64_FORMAT "\n", rs.queued);
+  text += xstrbuild ("ginga_remote_actions_total{outcome=\"coalesced\"} %"
+                     G_GUINT64_FORMAT "\n", rs.coalesced);
+  text += xstrbuild ("ginga_remote_actions_total{outcome=\"dropped\"} %"
+                     G_GUINT64_FORMAT "\n", rs.dropped);
+  text += xstrbuild ("ginga_remote_actions_total{outcome=\"sent\"} %"
+                     G_GUINT64_FORMAT "\n", rs.sent);
+  text += xstrbuild ("ginga_remote_actions_total{outcome=\"failed\"} %"
+                     G_GUINT64_FORMAT "\n", rs.failed);
+
+  return text;
+}
@@ -21,6 +21,7 @@ along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
 #include "aux-ginga.h"
 #include <libgssdp/gssdp.h>
 #include <libsoup/soup.h>
+#include <json/json.h>
 #include "Event.h"
 
 namespace ginga {
@@ -57,7 +58,11 @@ public:
 #define WS_ROUTE_LOC "/location"
 #define WS_ROUTE_PLAYER "/remote-mediaplayer"
 #define WS_ROUTE_APPS "/current-service/apps/"
+#define WS_ROUTE_EDIT "/current-service/editing-commands"
+#define WS_ROUTE_EVENTS "/current-service/events"
+#define WS_ROUTE_METRICS "/metrics"
 #define WS_PORT_DEFAULT 44642
+#define WS_REMOTE_BACKLOG_MAX 256
 #define WS_JSON_REMOTE_PLAYER                                              \
   "{\
      \"location\" : \"%s\", \
@@ -95,6 +100,37 @@ public:
   }                                                                        \
   G_STMT_END
 
+/**
+ * @brief Remote player action waiting to be sent.
+ */
+typedef struct
+{
+  string node;      ///< Target node (media id or anchor label).
+  Json::Value body; ///< Action.
+} WebServicesRemoteAction;
+
+/**
+ * @brief Outbound queue of a remote player device.
+ */
+typedef struct
+{
+  list<WebServicesRemoteAction> pending; ///< Actions of the current tick.
+  list<WebServicesRemoteAction> backlog; ///< Flushed, not yet sent.
+  bool inflight;                         ///< Whether a request is in flight.
+} WebServicesRemoteDevice;
+
+/**
+ * @brief Counters of the remote player outbound queues.
+ */
+typedef struct
+{
+  guint64 queued;    ///< Actions queued by remote players.
+  guint64 coalesced; ///< Actions cancelled by another in the same tick.
+  guint64 dropped;   ///< Actions dropped due to backlog overflow.
+  guint64 sent;      ///< Actions delivered.
+  guint64 failed;    ///< Actions whose request failed.
+} WebServicesRemoteStats;
+
 /**
  * @brief WebSercices.
  */
@@ -107,8 +143,29 @@ public:
   bool start ();
   bool stop ();
   WebServicesState getState ();
-  bool machMediaThenSetPlayerRemote (PlayerRemoteData &);
+  bool machMediaThenSetPlayerRemote (PlayerRemoteData &,
+                                     SoupWebsocketConnection *conn
+                                     = nullptr);
+  bool applyAppAction (const string &, const string &, const string &,
+                       const string &);
   Formatter *getFormatter ();
+
+  // Event channel (WebSocket).
+  void addEventSocket (SoupWebsocketConnection *);
+  void removeEventSocket (SoupWebsocketConnection *);
+  void handleEventMessage (SoupWebsocketConnection *, const string &);
+  void notifyEvent (Event *, Event::Transition);
+
+  // Remote player outbound queues.
+  void queueRemotePlayerAction (const string &, const string &,
+                                const Json::Value &);
+  void flushRemotePlayerActions ();
+  void sendRemotePlayerActions (const string &);
+  void doneRemotePlayerAction (const string &, guint);
+  void getRemoteStats (WebServicesRemoteStats *);
+
+  // Prometheus exposition.
+  string getMetrics ();
   const char *host_addr;
   guint host_port;
 
@@ -116,6 +173,11 @@ private:
   Formatter *_formatter;
   WebServicesState _state;
   map<Media *, PlayerRemoteData> _playerMap;
+  map<SoupWebsocketConnection *, set<Event::Type> > _eventSockets;
+  map<string, SoupWebsocketConnection *> _remoteSockets;
+  map<string, WebServicesRemoteDevice> _remoteDevices;
+  WebServicesRemoteStats _remoteStats;
+  SoupSession *_remoteSession;
   GSSDPClient *_client;
   GSSDPResourceGroup *_resource_group;
   SoupServer *_server;
@@ -62,10 +62,46 @@ struct GingaOptions
   /// @remark Can only when Ginga object is created.
   bool opengl;
 
+  /// @brief Whether to precompile the document's NCLua scripts on start.
+  bool prewarm;
+
+  /// @brief Memory budget for player backing stores (in megabytes), or
+  /// zero for no budget.
+  int memoryBudget;
+
+  /// @brief Whether video players share a single pipeline clock and bus
+  /// watch.
+  bool sharedClock;
+
   /// @brief Background color.
   std::string background;
 };
 
+/**
+ * @brief Ginga statistics.
+ *
+ * Key-to-photon latency is the time from a key press arriving at
+ * Ginga::sendKey() until the first Ginga::redraw() that presents its
+ * effects completes.  Percentiles cover the latest samples only.
+ */
+struct GingaStats
+{
+  /// @brief Number of key presses whose effects were presented.
+  uint64_t inputSamples;
+
+  /// @brief Median key-to-photon latency (in nanoseconds).
+  uint64_t inputLatencyP50;
+
+  /// @brief 90th percentile key-to-photon latency (in nanoseconds).
+  uint64_t inputLatencyP90;
+
+  /// @brief 99th percentile key-to-photon latency (in nanoseconds).
+  uint64_t inputLatencyP99;
+
+  /// @brief Maximum key-to-photon latency (in nanoseconds).
+  uint64_t inputLatencyMax;
+};
+
 /**
  * @brief Ginga states.
  */
@@ -95,6 +131,12 @@ public:
 
   virtual bool sendKey (const std::string &key, bool press) = 0;
   virtual bool sendTick (uint64_t total, uint64_t diff, uint64_t frame) = 0;
+  virtual bool sendEditingCommand (const std::string &cmd,
+                                   std::string *errmsg) = 0;
+  virtual void getStats (GingaStats *stats) = 0;
+  virtual bool saveState (std::string *state, std::string *errmsg) = 0;
+  virtual bool restoreState (const std::string &state,
+                             std::string *errmsg) = 0;
 
   virtual const GingaOptions *getOptions () = 0;
   virtual bool getOptionBool (const std::string &name) = 0;
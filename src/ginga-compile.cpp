@@ -0,0 +1,161 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "aux-glib.h"
+
+// clang-format off
+PRAGMA_DIAG_IGNORE (-Wunused-macros)
+// clang-format on
+
+#include "aux-ginga.h"
+#include "Parser.h"
+#include "ParserBinary.h"
+using namespace ::std;
+using namespace ::ginga;
+
+// Options.
+#define OPTION_LINE "FILE OUTPUT"
+#define OPTION_DESC                                                        \
+  "Compiles NCL document FILE into OUTPUT, which can be given to ginga\n"  \
+  "instead of FILE.  OUTPUT must have the .nclb extension.  Regions are\n" \
+  "resolved for the screen size OUTPUT is loaded at.  Local media are\n"   \
+  "stored relative to FILE and looked up relative to OUTPUT.\n\n"          \
+  "Report bugs to: " PACKAGE_BUGREPORT "\n"                                \
+  "Ginga home page: " PACKAGE_URL
+
+static gint opt_width = 800;  // screen width
+static gint opt_height = 600; // screen height
+
+static gboolean
+opt_size_cb (unused (const gchar *opt), const gchar *arg,
+             unused (gpointer data), GError **err)
+{
+  gint64 width;
+  gint64 height;
+  gchar *end;
+
+  width = g_ascii_strtoll (arg, &end, 10);
+  if (width == 0)
+    goto syntax_error;
+  opt_width = (gint) (CLAMP (width, 0, G_MAXINT));
+
+  if (*end != 'x')
+    goto syntax_error;
+
+  height = g_ascii_strtoll (++end, NULL, 10);
+  if (height == 0)
+    goto syntax_error;
+  opt_height = (gint) (CLAMP (height, 0, G_MAXINT));
+
+  return TRUE;
+
+syntax_error:
+  g_set_error (err, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+               "Invalid size string '%s'", arg);
+  return FALSE;
+}
+
+static void
+opt_version_cb (void)
+{
+  puts (PACKAGE_STRING);
+  _exit (0);
+}
+
+static GOptionEntry options[]
+    = { { "size", 's', 0, G_OPTION_ARG_CALLBACK, pointerof (opt_size_cb),
+          "Set screen size", "WIDTHxHEIGHT" },
+        { "version", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+          pointerof (opt_version_cb), "Print version information and exit",
+          NULL },
+        { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL } };
+
+// Error handling.
+
+#define usage_error(fmt, ...) _error (TRUE, 0, fmt, ##__VA_ARGS__)
+
+#define die(fmt, ...) _error (FALSE, 1, fmt, ##__VA_ARGS__)
+
+static G_GNUC_PRINTF (3, 4) void _error (gboolean try_help, int die,
+                                         const gchar *format, ...)
+{
+  const gchar *me = g_get_application_name ();
+  va_list args;
+
+  va_start (args, format);
+  g_fprintf (stderr, "%s: ", me);
+  g_vfprintf (stderr, format, args);
+  g_fprintf (stderr, "\n");
+  va_end (args);
+
+  if (try_help)
+    g_fprintf (stderr, "Try '%s --help' for more information.\n", me);
+  if (die > 0)
+    _exit (die);
+}
+
+// Main.
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  gboolean status;
+  GError *error = NULL;
+  Document *doc;
+  string errmsg;
+
+  // Parse command-line options.
+  ctx = g_option_context_new (OPTION_LINE);
+  g_assert_nonnull (ctx);
+  g_option_context_set_description (ctx, OPTION_DESC);
+  g_option_context_add_main_entries (ctx, options, NULL);
+  status = g_option_context_parse (ctx, &argc, &argv, &error);
+  g_option_context_free (ctx);
+
+  if (!status)
+    {
+      g_assert_nonnull (error);
+      usage_error ("%s", error->message);
+      g_error_free (error);
+      _exit (1);
+    }
+
+  if (argc != 3)
+    {
+      usage_error ("Missing file operand");
+      _exit (1);
+    }
+
+  if (!xstrhassuffix (argv[2], ".nclb"))
+    die ("%s: Output file must have the .nclb extension", argv[2]);
+
+  doc = Parser::parseFile (argv[1], opt_width, opt_height, &errmsg);
+  if (doc == nullptr)
+    die ("%s", errmsg.c_str ());
+
+  if (!ParserBinary::writeFile (doc, opt_width, opt_height, argv[2],
+                                &errmsg))
+    die ("%s: %s", argv[2], errmsg.c_str ());
+
+  delete doc;
+  exit (EXIT_SUCCESS);
+}
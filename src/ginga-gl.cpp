@@ -239,6 +239,9 @@ main (int argc, char **argv)
   opts.opengl = true;
   opts.background = string (opt_background);
   opts.opengl = true;
+  opts.prewarm = false;
+  opts.memoryBudget = 0;
+  opts.sharedClock = false;
   GINGA = Ginga::create (&opts);
   g_assert_nonnull (GINGA);
 
@@ -29,6 +29,9 @@ public:
     _ginga_opts.experimental = FALSE;
     _ginga_opts.background = "black";
     _ginga_opts.opengl = false;
+    _ginga_opts.prewarm = false;
+    _ginga_opts.memoryBudget = 0;
+    _ginga_opts.sharedClock = false;
 
     _ginga = Ginga::create (&_ginga_opts);
 
@@ -0,0 +1,390 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "aux-glib.h"
+#include <cairo.h>
+
+// clang-format off
+PRAGMA_DIAG_IGNORE (-Wunused-macros)
+// clang-format on
+
+#include "ginga.h"
+#include "aux-ginga.h"
+using namespace ::std;
+
+// Options.
+#define OPTION_LINE "FILE..."
+#define OPTION_DESC                                                        \
+  "Plays each NCL document FILE in its own formatter, off-screen, on a\n"  \
+  "pool of worker threads.  Each presentation has its own clock, which\n"  \
+  "is virtual (as fast as possible) unless --realtime is given.\n\n"       \
+  "Report bugs to: " PACKAGE_BUGREPORT "\n"                                \
+  "Ginga home page: " PACKAGE_URL
+
+static gint opt_width = 800;         // screen width
+static gint opt_height = 600;        // screen height
+static gint opt_fps = 30;            // frames per second
+static gdouble opt_duration = 10.;   // presentation duration (seconds)
+static gint opt_threads = 0;         // number of worker threads
+static gboolean opt_realtime = FALSE; // whether to use real-time clock
+static gchar *opt_output = nullptr;  // directory for per-document frames
+static gchar *opt_mosaic = nullptr;  // file for the mosaic of all frames
+static gint opt_snapshot = 0;        // frames between snapshots
+
+static gboolean
+opt_size_cb (unused (const gchar *opt), const gchar *arg,
+             unused (gpointer data), GError **err)
+{
+  gint64 width;
+  gint64 height;
+  gchar *end;
+
+  width = g_ascii_strtoll (arg, &end, 10);
+  if (width == 0)
+    goto syntax_error;
+  opt_width = (gint) (CLAMP (width, 0, G_MAXINT));
+
+  if (*end != 'x')
+    goto syntax_error;
+
+  height = g_ascii_strtoll (++end, NULL, 10);
+  if (height == 0)
+    goto syntax_error;
+  opt_height = (gint) (CLAMP (height, 0, G_MAXINT));
+
+  return TRUE;
+
+syntax_error:
+  g_set_error (err, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+               "Invalid size string '%s'", arg);
+  return FALSE;
+}
+
+static void
+opt_version_cb (void)
+{
+  puts (PACKAGE_STRING);
+  _exit (0);
+}
+
+static GOptionEntry options[]
+    = { { "size", 's', 0, G_OPTION_ARG_CALLBACK, pointerof (opt_size_cb),
+          "Set screen size of each document", "WIDTHxHEIGHT" },
+        { "fps", 'f', 0, G_OPTION_ARG_INT, &opt_fps,
+          "Set frame rate (default: 30)", "N" },
+        { "duration", 'd', 0, G_OPTION_ARG_DOUBLE, &opt_duration,
+          "Stop after SECONDS (0: when all documents end; default: 10)",
+          "SECONDS" },
+        { "threads", 'j', 0, G_OPTION_ARG_INT, &opt_threads,
+          "Set number of worker threads (default: number of processors)",
+          "N" },
+        { "realtime", 'r', 0, G_OPTION_ARG_NONE, &opt_realtime,
+          "Pace presentations by the real-time clock", NULL },
+        { "output", 'o', 0, G_OPTION_ARG_FILENAME, &opt_output,
+          "Write the frames of document i to DIR/i.png", "DIR" },
+        { "mosaic", 'm', 0, G_OPTION_ARG_FILENAME, &opt_mosaic,
+          "Write the frames of all documents tiled into FILE (PNG)",
+          "FILE" },
+        { "snapshot", 'n', 0, G_OPTION_ARG_INT, &opt_snapshot,
+          "Write frames every N frames (default: only at the end)", "N" },
+        { "version", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+          pointerof (opt_version_cb), "Print version information and exit",
+          NULL },
+        { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL } };
+
+// Error handling.
+
+#define usage_error(fmt, ...) _error (TRUE, 0, fmt, ##__VA_ARGS__)
+
+#define die(fmt, ...) _error (FALSE, 1, fmt, ##__VA_ARGS__)
+
+static G_GNUC_PRINTF (3, 4) void _error (gboolean try_help, int die,
+                                         const gchar *format, ...)
+{
+  const gchar *me = g_get_application_name ();
+  va_list args;
+
+  va_start (args, format);
+  g_fprintf (stderr, "%s: ", me);
+  g_vfprintf (stderr, format, args);
+  g_fprintf (stderr, "\n");
+  va_end (args);
+
+  if (try_help)
+    g_fprintf (stderr, "Try '%s --help' for more information.\n", me);
+  if (die > 0)
+    _exit (die);
+}
+
+// Presentations.
+
+typedef struct Presentation
+{
+  string path;              // document path
+  Ginga *ginga;             // formatter
+  cairo_surface_t *surface; // off-screen frame
+  guint64 total;            // presentation clock
+  guint64 frame;            // frame number
+  gint64 epoch;             // real time when presentation started
+  gboolean done;            // whether presentation has ended
+} Presentation;
+
+static GMutex pending_mutex; // protects pending
+static GCond pending_cond;   // signalled when pending reaches zero
+static guint pending;        // number of frames being rendered
+
+// Advances presentation by one frame and renders it.  Runs in a worker
+// thread; each presentation is touched by one thread at a time.
+static void
+presentation_step (gpointer data, unused (gpointer user_data))
+{
+  Presentation *pres = (Presentation *) data;
+  guint64 diff;
+  cairo_t *cr;
+
+  if (opt_realtime)
+    {
+      guint64 now
+          = (guint64) (g_get_monotonic_time () - pres->epoch) * GINGA_USECOND;
+      diff = (now > pres->total) ? now - pres->total : 0;
+    }
+  else
+    {
+      diff = GINGA_SECOND / (guint64) opt_fps;
+    }
+
+  pres->total += diff;
+  if (!pres->ginga->sendTick (pres->total, diff, pres->frame++))
+    pres->done = TRUE;
+
+  cr = cairo_create (pres->surface);
+  g_assert_nonnull (cr);
+  pres->ginga->redraw (cr);
+  cairo_destroy (cr);
+
+  if (pres->ginga->getState () == GINGA_STATE_STOPPED)
+    pres->done = TRUE;
+
+  g_mutex_lock (&pending_mutex);
+  if (--pending == 0)
+    g_cond_signal (&pending_cond);
+  g_mutex_unlock (&pending_mutex);
+}
+
+// Writes the latest frame of each presentation.
+static void
+presentations_write (Presentation *pres, guint n)
+{
+  if (opt_output != nullptr)
+    {
+      for (guint i = 0; i < n; i++)
+        {
+          gchar *path;
+          path = g_strdup_printf ("%s/%u.png", opt_output, i);
+          if (cairo_surface_write_to_png (pres[i].surface, path)
+              != CAIRO_STATUS_SUCCESS)
+            {
+              die ("%s: Cannot write frame", path);
+            }
+          g_free (path);
+        }
+    }
+
+  if (opt_mosaic != nullptr)
+    {
+      cairo_surface_t *mosaic;
+      cairo_t *cr;
+      guint cols, rows;
+
+      cols = (guint) ceil (sqrt ((double) n));
+      rows = (n + cols - 1) / cols;
+      mosaic = cairo_image_surface_create (
+          CAIRO_FORMAT_ARGB32, (int) cols * opt_width,
+          (int) rows * opt_height);
+      g_assert_nonnull (mosaic);
+
+      cr = cairo_create (mosaic);
+      g_assert_nonnull (cr);
+      for (guint i = 0; i < n; i++)
+        {
+          cairo_set_source_surface (cr, pres[i].surface,
+                                    (double) ((i % cols) * opt_width),
+                                    (double) ((i / cols) * opt_height));
+          cairo_paint (cr);
+        }
+      cairo_destroy (cr);
+
+      if (cairo_surface_write_to_png (mosaic, opt_mosaic)
+          != CAIRO_STATUS_SUCCESS)
+        {
+          die ("%s: Cannot write mosaic", opt_mosaic);
+        }
+      cairo_surface_destroy (mosaic);
+    }
+}
+
+// Main.
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  gboolean status;
+  GError *error = NULL;
+  GingaOptions opts;
+  GThreadPool *pool;
+  Presentation *pres;
+  guint n;
+  guint64 frame;
+  guint64 frames;
+  gint64 epoch;
+
+  // Parse command-line options.
+  ctx = g_option_context_new (OPTION_LINE);
+  g_assert_nonnull (ctx);
+  g_option_context_set_description (ctx, OPTION_DESC);
+  g_option_context_add_main_entries (ctx, options, NULL);
+  status = g_option_context_parse (ctx, &argc, &argv, &error);
+  g_option_context_free (ctx);
+
+  if (!status)
+    {
+      g_assert_nonnull (error);
+      usage_error ("%s", error->message);
+      g_error_free (error);
+      _exit (1);
+    }
+
+  if (argc < 2)
+    {
+      usage_error ("Missing file operand");
+      _exit (1);
+    }
+
+  if (opt_fps <= 0)
+    die ("Invalid frame rate '%d'", opt_fps);
+  if (opt_threads <= 0)
+    opt_threads = (gint) g_get_num_processors ();
+  if (opt_output != nullptr && g_mkdir_with_parents (opt_output, 0755) != 0)
+    die ("%s: Cannot create directory", opt_output);
+
+  // Start presentations.
+  opts.width = opt_width;
+  opts.height = opt_height;
+  opts.debug = false;
+  opts.webservices = false;
+  opts.experimental = false;
+  opts.opengl = false;
+  opts.prewarm = false;
+  opts.memoryBudget = 0;
+  opts.sharedClock = false;
+  opts.background = "";
+
+  n = (guint) (argc - 1);
+  pres = new Presentation[n];
+  g_assert_nonnull (pres);
+  epoch = g_get_monotonic_time ();
+  for (guint i = 0; i < n; i++)
+    {
+      string errmsg;
+
+      pres[i].path = string (argv[i + 1]);
+      pres[i].ginga = Ginga::create (&opts);
+      g_assert_nonnull (pres[i].ginga);
+      pres[i].surface = cairo_image_surface_create (
+          CAIRO_FORMAT_ARGB32, opt_width, opt_height);
+      g_assert_nonnull (pres[i].surface);
+      pres[i].total = 0;
+      pres[i].frame = 0;
+      pres[i].epoch = epoch;
+      pres[i].done = FALSE;
+
+      if (!pres[i].ginga->start (pres[i].path, &errmsg))
+        die ("%s", errmsg.c_str ());
+    }
+
+  // Drive presentations frame by frame.  Frames of different
+  // presentations are rendered concurrently; the main thread waits for
+  // all of them before dispatching pending GLib events, since player
+  // callbacks run on the main context.
+  pool = g_thread_pool_new (presentation_step, nullptr, opt_threads, FALSE,
+                            &error);
+  if (pool == nullptr)
+    die ("%s", error->message);
+
+  frames = (opt_duration > 0)
+               ? (guint64) ceil (opt_duration * opt_fps)
+               : G_MAXUINT64;
+  for (frame = 0; frame < frames; frame++)
+    {
+      guint active = 0;
+
+      for (guint i = 0; i < n; i++)
+        if (!pres[i].done)
+          active++;
+      if (active == 0)
+        break;
+
+      g_mutex_lock (&pending_mutex);
+      pending = active;
+      g_mutex_unlock (&pending_mutex);
+
+      for (guint i = 0; i < n; i++)
+        if (!pres[i].done)
+          g_thread_pool_push (pool, &pres[i], nullptr);
+
+      g_mutex_lock (&pending_mutex);
+      while (pending > 0)
+        g_cond_wait (&pending_cond, &pending_mutex);
+      g_mutex_unlock (&pending_mutex);
+
+      while (g_main_context_pending (nullptr))
+        g_main_context_iteration (nullptr, FALSE);
+
+      if (opt_snapshot > 0 && (frame + 1) % (guint64) opt_snapshot == 0)
+        presentations_write (pres, n);
+
+      if (opt_realtime)
+        {
+          gint64 next = epoch
+                        + (gint64) ((frame + 1) * G_USEC_PER_SEC
+                                    / (guint64) opt_fps);
+          gint64 now = g_get_monotonic_time ();
+          if (next > now)
+            g_usleep ((gulong) (next - now));
+        }
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  presentations_write (pres, n);
+
+  for (guint i = 0; i < n; i++)
+    {
+      g_print ("%s: %" G_GUINT64_FORMAT " frames%s\n",
+               pres[i].path.c_str (), pres[i].frame,
+               pres[i].done ? " (ended)" : "");
+      delete pres[i].ginga;
+      cairo_surface_destroy (pres[i].surface);
+    }
+  delete[] pres;
+
+  exit (EXIT_SUCCESS);
+}
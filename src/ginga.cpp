@@ -45,7 +45,11 @@ static gboolean opt_experimental = FALSE; // toggle experimental stuff
 static gboolean opt_fullscreen = FALSE;   // toggle fullscreen-mode
 static gboolean opt_webservices = FALSE;  // toggle webservices-only-mode
 static gboolean opt_opengl = FALSE;       // toggle OpenGL backend
+static gboolean opt_prewarm = FALSE;      // toggle NCLua precompilation
+static gint opt_memory_budget = 0;       // player memory budget in MB
+static gboolean opt_shared_clock = FALSE; // toggle shared video clock
 static string opt_background = "";        // background color
+static gchar *opt_commands = NULL;        // NCL editing commands file
 static gint opt_width = 800;              // initial window width
 static gint opt_height = 600;             // initial window height
 
@@ -97,6 +101,8 @@ opt_version_cb (void)
 static GOptionEntry options[]
     = { { "background", 'b', 0, G_OPTION_ARG_CALLBACK,
           pointerof (opt_background_cb), "Set background color", "COLOR" },
+        { "commands", 'c', 0, G_OPTION_ARG_FILENAME, &opt_commands,
+          "Apply NCL editing commands appended to FILE", "FILE" },
         { "debug", 'd', 0, G_OPTION_ARG_NONE, &opt_debug,
           "Enable debugging", NULL },
         { "fullscreen", 'f', 0, G_OPTION_ARG_NONE, &opt_fullscreen,
@@ -105,6 +111,12 @@ static GOptionEntry options[]
           "Enable WebService and turn file param optional.", NULL },
         { "opengl", 'g', 0, G_OPTION_ARG_NONE, &opt_opengl,
           "Use OpenGL backend", NULL },
+        { "prewarm", 'p', 0, G_OPTION_ARG_NONE, &opt_prewarm,
+          "Precompile NCLua scripts on start", NULL },
+        { "memory-budget", 'm', 0, G_OPTION_ARG_INT, &opt_memory_budget,
+          "Limit player surfaces and textures to SIZE megabytes", "SIZE" },
+        { "shared-clock", 'k', 0, G_OPTION_ARG_NONE, &opt_shared_clock,
+          "Run video players on one shared clock and bus", NULL },
         { "size", 's', 0, G_OPTION_ARG_CALLBACK, pointerof (opt_size_cb),
           "Set initial window size", "WIDTHxHEIGHT" },
         { "experimental", 'x', 0, G_OPTION_ARG_NONE, &opt_experimental,
@@ -269,6 +281,49 @@ keyboard_callback (GtkWidget *widget, GdkEventKey *e, gpointer type)
   return status;
 }
 
+// Editing commands.
+
+static goffset commands_offset = 0; // offset of next command in file
+
+// Applies the complete lines appended to the commands file since the last
+// call, one editing command per line.  Blank lines and lines starting
+// with '#' are ignored.
+static void
+commands_poll (void)
+{
+  GStatBuf st;
+  gchar *contents;
+  gsize len;
+
+  if (opt_commands == NULL || g_stat (opt_commands, &st) != 0)
+    return;
+  if (st.st_size < commands_offset) // truncated
+    commands_offset = 0;
+  if (st.st_size == commands_offset)
+    return;
+  if (!g_file_get_contents (opt_commands, &contents, &len, NULL))
+    return;
+
+  while ((gsize) commands_offset < len)
+    {
+      gchar *start = contents + commands_offset;
+      gchar *end = (gchar *) memchr (start, '\n', len - commands_offset);
+      string line;
+      string errmsg;
+
+      if (end == NULL)
+        break; // incomplete line
+      line = xstrstrip (string (start, (size_t) (end - start)));
+      commands_offset = (end - contents) + 1;
+
+      if (line == "" || line[0] == '#')
+        continue;
+      if (!GINGA->sendEditingCommand (line, &errmsg))
+        error ("%s: %s", opt_commands, errmsg.c_str ());
+    }
+  g_free (contents);
+}
+
 #if GTK_CHECK_VERSION(3, 8, 0)
 static gboolean
 tick_callback (GtkWidget *widget, GdkFrameClock *frame_clock,
@@ -304,6 +359,8 @@ tick_callback (GtkWidget *widget)
       return G_SOURCE_REMOVE;
     }
 
+  commands_poll ();
+
   last = time;
   gtk_widget_queue_draw (widget);
   return G_SOURCE_CONTINUE;
@@ -409,6 +466,9 @@ main (int argc, char **argv)
   opts.webservices = opt_webservices;
   opts.experimental = opt_experimental;
   opts.opengl = opt_opengl;
+  opts.prewarm = opt_prewarm;
+  opts.memoryBudget = opt_memory_budget;
+  opts.sharedClock = opt_shared_clock;
   opts.background = string (opt_background);
   GINGA = Ginga::create (&opts);
   g_assert_nonnull (GINGA);
@@ -432,6 +492,7 @@ main (int argc, char **argv)
           fail_count++;
           continue;
         }
+      commands_offset = 0;
       gtk_widget_show_all (app);
       gtk_main ();
       GINGA->stop ();
@@ -186,6 +186,9 @@ main (int argc, char **argv)
   opts.opengl = false;
   opts.experimental = true;
   opts.webservices = false;
+  opts.prewarm = false;
+  opts.memoryBudget = 0;
+  opts.sharedClock = false;
 
   GINGA = Ginga::create (&opts);
   g_assert_nonnull (GINGA);
@@ -0,0 +1,58 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+#include "AudioMixer.h"
+
+static GstElement *
+input (void)
+{
+  GstElement *bin;
+
+  bin = gst_parse_bin_from_description ("audiotestsrc is-live=true",
+                                        TRUE, nullptr);
+  g_assert_nonnull (bin);
+  return bin;
+}
+
+int
+main (void)
+{
+  GstPad *pad;
+  string errmsg;
+
+  gst_init (nullptr, nullptr);
+
+  // A bad sink keeps the mixer from starting.
+  g_assert (AudioMixer::setSink ("nosuchsink", &errmsg));
+  g_assert_null (AudioMixer::attach (input ()));
+  g_assert_null (AudioMixer::attach (input ()));
+  g_assert_cmpuint (AudioMixer::getInputCount (), ==, 0);
+  g_assert_cmpuint (AudioMixer::getRunningTime (), ==, 0);
+
+  // But audio is not disabled for good: fixing the sink starts it.
+  g_assert (AudioMixer::setSink ("fakesink sync=true", &errmsg));
+  pad = AudioMixer::attach (input ());
+  g_assert_nonnull (pad);
+  g_assert_cmpuint (AudioMixer::getInputCount (), ==, 1);
+  g_usleep (100 * G_USEC_PER_SEC / 1000);
+  g_assert_cmpuint (AudioMixer::getRunningTime (), >, 0);
+
+  AudioMixer::detach (pad);
+  g_assert_cmpuint (AudioMixer::getInputCount (), ==, 0);
+
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,82 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+#include "AudioMixer.h"
+
+int
+main (void)
+{
+  Formatter *fmt;
+  Document *doc;
+  Media *m1;
+  Media *m2;
+  Time t0;
+  string errmsg;
+
+  // Mix into a fake sink, so that no audio device is needed.
+  g_assert (AudioMixer::setSink ("fakesink sync=true", &errmsg));
+  g_assert_cmpuint (AudioMixer::getInputCount (), ==, 0);
+  g_assert_cmpuint (AudioMixer::getRunningTime (), ==, 0);
+
+  tests_parse_and_start (&fmt, &doc, xstrbuild ("\
+<ncl>\n\
+  <body>\n\
+    <port id='p1' component='m1'/>\n\
+    <port id='p2' component='m2'/>\n\
+    <media id='m1' src='%s'/>\n\
+    <media id='m2' src='%s'>\n\
+      <property name='volume' value='50%%'/>\n\
+    </media>\n\
+  </body>\n\
+</ncl>\n", samples[1].uri, samples[1].uri));
+
+  m1 = cast (Media *, doc->getObjectById ("m1"));
+  g_assert_nonnull (m1);
+  m2 = cast (Media *, doc->getObjectById ("m2"));
+  g_assert_nonnull (m2);
+
+  // Both sounds are mixed into the same output.
+  fmt->sendTick (0, 0, 0);
+  g_assert (m1->isOccurring ());
+  g_assert (m2->isOccurring ());
+  g_assert_cmpuint (AudioMixer::getInputCount (), ==, 2);
+
+  // The output is already open: its sink can no longer be changed.
+  g_assert_false (AudioMixer::setSink ("fakesink", &errmsg));
+  g_assert (errmsg != "");
+
+  // The mixer runs on its own clock.
+  t0 = AudioMixer::getRunningTime ();
+  g_usleep (100 * G_USEC_PER_SEC / 1000);
+  g_assert_cmpuint (AudioMixer::getRunningTime (), >, t0);
+
+  // Pausing and stopping an input does not affect the other.
+  g_assert_true (m1->getLambda ()->transition (Event::PAUSE));
+  g_assert (m1->isPaused ());
+  g_assert_true (m1->getLambda ()->transition (Event::RESUME));
+  g_assert_true (m1->getLambda ()->transition (Event::STOP));
+  g_assert (m1->isSleeping ());
+  Player::waitReaped ();
+  g_assert_cmpuint (AudioMixer::getInputCount (), ==, 1);
+
+  g_assert (fmt->stop ());
+  Player::waitReaped ();
+  g_assert_cmpuint (AudioMixer::getInputCount (), ==, 0);
+
+  delete fmt;
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,68 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+
+int
+main (void)
+{
+  Document *doc;
+  Context *root;
+  MediaSettings *settings;
+  Media *m1, *m2;
+  string next;
+
+  tests_create_document (&doc, &root, &settings);
+  g_assert_null (doc->getFocusMedias ("1"));
+
+  // Properties set before the object is in document.
+  m1 = new Media ("m1");
+  m1->setProperty ("focusIndex", "1");
+  m1->setProperty ("moveRight", "2");
+  g_assert (doc->addObject (m1));
+  g_assert_nonnull (doc->getFocusMedias ("1"));
+  g_assert (doc->getFocusMedias ("1")->count (m1));
+  g_assert (doc->getFocusNeighbour (m1, "CURSOR_RIGHT", &next));
+  g_assert (next == "2");
+  g_assert_false (doc->getFocusNeighbour (m1, "CURSOR_LEFT", &next));
+
+  // Properties set after the object is in document.
+  m2 = new Media ("m2");
+  g_assert (doc->addObject (m2));
+  m2->setProperty ("focusIndex", "2");
+  m2->setProperty ("moveLeft", "1");
+  g_assert (doc->getFocusMedias ("2")->count (m2));
+  g_assert (doc->getFocusNeighbour (m2, "CURSOR_LEFT", &next));
+  g_assert (next == "1");
+
+  // Changing the focus index moves the object.
+  m2->setProperty ("focusIndex", "3");
+  g_assert_null (doc->getFocusMedias ("2"));
+  g_assert (doc->getFocusMedias ("3")->count (m2));
+
+  // No object is occurring.
+  g_assert (doc->getFirstFocusIndex () == "");
+
+  // Removing the object drops it from the graph.
+  g_assert (doc->removeObject (m2));
+  g_assert_null (doc->getFocusMedias ("3"));
+  g_assert_false (doc->getFocusNeighbour (m2, "CURSOR_LEFT", &next));
+
+  delete m2;
+  delete doc;
+
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,75 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+
+int
+main (void)
+{
+  Document *doc;
+  Context *root;
+  MediaSettings *settings;
+  Media *m1, *m2;
+  Event *red, *blue, *enter;
+
+  tests_create_document (&doc, &root, &settings);
+  g_assert_null (doc->getSelectionEvents ("RED"));
+
+  // Events added before the object is in document.
+  m1 = new Media ("m1");
+  m1->addSelectionEvent ("RED");
+  red = m1->getSelectionEvent ("RED");
+  g_assert_nonnull (red);
+  g_assert (doc->addObject (m1));
+  g_assert_nonnull (doc->getSelectionEvents ("RED"));
+  g_assert_cmpint (doc->getSelectionEvents ("RED")->size (), ==, 1);
+  g_assert (doc->getSelectionEvents ("RED")->count (red));
+
+  // Events added after the object is in document.
+  m2 = new Media ("m2");
+  g_assert (doc->addObject (m2));
+  m2->addSelectionEvent ("RED");
+  m2->addSelectionEvent ("");
+  g_assert_cmpint (doc->getSelectionEvents ("RED")->size (), ==, 2);
+  enter = m2->getSelectionEvent ("");
+  g_assert_nonnull (enter);
+  g_assert_nonnull (doc->getSelectionEvents (""));
+  g_assert (doc->getSelectionEvents ("")->count (enter));
+
+  // Unresolved parameters are indexed under the empty key.
+  m2->addSelectionEvent ("$key");
+  g_assert_cmpint (doc->getSelectionEvents ("")->size (), ==, 2);
+
+  // Setting the key parameter moves the event.
+  m2->addSelectionEvent ("BLUE");
+  blue = m2->getSelectionEvent ("BLUE");
+  g_assert_nonnull (blue);
+  blue->setParameter ("key", "GREEN");
+  g_assert_null (doc->getSelectionEvents ("BLUE"));
+  g_assert_nonnull (doc->getSelectionEvents ("GREEN"));
+  g_assert (doc->getSelectionEvents ("GREEN")->count (blue));
+
+  // Removing the object drops its events.
+  g_assert (doc->removeObject (m2));
+  g_assert_cmpint (doc->getSelectionEvents ("RED")->size (), ==, 1);
+  g_assert_null (doc->getSelectionEvents (""));
+  g_assert_null (doc->getSelectionEvents ("GREEN"));
+
+  delete m2;
+  delete doc;
+
+  exit (EXIT_SUCCESS);
+}
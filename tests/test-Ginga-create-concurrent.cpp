@@ -0,0 +1,95 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+
+#define NTHREADS 4
+
+// Runs a presentation on the calling thread and moves its focus around a
+// ring of four media objects: thread i presses CURSOR_RIGHT i+1 times.
+static gpointer
+run (gpointer data)
+{
+  Formatter *fmt;
+  Document *doc;
+  int n = GPOINTER_TO_INT (data);
+  string expected;
+
+  tests_parse_and_start (&fmt, &doc, "\
+<ncl>\n\
+  <body>\n\
+    <port id='p1' component='m1'/>\n\
+    <port id='p2' component='m2'/>\n\
+    <port id='p3' component='m3'/>\n\
+    <port id='p4' component='m4'/>\n\
+    <media id='m1'>\n\
+      <property name='focusIndex' value='1'/>\n\
+      <property name='moveRight' value='2'/>\n\
+    </media>\n\
+    <media id='m2'>\n\
+      <property name='focusIndex' value='2'/>\n\
+      <property name='moveRight' value='3'/>\n\
+    </media>\n\
+    <media id='m3'>\n\
+      <property name='focusIndex' value='3'/>\n\
+      <property name='moveRight' value='4'/>\n\
+    </media>\n\
+    <media id='m4'>\n\
+      <property name='focusIndex' value='4'/>\n\
+      <property name='moveRight' value='1'/>\n\
+    </media>\n\
+  </body>\n\
+</ncl>\n");
+
+  fmt->sendTick (0, 0, 0);
+  fmt->sendTick (0, 0, 0);
+  g_assert (doc->getCurrentFocus () == "1");
+
+  for (int i = 0; i < n + 1; i++)
+    {
+      fmt->sendKey ("CURSOR_RIGHT", true);
+      fmt->sendKey ("CURSOR_RIGHT", false);
+      fmt->sendTick (0, 0, 0);
+      g_thread_yield ();
+    }
+
+  expected = xstrbuild ("%d", (n + 1) % 4 + 1);
+  g_assert (doc->getCurrentFocus () == expected);
+  g_assert (doc->getSettings ()->getProperty ("service.currentFocus")
+            == expected);
+  g_assert (cast (Media *, doc->getObjectById ("m" + expected))
+                ->isFocused ());
+
+  delete fmt;
+  return nullptr;
+}
+
+int
+main (void)
+{
+  GThread *threads[NTHREADS];
+
+  for (int i = 0; i < NTHREADS; i++)
+    {
+      threads[i] = g_thread_new (nullptr, run, GINT_TO_POINTER (i));
+      g_assert_nonnull (threads[i]);
+    }
+
+  for (int i = 0; i < NTHREADS; i++)
+    g_thread_join (threads[i]);
+
+  exit (EXIT_SUCCESS);
+}
@@ -29,6 +29,9 @@ main (void)
   opts.experimental = false;
   opts.webservices = false;
   opts.opengl = false;
+  opts.prewarm = false;
+  opts.memoryBudget = 64;
+  opts.sharedClock = true;
   opts.background = "green";
   Ginga *ginga = Ginga::create (&opts);
   g_assert_nonnull (ginga);
@@ -40,6 +43,9 @@ main (void)
   g_assert (out->webservices == opts.webservices);
   g_assert (out->experimental == opts.experimental);
   g_assert (out->opengl == opts.opengl);
+  g_assert (out->prewarm == opts.prewarm);
+  g_assert (out->memoryBudget == opts.memoryBudget);
+  g_assert (out->sharedClock == opts.sharedClock);
   g_assert (out->background == opts.background);
 
   exit (EXIT_SUCCESS);
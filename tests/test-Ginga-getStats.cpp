@@ -0,0 +1,118 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+
+int
+main (void)
+{
+  Formatter *fmt;
+  Document *doc;
+  cairo_surface_t *sfc;
+  cairo_t *cr;
+  GingaStats stats;
+  Media *m4;
+
+  tests_parse_and_start (&fmt, &doc, xstrbuild ("\
+<ncl>\n\
+  <body>\n\
+    <port id='p1' component='m1'/>\n\
+    <port id='p2' component='m2'/>\n\
+    <port id='p3' component='m3'/>\n\
+    <port id='p4' component='m4'/>\n\
+    <media id='m1'>\n\
+      <property name='focusIndex' value='1'/>\n\
+      <property name='moveRight' value='2'/>\n\
+    </media>\n\
+    <media id='m2'>\n\
+      <property name='focusIndex' value='2'/>\n\
+      <property name='moveLeft' value='1'/>\n\
+      <property name='moveRight' value='3'/>\n\
+    </media>\n\
+    <media id='m3' src='%s'>\n\
+      <property name='focusIndex' value='3'/>\n\
+    </media>\n\
+    <media id='m4'>\n\
+      <property name='explicitDur' value='1s'/>\n\
+    </media>\n\
+  </body>\n\
+</ncl>\n", samples[3].uri));
+
+  sfc = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 800, 600);
+  g_assert_nonnull (sfc);
+  cr = cairo_create (sfc);
+  g_assert_nonnull (cr);
+
+  fmt->sendTick (0, 0, 0);
+  fmt->sendTick (0, 0, 0);
+  fmt->redraw (cr);
+  fmt->getStats (&stats);
+  g_assert_cmpuint (stats.inputSamples, ==, 0);
+  g_assert_cmpuint (stats.inputLatencyMax, ==, 0);
+
+  // Key that moves the focus: sampled after the next redraw.
+  fmt->sendKey ("CURSOR_RIGHT", true);
+  fmt->sendKey ("CURSOR_RIGHT", false);
+  fmt->getStats (&stats);
+  g_assert_cmpuint (stats.inputSamples, ==, 0);
+  fmt->sendTick (0, 0, 0);
+  fmt->redraw (cr);
+  fmt->getStats (&stats);
+  g_assert_cmpuint (stats.inputSamples, ==, 1);
+  g_assert_cmpuint (stats.inputLatencyP50, <=, stats.inputLatencyP90);
+  g_assert_cmpuint (stats.inputLatencyP90, <=, stats.inputLatencyP99);
+  g_assert_cmpuint (stats.inputLatencyP99, <=, stats.inputLatencyMax);
+
+  // Key that changes nothing: not sampled.
+  fmt->sendKey ("RED", true);
+  fmt->sendTick (0, 0, 0);
+  fmt->redraw (cr);
+  fmt->getStats (&stats);
+  g_assert_cmpuint (stats.inputSamples, ==, 1);
+
+  // Key that changes nothing, followed by an unrelated transition: not
+  // sampled either.
+  m4 = cast (Media *, doc->getObjectById ("m4"));
+  g_assert_nonnull (m4);
+  g_assert (m4->isOccurring ());
+  fmt->sendKey ("RED", true);
+  fmt->sendTick (2 * GINGA_SECOND, 2 * GINGA_SECOND, 0);
+  g_assert (m4->isSleeping ());
+  fmt->redraw (cr);
+  fmt->getStats (&stats);
+  g_assert_cmpuint (stats.inputSamples, ==, 1);
+
+  // Key handled by an NCLua player, which only redraws its canvas:
+  // sampled after the redraw.
+  fmt->sendKey ("CURSOR_RIGHT", true);
+  fmt->sendTick (0, 0, 0);
+  fmt->redraw (cr);
+  fmt->getStats (&stats);
+  g_assert_cmpuint (stats.inputSamples, ==, 2);
+  g_assert (doc->getCurrentFocus () == "3");
+  fmt->sendKey ("RED", true);
+  fmt->getStats (&stats);
+  g_assert_cmpuint (stats.inputSamples, ==, 2);
+  fmt->redraw (cr);
+  fmt->getStats (&stats);
+  g_assert_cmpuint (stats.inputSamples, ==, 3);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (sfc);
+  delete fmt;
+
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,158 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+#include <json/json.h>
+
+// Returns \p root serialized.
+static string
+write_json (const Json::Value &root)
+{
+  Json::StreamWriterBuilder builder;
+  return Json::writeString (builder, root);
+}
+
+int
+main (void)
+{
+  Formatter *fmt;
+  Document *doc;
+  Media *m1, *m2;
+  Event *a1;
+  string file;
+  string state;
+  string errmsg;
+  Time begin, end;
+  Json::Value root, bad;
+  Json::CharReaderBuilder builder;
+  Json::CharReader *reader;
+
+  file = tests_write_tmp_file ("\
+<ncl>\n\
+  <head>\n\
+    <connectorBase>\n\
+      <causalConnector id='onBeginStart'>\n\
+        <simpleCondition role='onBegin'/>\n\
+        <simpleAction role='start'/>\n\
+      </causalConnector>\n\
+    </connectorBase>\n\
+  </head>\n\
+  <body>\n\
+    <port id='p1' component='m1'/>\n\
+    <media id='m1'>\n\
+      <property name='focusIndex' value='1'/>\n\
+      <area id='a1' begin='2s'/>\n\
+    </media>\n\
+    <media id='m2'>\n\
+      <property name='focusIndex' value='2'/>\n\
+    </media>\n\
+    <link xconnector='onBeginStart'>\n\
+      <bind role='onBegin' component='m1' interface='a1'/>\n\
+      <bind role='start' component='m2'/>\n\
+    </link>\n\
+  </body>\n\
+</ncl>\n");
+
+  // Cannot save a stopped presentation.
+  fmt = new Formatter (nullptr);
+  g_assert_nonnull (fmt);
+  g_assert_false (fmt->saveState (&state, &errmsg));
+  g_assert (fmt->start (file, &errmsg));
+  fmt->sendTick (0, 0, 0);
+  fmt->sendTick (GINGA_SECOND, GINGA_SECOND, 1);
+  g_assert (fmt->setPropertyValue ("m1", "foo", "bar", &errmsg));
+  g_assert (fmt->saveState (&state, &errmsg));
+  delete fmt;
+
+  // Restore into a fresh formatter.
+  fmt = new Formatter (nullptr);
+  g_assert_nonnull (fmt);
+  g_assert_false (fmt->restoreState ("{", &errmsg));
+  g_assert (fmt->getState () == GINGA_STATE_STOPPED);
+
+  // Corrupted states are rejected, not thrown on.
+  reader = builder.newCharReader ();
+  g_assert (reader->parse (state.data (), state.data () + state.length (),
+                           &root, nullptr));
+  delete reader;
+
+  bad = root;
+  bad["version"] = Json::Value (Json::arrayValue);
+  g_assert_false (fmt->restoreState (write_json (bad), &errmsg));
+
+  bad = root;
+  bad["tick"]["total"] = "now";
+  g_assert_false (fmt->restoreState (write_json (bad), &errmsg));
+
+  bad = root;
+  bad["objects"][0] = 42;
+  g_assert_false (fmt->restoreState (write_json (bad), &errmsg));
+
+  bad = root;
+  for (auto &o : bad["objects"])
+    if (o["id"].asString () == "m1")
+      o["properties"]["foo"] = Json::Value (Json::objectValue);
+  g_assert_false (fmt->restoreState (write_json (bad), &errmsg));
+
+  bad = root;
+  for (auto &o : bad["objects"])
+    if (o["events"].size () > 0)
+      o["events"][0]["state"] = "occurring";
+  g_assert_false (fmt->restoreState (write_json (bad), &errmsg));
+
+  bad = root;
+  for (auto &o : bad["objects"])
+    if (o["delayed"].size () > 0)
+      o["delayed"][0]["transition"] = "start";
+  g_assert_false (fmt->restoreState (write_json (bad), &errmsg));
+  g_assert (fmt->restoreState (state, &errmsg));
+  g_assert (fmt->getState () == GINGA_STATE_PLAYING);
+
+  doc = fmt->getDocument ();
+  g_assert_nonnull (doc);
+  m1 = cast (Media *, doc->getObjectById ("m1"));
+  g_assert_nonnull (m1);
+  m2 = cast (Media *, doc->getObjectById ("m2"));
+  g_assert_nonnull (m2);
+  a1 = m1->getPresentationEvent ("a1");
+  g_assert_nonnull (a1);
+
+  g_assert (doc->getRoot ()->isOccurring ());
+  g_assert (m1->isOccurring ());
+  g_assert_cmpuint (m1->getTime (), ==, GINGA_SECOND);
+  g_assert (m1->getProperty ("foo") == "bar");
+  g_assert (a1->getState () == Event::SLEEPING);
+  a1->getInterval (&begin, &end);
+  g_assert_cmpuint (begin, ==, 2 * GINGA_SECOND);
+  g_assert (m2->isSleeping ());
+  g_assert (doc->getCurrentFocus () == "1");
+
+  // Pending delayed actions and links resume from the saved point.
+  fmt->sendTick (2 * GINGA_SECOND, GINGA_SECOND, 2);
+  g_assert (a1->getState () == Event::OCCURRING);
+  g_assert (m2->isOccurring ());
+
+  // Saving the restored presentation gives a restorable state.
+  g_assert (fmt->saveState (&state, &errmsg));
+  g_assert (fmt->restoreState (state, &errmsg));
+  doc = fmt->getDocument ();
+  g_assert (cast (Media *, doc->getObjectById ("m2"))->isOccurring ());
+
+  delete fmt;
+  g_assert (g_remove (file.c_str ()) == 0);
+
+  exit (EXIT_SUCCESS);
+}
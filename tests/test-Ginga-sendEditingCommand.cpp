@@ -0,0 +1,125 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "tests.h"
+
+int
+main (void)
+{
+  Formatter *fmt;
+  Document *doc;
+  Context *body;
+  Media *m1, *m2;
+  string errmsg;
+  size_t nlinks;
+
+  tests_parse_and_start (&fmt, &doc, "\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n\
+   <region id='r1' width='50%'/>\n\
+  </regionBase>\n\
+  <descriptorBase>\n\
+   <descriptor id='d1' region='r1'/>\n\
+  </descriptorBase>\n\
+  <connectorBase>\n\
+   <causalConnector id='onBeginStart'>\n\
+    <simpleCondition role='onBegin'/>\n\
+    <simpleAction role='start'/>\n\
+   </causalConnector>\n\
+  </connectorBase>\n\
+ </head>\n\
+ <body id='b'>\n\
+  <port id='p1' component='m1'/>\n\
+  <media id='m1'/>\n\
+ </body>\n\
+</ncl>\n");
+
+  body = doc->getRoot ();
+  m1 = cast (Media *, doc->getObjectById ("m1"));
+  g_assert_nonnull (m1);
+  nlinks = body->getLinks ()->size ();
+
+  // Bad commands.
+  g_assert_false (fmt->sendEditingCommand ("", &errmsg));
+  g_assert_false (fmt->sendEditingCommand ("addFoo b x", &errmsg));
+  g_assert_false (fmt->sendEditingCommand ("removeNode b", &errmsg));
+  g_assert_false (fmt->sendEditingCommand ("removeNode x m1", &errmsg));
+  g_assert_false (fmt->sendEditingCommand ("removeNode b x", &errmsg));
+  g_assert_false (fmt->sendEditingCommand ("addNode b <media", &errmsg));
+  g_assert_false (
+      fmt->sendEditingCommand ("addNode b <media id='m1'/>", &errmsg));
+  g_assert_false (fmt->sendEditingCommand (
+      "addNode b <media id='m9' descriptor='nil'/>", &errmsg));
+  g_assert_null (doc->getObjectById ("m9"));
+
+  // addNode: uses the descriptors of the document.
+  g_assert_true (fmt->sendEditingCommand (
+      "addNode b <media id='m2' descriptor='d1'/>", &errmsg));
+  m2 = cast (Media *, doc->getObjectById ("m2"));
+  g_assert_nonnull (m2);
+  g_assert (m2->getParent () == body);
+  g_assert (doc->getMedias ()->find (m2) != doc->getMedias ()->end ());
+  g_assert (m2->getProperty ("width") != "");
+  g_assert (m2->isSleeping ());
+
+  // addLink and removeLink.
+  g_assert_true (fmt->sendEditingCommand ("addLink b \
+<link id='l1' xconnector='onBeginStart'>\
+<bind role='onBegin' component='m1'/>\
+<bind role='start' component='m2'/>\
+</link>",
+                                          &errmsg));
+  g_assert_cmpuint (body->getLinks ()->size (), ==, nlinks + 1);
+  g_assert (body->getLinkIds ()->back () == "l1");
+  g_assert_false (fmt->sendEditingCommand ("removeLink b l2", &errmsg));
+  g_assert_true (fmt->sendEditingCommand ("removeLink b l1", &errmsg));
+  g_assert_cmpuint (body->getLinks ()->size (), ==, nlinks);
+
+  // setPropertyValue.
+  g_assert_true (
+      fmt->sendEditingCommand ("setPropertyValue m1 background red",
+                               &errmsg));
+  g_assert (m1->getProperty ("background") == "red");
+
+  // removeNode: drops the links that refer to the node.
+  g_assert_true (fmt->sendEditingCommand ("addLink b \
+<link xconnector='onBeginStart'>\
+<bind role='onBegin' component='m1'/>\
+<bind role='start' component='m2'/>\
+</link>",
+                                          &errmsg));
+  g_assert_cmpuint (body->getLinks ()->size (), ==, nlinks + 1);
+  g_assert_true (fmt->sendEditingCommand ("removeNode b m2", &errmsg));
+  g_assert_null (doc->getObjectById ("m2"));
+  g_assert_cmpuint (body->getLinks ()->size (), ==, nlinks);
+  for (auto media : *doc->getMedias ())
+    g_assert (media->getId () != "m2");
+
+  // The presentation goes on.
+  g_assert_true (fmt->sendTick (0, 0, 0));
+  g_assert_true (fmt->sendTick (GINGA_SECOND, GINGA_SECOND, 1));
+  g_assert (m1->isOccurring ());
+
+  // Node can be added again.
+  g_assert_true (fmt->sendEditingCommand (
+      "addNode b <context id='m2'><media id='m3'/></context>", &errmsg));
+  g_assert_nonnull (doc->getObjectById ("m3"));
+
+  delete fmt;
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,128 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "tests.h"
+#include "LuaCache.h"
+using namespace ::ginga;
+
+// Sets the modification time of file at \p path.
+static void
+set_mtime (const string &path, guint64 sec, guint32 usec)
+{
+  GFile *file;
+  GFileInfo *info;
+
+  file = g_file_new_for_path (path.c_str ());
+  g_assert_nonnull (file);
+  info = g_file_info_new ();
+  g_assert_nonnull (info);
+  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                    sec);
+  g_file_info_set_attribute_uint32 (
+      info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, usec);
+  g_assert (g_file_set_attributes_from_info (
+      file, info, G_FILE_QUERY_INFO_NONE, nullptr, nullptr));
+  g_object_unref (info);
+  g_object_unref (file);
+}
+
+int
+main (void)
+{
+  gchar *tmp;
+  string path;
+  string cached;
+  string stale;
+  string errmsg;
+
+  // Use a private cache directory.
+  tmp = g_dir_make_tmp ("ginga-tests-XXXXXX", nullptr);
+  g_assert_nonnull (tmp);
+  g_assert (g_setenv ("XDG_CACHE_HOME", tmp, true));
+  g_assert (xstrhasprefix (LuaCache::getCacheDir (), tmp));
+  g_free (tmp);
+
+  // Check bad path.
+  g_assert (LuaCache::getCachedPath ("nonexistent") == "nonexistent");
+  g_assert_false (LuaCache::prewarm ("nonexistent", &errmsg));
+  g_assert (errmsg != "");
+
+  // Check bad script.
+  path = tests_write_tmp_file ("return {", "lua");
+  errmsg = "";
+  g_assert_false (LuaCache::prewarm (path, &errmsg));
+  g_assert (errmsg != "");
+  g_assert (LuaCache::getCachedPath (path) == path);
+
+  // Check cache hit.
+  path = tests_write_tmp_file ("return {'context', 'c', {}}", "lua");
+  cached = LuaCache::getCachedPath (path);
+  g_assert (cached != path);
+  g_assert (xstrhasprefix (cached, LuaCache::getCacheDir ()));
+  g_assert (g_file_test (cached.c_str (), G_FILE_TEST_IS_REGULAR));
+  g_assert (LuaCache::getCachedPath (path) == cached);
+  g_assert (LuaCache::prewarm (path, nullptr));
+
+  // Check cache miss after source changes.
+  g_assert (g_file_set_contents (path.c_str (),
+                                 "return {'context', 'c2', {}}", -1,
+                                 nullptr));
+  stale = cached;
+  cached = LuaCache::getCachedPath (path);
+  g_assert (cached != stale);
+
+  // Stale chunk of the same source is removed.
+  g_assert_false (g_file_test (stale.c_str (), G_FILE_TEST_EXISTS));
+
+  // Check cache miss when only the mtime changes, within the same second
+  // and keeping the same size.
+  g_assert (g_file_set_contents (path.c_str (),
+                                 "return {'context', 'c3', {}}", -1,
+                                 nullptr));
+  set_mtime (path, 1000000000, 100000);
+  stale = LuaCache::getCachedPath (path);
+  g_assert (stale != path);
+  set_mtime (path, 1000000000, 200000);
+  cached = LuaCache::getCachedPath (path);
+  g_assert (cached != path);
+  g_assert (cached != stale);
+  g_assert_false (g_file_test (stale.c_str (), G_FILE_TEST_EXISTS));
+
+  // Check that ltab documents parse the same from source and from cache.
+  for (int i = 1; i <= 4; i++)
+    {
+      Document *first;
+      Document *second;
+      string ltab = xstrbuild (
+          "%stests-ncl/tests-player-ltab/test-ltab-%d.lua",
+          ABS_TOP_SRCDIR, i);
+
+      first = ParserLua::parseFile (ltab, nullptr);
+      g_assert (LuaCache::getCachedPath (ltab) != ltab);
+      second = ParserLua::parseFile (ltab, nullptr);
+      g_assert ((first == nullptr) == (second == nullptr));
+      if (first != nullptr)
+        {
+          g_assert_cmpint (first->getObjects ()->size (), ==,
+                           second->getObjects ()->size ());
+          delete first;
+          delete second;
+        }
+    }
+
+  exit (EXIT_SUCCESS);
+}
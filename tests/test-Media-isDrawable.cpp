@@ -0,0 +1,86 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+
+int
+main (void)
+{
+  Formatter *fmt;
+  Document *doc;
+  Media *m1;
+  Media *m2;
+  string kind;
+  Player::Metrics pm;
+  cairo_surface_t *sfc;
+  cairo_t *cr;
+
+  tests_parse_and_start (&fmt, &doc, xstrbuild ("\
+<ncl>\n\
+  <body>\n\
+    <port id='p1' component='m1'/>\n\
+    <port id='p2' component='m2'/>\n\
+    <media id='m1' src='%s'>\n\
+      <property name='soundLevel' value='50%%'/>\n\
+      <property name='balanceLevel' value='-1'/>\n\
+    </media>\n\
+    <media id='m2' src='%s'/>\n\
+  </body>\n\
+</ncl>\n", samples[1].uri, samples[6].uri));
+
+  m1 = cast (Media *, doc->getObjectById ("m1"));
+  g_assert_nonnull (m1);
+  m2 = cast (Media *, doc->getObjectById ("m2"));
+  g_assert_nonnull (m2);
+
+  // Sleeping medias have nothing to draw.
+  g_assert_false (m1->isDrawable ());
+  g_assert_false (m2->isDrawable ());
+
+  fmt->sendTick (0, 0, 0);
+  g_assert (m1->isOccurring ());
+  g_assert (m2->isOccurring ());
+
+  // Audio is played by an audio-only player, which is not drawn.
+  g_assert (m1->getPlayerMetrics (&kind, &pm));
+  g_assert_cmpstr (kind.c_str (), ==, "audio");
+  g_assert_false (m1->isDrawable ());
+  g_assert (m2->getPlayerMetrics (&kind, &pm));
+  g_assert_cmpstr (kind.c_str (), ==, "video");
+  g_assert_true (m2->isDrawable ());
+
+  sfc = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 800, 600);
+  g_assert_nonnull (sfc);
+  cr = cairo_create (sfc);
+  g_assert_nonnull (cr);
+  fmt->redraw (cr);
+  g_assert (m1->getPlayerMetrics (nullptr, &pm));
+  g_assert_cmpuint (pm.lastDrawn, ==, 0);
+  g_assert_cmpuint (pm.surfaceBytes, ==, 0);
+
+  // Audio properties are applied to the pipeline.
+  m1->setProperty ("volume", "0");
+  m1->setProperty ("mute", "true");
+  m1->setProperty ("treble", "6");
+
+  g_assert (fmt->stop ());
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (sfc);
+  delete fmt;
+
+  exit (EXIT_SUCCESS);
+}
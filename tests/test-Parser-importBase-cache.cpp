@@ -0,0 +1,116 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "tests.h"
+
+#define DOUBLE_PROP_EQ(m, prop, value)                                     \
+  doubleeq (xstrtodorpercent ((m)->getProperty (prop), nullptr), (value))
+
+static Document *
+parse (const string &base)
+{
+  Document *doc;
+  string buf;
+  string errmsg;
+
+  buf = xstrbuild ("\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n\
+   <importBase alias='a' documentURI='%s'/>\n\
+   <importBase alias='b' documentURI='%s'/>\n\
+  </regionBase>\n\
+  <descriptorBase>\n\
+   <descriptor id='d1' region='a#r'/>\n\
+   <descriptor id='d2' region='b#r'/>\n\
+  </descriptorBase>\n\
+ </head>\n\
+ <body>\n\
+  <media id='m1' descriptor='d1'/>\n\
+  <media id='m2' descriptor='d2'/>\n\
+ </body>\n\
+</ncl>\n",
+                   base.c_str (), base.c_str ());
+
+  doc = Parser::parseBuffer (buf.c_str (), buf.length (), 100, 100,
+                             &errmsg);
+  if (doc == nullptr)
+    {
+      g_printerr ("*** Unexpected error: %s\n", errmsg.c_str ());
+      g_assert_not_reached ();
+    }
+  return doc;
+}
+
+static void
+check (Document *doc, double width)
+{
+  for (auto id : { "m1", "m2" })
+    {
+      Media *m = cast (Media *, doc->getObjectById (id));
+      g_assert_nonnull (m);
+      g_assert (DOUBLE_PROP_EQ (m, "width", width));
+    }
+  delete doc;
+}
+
+int
+main (void)
+{
+  string base;
+
+  base = tests_write_tmp_file ("\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n\
+   <region id='r' width='50%'/>\n\
+  </regionBase>\n\
+ </head>\n\
+</ncl>\n");
+
+  // Same base imported twice by a document, by many documents.
+  for (int i = 0; i < 3; i++)
+    check (parse (base), .5);
+
+  // Changed base is read again.
+  g_assert (g_file_set_contents (base.c_str (), "\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n\
+   <region id='r' width='5%'/>\n\
+  </regionBase>\n\
+ </head>\n\
+</ncl>\n",
+                                 -1, nullptr));
+  for (int i = 0; i < 3; i++)
+    check (parse (base), .05);
+
+  // So is a base changed again right away, keeping its size.
+  g_assert (g_file_set_contents (base.c_str (), "\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n\
+   <region id='r' width='7%'/>\n\
+  </regionBase>\n\
+ </head>\n\
+</ncl>\n",
+                                 -1, nullptr));
+  check (parse (base), .07);
+
+  g_assert (g_remove (base.c_str ()) == 0);
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,113 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "tests.h"
+
+#define DOUBLE_PROP_EQ(m, prop, value)                                     \
+  doubleeq (xstrtodorpercent ((m)->getProperty (prop), nullptr), (value))
+
+#define N 8
+
+static string
+write_base (int width, const string &nested = "")
+{
+  string imp;
+  if (nested != "")
+    imp = xstrbuild ("   <importBase alias='n' documentURI='%s'/>\n",
+                     nested.c_str ());
+  return tests_write_tmp_file (xstrbuild ("\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n\
+%s\
+   <region id='r' width='%d%%'/>\n\
+  </regionBase>\n\
+ </head>\n\
+</ncl>\n",
+                                          imp.c_str (), width));
+}
+
+int
+main (void)
+{
+  string bases[N];
+  string nested;
+  string imports;
+  string descs;
+  string medias;
+  string buf;
+  string errmsg;
+  Document *doc;
+
+  // Many imports, one of them importing another document.
+  nested = write_base (1);
+  for (int i = 0; i < N; i++)
+    {
+      bases[i] = (i == 0) ? write_base (10, nested) : write_base (10 + i);
+      imports += xstrbuild ("   <importBase alias='a%d' documentURI='%s'/>\n",
+                            i, bases[i].c_str ());
+      descs += xstrbuild ("   <descriptor id='d%d' region='a%d#r'/>\n", i,
+                          i);
+      medias += xstrbuild ("  <media id='m%d' descriptor='d%d'/>\n", i, i);
+    }
+
+  buf = xstrbuild ("\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n\
+%s\
+  </regionBase>\n\
+  <descriptorBase>\n\
+%s\
+  </descriptorBase>\n\
+ </head>\n\
+ <body>\n\
+%s\
+ </body>\n\
+</ncl>\n",
+                   imports.c_str (), descs.c_str (), medias.c_str ());
+
+  for (int k = 0; k < 3; k++)
+    {
+      doc = Parser::parseBuffer (buf.c_str (), buf.length (), 100, 100,
+                                 &errmsg);
+      if (doc == nullptr)
+        {
+          g_printerr ("*** Unexpected error: %s\n", errmsg.c_str ());
+          g_assert_not_reached ();
+        }
+      for (int i = 0; i < N; i++)
+        {
+          Media *m = cast (Media *, doc->getObjectById (xstrbuild ("m%d", i)));
+          g_assert_nonnull (m);
+          g_assert (DOUBLE_PROP_EQ (m, "width", (10 + i) / 100.));
+        }
+      delete doc;
+    }
+
+  // Missing imported document is still reported.
+  g_assert (g_remove (bases[N - 1].c_str ()) == 0);
+  doc = Parser::parseBuffer (buf.c_str (), buf.length (), 100, 100,
+                             &errmsg);
+  g_assert_null (doc);
+  g_assert (errmsg != "");
+
+  for (int i = 0; i < N - 1; i++)
+    g_assert (g_remove (bases[i].c_str ()) == 0);
+  g_assert (g_remove (nested.c_str ()) == 0);
+  exit (EXIT_SUCCESS);
+}
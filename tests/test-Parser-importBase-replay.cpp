@@ -0,0 +1,137 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+
+static Document *
+parse (const string &base)
+{
+  Document *doc;
+  string buf;
+  string errmsg;
+
+  buf = xstrbuild ("\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n\
+   <importBase alias='a' documentURI='%s'/>\n\
+   <region id='r' zIndex='1'/>\n\
+  </regionBase>\n\
+  <ruleBase>\n\
+   <importBase alias='a' documentURI='%s'/>\n\
+  </ruleBase>\n\
+  <connectorBase>\n\
+   <importBase alias='a' documentURI='%s'/>\n\
+  </connectorBase>\n\
+ </head>\n\
+ <body>\n\
+  <port id='p' component='m1'/>\n\
+  <port id='q' component='s'/>\n\
+  <media id='settings' type='application/x-ginga-settings'>\n\
+   <property name='var' value='x'/>\n\
+  </media>\n\
+  <media id='m1'/>\n\
+  <media id='m2'/>\n\
+  <switch id='s'>\n\
+   <bindRule constituent='m3' rule='a#rX'/>\n\
+   <media id='m3'/>\n\
+  </switch>\n\
+  <link xconnector='a#onBeginTestStart'>\n\
+   <bind component='m1' role='onBegin'/>\n\
+   <bind component='settings' interface='var' role='test'/>\n\
+   <bind component='m2' role='start'/>\n\
+  </link>\n\
+ </body>\n\
+</ncl>\n",
+                   base.c_str (), base.c_str (), base.c_str ());
+
+  doc = Parser::parseBuffer (buf.c_str (), buf.length (), 100, 100,
+                             &errmsg);
+  if (doc == nullptr)
+    {
+      g_printerr ("*** Unexpected error: %s\n", errmsg.c_str ());
+      g_assert_not_reached ();
+    }
+  return doc;
+}
+
+static void
+check (Document *doc)
+{
+  Context *body;
+  Switch *s;
+  const list<pair<list<Action>, list<Action> > > *links;
+
+  body = cast (Context *, doc->getRoot ());
+  g_assert_nonnull (body);
+
+  // Connector predicate survives the import.
+  links = body->getLinks ();
+  g_assert (links->size () == 1);
+  g_assert (links->front ().first.size () == 1);
+  g_assert (links->front ().second.size () == 1);
+  g_assert_nonnull (links->front ().first.front ().predicate);
+  g_assert (links->front ().first.front ().predicate->toString ().find (
+                "=='x'")
+            != string::npos);
+
+  // So does the rule predicate.
+  s = cast (Switch *, doc->getObjectById ("s"));
+  g_assert_nonnull (s);
+  g_assert (s->getRules ()->size () == 1);
+  g_assert_nonnull (s->getRules ()->front ().second);
+  g_assert (s->getRules ()->front ().second->toString ()
+            == "$__settings__.var=='x'");
+
+  delete doc;
+}
+
+int
+main (void)
+{
+  string base;
+
+  base = tests_write_tmp_file ("\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n\
+   <region id='r' width='50%'/>\n\
+  </regionBase>\n\
+  <ruleBase>\n\
+   <rule id='rX' var='var' value='x' comparator='eq'/>\n\
+  </ruleBase>\n\
+  <connectorBase>\n\
+   <causalConnector id='onBeginTestStart'>\n\
+    <compoundCondition operator='and'>\n\
+     <simpleCondition role='onBegin'/>\n\
+     <assessmentStatement comparator='eq'>\n\
+      <attributeAssessment role='test'/>\n\
+      <valueAssessment value='x'/>\n\
+     </assessmentStatement>\n\
+    </compoundCondition>\n\
+    <simpleAction role='start'/>\n\
+   </causalConnector>\n\
+  </connectorBase>\n\
+ </head>\n\
+</ncl>\n");
+
+  // First parse processes the bases, the others replay them.
+  for (int i = 0; i < 3; i++)
+    check (parse (base));
+
+  g_assert (g_remove (base.c_str ()) == 0);
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,95 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "tests.h"
+
+// Checks that every id reference of a document with many units resolves;
+// see bench/bench-Parser-parseBuffer.cpp for the parse-time benchmark.
+
+#define UNITS 100
+
+static string
+gen_document (int units)
+{
+  string regions, descriptors, body;
+
+  for (int i = 0; i < units; i++)
+    {
+      regions += xstrbuild ("   <region id='r%d' width='10%%'/>\n", i);
+      descriptors += xstrbuild (
+          "   <descriptor id='d%d' region='r%d'/>\n", i, i);
+      body += xstrbuild ("  <port id='p%d' component='m%d'/>\n", i, i);
+      body += xstrbuild ("  <media id='m%d' descriptor='d%d'/>\n", i, i);
+      body += xstrbuild ("\
+  <link xconnector='onBeginStart'>\n\
+   <bind role='onBegin' component='m%d'/>\n\
+   <bind role='start' component='m%d'/>\n\
+  </link>\n",
+                         i, (i + 1) % units);
+    }
+
+  return "\
+<ncl>\n\
+ <head>\n\
+  <regionBase>\n" + regions + "\
+  </regionBase>\n\
+  <descriptorBase>\n" + descriptors + "\
+  </descriptorBase>\n\
+  <connectorBase>\n\
+   <causalConnector id='onBeginStart'>\n\
+    <simpleCondition role='onBegin'/>\n\
+    <simpleAction role='start'/>\n\
+   </causalConnector>\n\
+  </connectorBase>\n\
+ </head>\n\
+ <body>\n" + body + "\
+ </body>\n\
+</ncl>\n";
+}
+
+int
+main (void)
+{
+  Document *doc;
+  string buf;
+  string errmsg;
+  const list<pair<list<Action>, list<Action> > > *links;
+
+  buf = gen_document (UNITS);
+  doc = Parser::parseBuffer (buf.c_str (), buf.length (), 800, 600,
+                             &errmsg);
+  if (doc == nullptr)
+    {
+      g_printerr ("*** Unexpected error: %s\n", errmsg.c_str ());
+      g_assert_not_reached ();
+    }
+
+  g_assert_cmpint (doc->getMedias ()->size (), ==, UNITS + 1); // +settings
+  g_assert_nonnull (doc->getObjectById ("m0"));
+  g_assert_nonnull (doc->getObjectById (xstrbuild ("m%d", UNITS - 1)));
+
+  links = doc->getRoot ()->getLinks ();
+  g_assert_cmpint (links->size (), ==, UNITS);
+  for (auto &link : *links)
+    {
+      g_assert_cmpint (link.first.size (), ==, 1);
+      g_assert_cmpint (link.second.size (), ==, 1);
+    }
+
+  delete doc;
+  exit (EXIT_SUCCESS);
+}
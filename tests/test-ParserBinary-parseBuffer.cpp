@@ -0,0 +1,251 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "tests.h"
+#include "ParserBinary.h"
+
+static void
+check_events_equal (Object *a, Object *b)
+{
+  g_assert_cmpuint (a->getEvents ()->size (), ==, b->getEvents ()->size ());
+  for (auto evt : *a->getEvents ())
+    {
+      Event *other = b->getEvent (evt->getType (), evt->getId ());
+      Time begin1, end1, begin2, end2;
+
+      g_assert_nonnull (other);
+      evt->getInterval (&begin1, &end1);
+      other->getInterval (&begin2, &end2);
+      g_assert (begin1 == begin2);
+      g_assert (end1 == end2);
+      g_assert (evt->getLabel () == other->getLabel ());
+      g_assert (*evt->getParameters () == *other->getParameters ());
+    }
+}
+
+static void
+check_documents_equal (Document *a, Document *b)
+{
+  g_assert (a->getId () == b->getId ());
+  g_assert_cmpuint (a->getObjects ()->size (), ==,
+                    b->getObjects ()->size ());
+  g_assert_cmpuint (a->getMedias ()->size (), ==, b->getMedias ()->size ());
+  g_assert_cmpuint (a->getContexts ()->size (), ==,
+                    b->getContexts ()->size ());
+  g_assert_cmpuint (a->getSwitches ()->size (), ==,
+                    b->getSwitches ()->size ());
+
+  for (auto obj : *a->getObjects ())
+    {
+      Object *other = b->getObjectById (obj->getId ());
+      g_assert_nonnull (other);
+      g_assert (obj->getObjectTypeAsString ()
+                == other->getObjectTypeAsString ());
+      if (obj->getParent () == nullptr)
+        g_assert_null (other->getParent ());
+      else
+        g_assert (obj->getParent ()->getId ()
+                  == other->getParent ()->getId ());
+      g_assert (*obj->getProperties () == *other->getProperties ());
+      g_assert_cmpuint (obj->getAliases ()->size (), ==,
+                        other->getAliases ()->size ());
+      for (auto &alias : *obj->getAliases ())
+        g_assert (other->hasAlias (alias.first));
+      check_events_equal (obj, other);
+
+      if (instanceof (Context *, obj))
+        {
+          Context *c1 = cast (Context *, obj);
+          Context *c2 = cast (Context *, other);
+          g_assert_cmpuint (c1->getPorts ()->size (), ==,
+                            c2->getPorts ()->size ());
+          g_assert_cmpuint (c1->getLinks ()->size (), ==,
+                            c2->getLinks ()->size ());
+
+          auto it = c2->getLinks ()->begin ();
+          for (auto &link : *c1->getLinks ())
+            {
+              g_assert_cmpuint (link.first.size (), ==,
+                                it->first.size ());
+              g_assert_cmpuint (link.second.size (), ==,
+                                it->second.size ());
+              auto act = it->second.begin ();
+              for (auto &a1 : link.second)
+                {
+                  g_assert (a1.event->getFullId ()
+                            == act->event->getFullId ());
+                  g_assert (a1.transition == act->transition);
+                  g_assert (a1.value == act->value);
+                  act++;
+                }
+              it++;
+            }
+        }
+      else if (instanceof (Switch *, obj))
+        {
+          Switch *s1 = cast (Switch *, obj);
+          Switch *s2 = cast (Switch *, other);
+          g_assert_cmpuint (s1->getRules ()->size (), ==,
+                            s2->getRules ()->size ());
+
+          auto it = s2->getRules ()->begin ();
+          for (auto &rule : *s1->getRules ())
+            {
+              g_assert (rule.first->getId () == it->first->getId ());
+              g_assert (rule.second->toString ()
+                        == it->second->toString ());
+              it++;
+            }
+        }
+    }
+}
+
+int
+main (void)
+{
+  Document *doc;
+  Document *copy;
+  Document *other;
+  string src;
+  string buf;
+  string rebuilt;
+  string errmsg;
+
+  buf = "\
+<ncl>\n\
+<head>\n\
+  <regionBase>\n\
+    <region id='r' left='10%' top='20%' width='50%' height='50%'/>\n\
+    <region id='px' left='10' top='20' width='40' height='30'>\n\
+      <region id='pxc' right='5' bottom='5' width='50%' height='10'/>\n\
+    </region>\n\
+  </regionBase>\n\
+  <descriptorBase>\n\
+    <descriptor id='d' region='r'/>\n\
+    <descriptor id='dpx' region='pxc'/>\n\
+  </descriptorBase>\n\
+  <ruleBase>\n\
+    <rule id='rVarIsX' var='var' value='x' comparator='eq'/>\n\
+    <rule id='rVarIsY' var='var' value='y' comparator='eq'/>\n\
+  </ruleBase>\n\
+  <connectorBase>\n\
+    <causalConnector id='onBeginStart'>\n\
+      <simpleCondition role='onBegin'/>\n\
+      <simpleAction role='start'/>\n\
+    </causalConnector>\n\
+    <causalConnector id='onBeginPropertyTestStart'>\n\
+      <connectorParam name='val'/>\n\
+      <compoundCondition operator='and'>\n\
+        <simpleCondition role='onBegin'/>\n\
+        <assessmentStatement comparator='eq'>\n\
+          <attributeAssessment role='propertyTest'/>\n\
+          <valueAssessment value='$val'/>\n\
+        </assessmentStatement>\n\
+      </compoundCondition>\n\
+      <simpleAction role='start'/>\n\
+    </causalConnector>\n\
+  </connectorBase>\n\
+</head>\n\
+<body id='body'>\n\
+  <port id='p' component='m1'/>\n\
+  <link xconnector='onBeginStart'>\n\
+    <bind role='onBegin' component='body'/>\n\
+    <bind role='start' component='c1' interface='port2'/>\n\
+  </link>\n\
+  <link xconnector='onBeginPropertyTestStart'>\n\
+    <bind role='onBegin' component='m1' interface='a1'/>\n\
+    <bind role='propertyTest' component='settings' interface='var'>\n\
+      <bindParam name='val' value='x'/>\n\
+    </bind>\n\
+    <bind role='start' component='m4'/>\n\
+  </link>\n\
+  <media id='settings' type='application/x-ginga-settings'>\n\
+    <property name='var' value='x'/>\n\
+  </media>\n\
+  <media id='m1' descriptor='d'>\n\
+    <area id='a1' begin='1s' end='2s'/>\n\
+    <area id='a2' label='l'/>\n\
+  </media>\n\
+  <media id='m4'/>\n\
+  <media id='m5' descriptor='dpx'>\n\
+    <property name='top' value='1%'/>\n\
+  </media>\n\
+  <context id='c1'>\n\
+    <port id='port2' component='switch'/>\n\
+    <switch id='switch'>\n\
+      <bindRule constituent='m2' rule='rVarIsX'/>\n\
+      <bindRule constituent='m3' rule='rVarIsY'/>\n\
+      <media id='m2'/>\n\
+      <media id='m3'/>\n\
+    </switch>\n\
+  </context>\n\
+</body>\n\
+</ncl>";
+  src = buf;
+  doc = Parser::parseBuffer (src.c_str (), src.length (), 100, 100,
+                             &errmsg);
+  g_assert_nonnull (doc);
+
+  // Round-trip.
+  g_assert (ParserBinary::writeBuffer (doc, 100, 100, &buf, &errmsg));
+  g_assert (buf.size () > 0);
+  copy = ParserBinary::parseBuffer (buf.data (), buf.size (), 100, 100,
+                                    &errmsg);
+  g_assert_nonnull (copy);
+  check_documents_equal (doc, copy);
+  g_assert (copy->getObjectByIdOrAlias ("settings") == copy->getSettings ());
+  delete copy;
+
+  // Other screen sizes: region geometry is the same as parsing the source
+  // at that size.
+  copy = ParserBinary::parseBuffer (buf.data (), buf.size (), 200, 100,
+                                    &errmsg);
+  g_assert_nonnull (copy);
+  other = Parser::parseBuffer (src.c_str (), src.length (), 200, 100,
+                               &errmsg);
+  g_assert_nonnull (other);
+  check_documents_equal (other, copy);
+  g_assert (copy->getObjectById ("m5")->getProperty ("left") == "12.5%");
+  g_assert (copy->getObjectById ("m5")->getProperty ("top") == "1%");
+  g_assert (copy->getObjectById ("m5")->getProperty ("left")
+            != doc->getObjectById ("m5")->getProperty ("left"));
+
+  delete other;
+
+  // Compiling a loaded document keeps the source geometry.
+  g_assert (ParserBinary::writeBuffer (copy, 200, 100, &rebuilt,
+                                       &errmsg));
+  delete copy;
+  copy = ParserBinary::parseBuffer (rebuilt.data (), rebuilt.size (), 100,
+                                    100, &errmsg);
+  g_assert_nonnull (copy);
+  check_documents_equal (doc, copy);
+  delete copy;
+
+  // Truncated buffers.
+  for (size_t n = 0; n < buf.size (); n += 7)
+    g_assert_null (
+        ParserBinary::parseBuffer (buf.data (), n, 100, 100, nullptr));
+
+  // Bad magic.
+  buf[0] = 'X';
+  g_assert_null (ParserBinary::parseBuffer (buf.data (), buf.size (), 100,
+                                            100, nullptr));
+
+  delete doc;
+  exit (EXIT_SUCCESS);
+}
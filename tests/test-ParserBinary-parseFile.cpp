@@ -0,0 +1,89 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "tests.h"
+#include "ParserBinary.h"
+
+int
+main (void)
+{
+  Document *doc;
+  gchar *tmp;
+  gsize len;
+  string dir;
+  string src;
+  string out;
+  string buf;
+  string errmsg;
+
+  tmp = g_dir_make_tmp ("ginga-tests-XXXXXX", nullptr);
+  g_assert_nonnull (tmp);
+  dir = tmp;
+  g_free (tmp);
+
+  // Source in DIR/a, compiled document in DIR/b/c.
+  g_assert (g_mkdir_with_parents (xpathbuild (dir, "a").c_str (), 0755)
+            == 0);
+  g_assert (g_mkdir_with_parents (xpathbuild (dir, "b/c").c_str (), 0755)
+            == 0);
+  src = xpathbuild (dir, "a/doc.ncl");
+  out = xpathbuild (dir, "b/c/doc.nclb");
+  g_assert (g_file_set_contents (src.c_str (), "\
+<ncl>\n\
+<body>\n\
+  <media id='m1' src='media/x.png'/>\n\
+  <media id='m2' src='../y.png'/>\n\
+  <media id='m3' src='http://example.com/z.png'/>\n\
+  <media id='m4'/>\n\
+</body>\n\
+</ncl>",
+                                 -1, nullptr));
+
+  doc = Parser::parseFile (src, 100, 100, &errmsg);
+  g_assert_nonnull (doc);
+  g_assert (doc->getObjectById ("m1")->getProperty ("uri")
+            == xurifromsrc (xpathbuild (dir, "a/media/x.png"), ""));
+  g_assert (ParserBinary::writeFile (doc, 100, 100, out, &errmsg));
+  delete doc;
+
+  // Compiled document does not refer to the source directory.
+  g_assert (g_file_get_contents (out.c_str (), &tmp, &len, nullptr));
+  buf.assign (tmp, len);
+  g_free (tmp);
+  g_assert (buf.find (dir) == string::npos);
+
+  // Relative sources are resolved against the compiled document.
+  doc = ParserBinary::parseFile (out, 100, 100, &errmsg);
+  g_assert_nonnull (doc);
+  g_assert (doc->getObjectById ("m1")->getProperty ("uri")
+            == xurifromsrc (xpathbuild (dir, "b/c/media/x.png"), ""));
+  g_assert (doc->getObjectById ("m2")->getProperty ("uri")
+            == xurifromsrc (xpathbuild (dir, "b/y.png"), ""));
+  g_assert (doc->getObjectById ("m3")->getProperty ("uri")
+            == "http://example.com/z.png");
+  g_assert (doc->getObjectById ("m4")->getProperty ("uri") == "");
+  delete doc;
+
+  g_assert (g_remove (out.c_str ()) == 0);
+  g_assert (g_remove (src.c_str ()) == 0);
+  g_assert (g_rmdir (xpathbuild (dir, "b/c").c_str ()) == 0);
+  g_assert (g_rmdir (xpathbuild (dir, "b").c_str ()) == 0);
+  g_assert (g_rmdir (xpathbuild (dir, "a").c_str ()) == 0);
+  g_assert (g_rmdir (dir.c_str ()) == 0);
+
+  exit (EXIT_SUCCESS);
+}
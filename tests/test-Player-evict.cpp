@@ -0,0 +1,124 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "tests.h"
+
+// Gets the surface bytes of the player of media \p id.
+static guint64
+surface_bytes (Document *doc, const string &id)
+{
+  Media *media;
+  Player::Metrics pm;
+
+  media = cast (Media *, doc->getObjectById (id));
+  g_assert_nonnull (media);
+  g_assert (media->getPlayerMetrics (nullptr, &pm));
+  return pm.surfaceBytes;
+}
+
+int
+main (void)
+{
+  Formatter *fmt;
+  Document *doc;
+  cairo_surface_t *sfc;
+  cairo_t *cr;
+  FormatterMetrics fm;
+  Media *m1;
+  Media *m2;
+
+  tests_parse_and_start (&fmt, &doc, xstrbuild ("\
+<ncl>\n\
+  <body>\n\
+    <port id='p1' component='m1'/>\n\
+    <port id='p2' component='m2'/>\n\
+    <media id='m1' src='%s'/>\n\
+    <media id='m2' src='%s'>\n\
+      <property name='visible' value='false'/>\n\
+    </media>\n\
+  </body>\n\
+</ncl>\n", samples[2].uri, samples[2].uri));
+
+  m1 = cast (Media *, doc->getObjectById ("m1"));
+  g_assert_nonnull (m1);
+  m2 = cast (Media *, doc->getObjectById ("m2"));
+  g_assert_nonnull (m2);
+
+  sfc = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 800, 600);
+  g_assert_nonnull (sfc);
+  cr = cairo_create (sfc);
+  g_assert_nonnull (cr);
+
+  fmt->sendTick (0, 0, 0);
+  fmt->redraw (cr);
+  g_assert_cmpuint (surface_bytes (doc, "m1"), >, 0);
+  g_assert_cmpuint (surface_bytes (doc, "m2"), >, 0);
+
+  // No budget: nothing is evicted.
+  fmt->getMetrics (&fm);
+  g_assert_cmpuint (fm.evictions, ==, 0);
+
+  // Each image takes more than 1MB: the invisible one is evicted, the
+  // visible one is kept even though it exceeds the budget.
+  fmt->setOptionInt ("memoryBudget", 1);
+  fmt->redraw (cr);
+  g_assert_cmpuint (surface_bytes (doc, "m1"), >, 0);
+  g_assert_cmpuint (surface_bytes (doc, "m2"), ==, 0);
+  fmt->getMetrics (&fm);
+  g_assert_cmpuint (fm.evictions, ==, 1);
+  g_assert_cmpuint (fm.evictedBytes, >, 0);
+
+  // Evicted player is reloaded when it becomes visible; the other one,
+  // which is no longer drawn, is evicted in turn.
+  m2->setProperty ("visible", "true");
+  m1->setProperty ("visible", "false");
+  fmt->redraw (cr);
+  g_assert_cmpuint (surface_bytes (doc, "m1"), ==, 0);
+  g_assert_cmpuint (surface_bytes (doc, "m2"), >, 0);
+  fmt->getMetrics (&fm);
+  g_assert_cmpuint (fm.evictions, ==, 2);
+
+  // Budget large enough: nothing else is evicted.
+  fmt->setOptionInt ("memoryBudget", 64);
+  m1->setProperty ("visible", "true");
+  fmt->redraw (cr);
+  m1->setProperty ("visible", "false");
+  fmt->redraw (cr);
+  g_assert_cmpuint (surface_bytes (doc, "m1"), >, 0);
+  fmt->getMetrics (&fm);
+  g_assert_cmpuint (fm.evictions, ==, 2);
+
+  // Changing the budget forces a check on the next redraw.
+  fmt->setOptionInt ("memoryBudget", 1);
+  fmt->redraw (cr);
+  g_assert_cmpuint (surface_bytes (doc, "m1"), ==, 0);
+  fmt->getMetrics (&fm);
+  g_assert_cmpuint (fm.evictions, ==, 3);
+
+  // Nothing was reloaded: the next check waits for the periodic one.
+  m2->setProperty ("visible", "false");
+  fmt->redraw (cr);
+  g_assert_cmpuint (surface_bytes (doc, "m2"), >, 0);
+  fmt->getMetrics (&fm);
+  g_assert_cmpuint (fm.evictions, ==, 3);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (sfc);
+  delete fmt;
+
+  exit (EXIT_SUCCESS);
+}
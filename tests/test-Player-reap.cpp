@@ -0,0 +1,76 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+
+static GThread *reaper_thread;
+static gint reaped;
+
+// Records that \p data has been released and by which thread.
+static void
+release (gpointer data)
+{
+  g_usleep (10 * G_USEC_PER_SEC / 1000);
+  reaper_thread = g_thread_self ();
+  g_atomic_int_add ((gint *) data, 1);
+}
+
+int
+main (void)
+{
+  // Resources are released in order, in another thread.
+  for (int i = 0; i < 5; i++)
+    Player::reap (release, &reaped);
+  Player::waitReaped ();
+  g_assert_cmpint (g_atomic_int_get (&reaped), ==, 5);
+  g_assert (reaper_thread != g_thread_self ());
+
+  // Stop does not wait for the pipelines of stopped players.
+  {
+    Formatter *fmt;
+    Document *doc;
+    Media *m1;
+    Media *m2;
+
+    tests_parse_and_start (&fmt, &doc, xstrbuild ("\
+<ncl>\n\
+  <body>\n\
+    <port id='p1' component='m1'/>\n\
+    <port id='p2' component='m2'/>\n\
+    <media id='m1' src='%s'/>\n\
+    <media id='m2' src='%s'/>\n\
+  </body>\n\
+</ncl>\n", samples[6].uri, samples[1].uri));
+
+    m1 = cast (Media *, doc->getObjectById ("m1"));
+    g_assert_nonnull (m1);
+    m2 = cast (Media *, doc->getObjectById ("m2"));
+    g_assert_nonnull (m2);
+
+    fmt->sendTick (0, 0, 0);
+    g_assert (m1->isOccurring ());
+    g_assert (m2->isOccurring ());
+
+    g_assert (fmt->stop ());
+    Player::waitReaped ();
+    delete fmt;
+  }
+
+  // Resources pushed right before exit are still released.
+  Player::reap (release, &reaped);
+
+  exit (EXIT_SUCCESS);
+}
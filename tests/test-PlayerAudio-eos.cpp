@@ -0,0 +1,117 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+#include "AudioMixer.h"
+
+// Ticks formatter until \p m stops, for at most 10s of wall time.
+static void
+tick_until_stopped (Formatter *fmt, Media *m)
+{
+  for (int i = 0; i < 1000 && !m->isSleeping (); i++)
+    {
+      fmt->sendTick (10 * GINGA_MSECOND, 10 * GINGA_MSECOND, 0);
+      g_usleep (10 * G_USEC_PER_SEC / 1000);
+    }
+}
+
+static void
+start (Formatter **fmt, Document **doc, Media **m1, Media **m2)
+{
+  tests_parse_and_start (fmt, doc, xstrbuild ("\
+<ncl>\n\
+ <head>\n\
+  <connectorBase>\n\
+   <causalConnector id='onEndStart'>\n\
+    <simpleCondition role='onEnd'/>\n\
+    <simpleAction role='start'/>\n\
+   </causalConnector>\n\
+  </connectorBase>\n\
+ </head>\n\
+ <body>\n\
+  <port id='p1' component='m1'/>\n\
+  <media id='m1' src='%s'/>\n\
+  <media id='m2'/>\n\
+  <link xconnector='onEndStart'>\n\
+   <bind role='onEnd' component='m1'/>\n\
+   <bind role='start' component='m2'/>\n\
+  </link>\n\
+ </body>\n\
+</ncl>\n", samples[1].uri));
+
+  *m1 = cast (Media *, (*doc)->getObjectById ("m1"));
+  g_assert_nonnull (*m1);
+  *m2 = cast (Media *, (*doc)->getObjectById ("m2"));
+  g_assert_nonnull (*m2);
+
+  (*fmt)->sendTick (0, 0, 0);
+  g_assert ((*m1)->isOccurring ());
+  g_assert ((*m2)->isSleeping ());
+}
+
+int
+main (void)
+{
+  string errmsg;
+
+  // Mix into a fake sink, so that no audio device is needed.
+  g_assert (AudioMixer::setSink ("fakesink sync=true", &errmsg));
+
+  // Relative seek past the end ends the media on the next tick.
+  {
+    Formatter *fmt;
+    Document *doc;
+    Media *m1;
+    Media *m2;
+    Time time = 0;
+
+    start (&fmt, &doc, &m1, &m2);
+    for (int i = 0; i < 1000 && time == 0; i++)
+      {
+        fmt->sendTick (10 * GINGA_MSECOND, 10 * GINGA_MSECOND, 0);
+        g_usleep (10 * G_USEC_PER_SEC / 1000);
+        g_assert (m1->getPlayerTime (&time, nullptr));
+      }
+    g_assert_cmpuint (time, >, 0);
+
+    m1->setProperty ("time", "+1000s");
+    fmt->sendTick (0, 0, 0);
+    g_assert (m1->isSleeping ());
+    g_assert (m2->isOccurring ());
+
+    delete fmt;
+  }
+
+  // So does a seek that makes the decoder run out of data.
+  {
+    Formatter *fmt;
+    Document *doc;
+    Media *m1;
+    Media *m2;
+
+    start (&fmt, &doc, &m1, &m2);
+    m1->setProperty ("time", "1000s");
+    tick_until_stopped (fmt, m1);
+    g_assert (m1->isSleeping ());
+    g_assert (m2->isOccurring ());
+
+    delete fmt;
+  }
+
+  Player::waitReaped ();
+  g_assert_cmpuint (AudioMixer::getInputCount (), ==, 0);
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,115 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+#include "WebServices.h"
+#include "PlayerRemote.h"
+#include <libsoup/soup.h>
+
+// Checks that remote player actions are coalesced and flushed per tick,
+// using a local libsoup mock of a remote player; see
+// bench/bench-PlayerRemote.cpp for the throughput benchmark.
+
+#define MOCK_PORT (WS_PORT_DEFAULT + 21)
+#define MEDIAS 10
+
+static guint received;
+
+static void
+cb_mock_node (SoupServer *server, SoupMessage *msg, const char *path,
+              GHashTable *query, SoupClientContext *client, gpointer data)
+{
+  received++;
+  soup_message_set_status (msg, SOUP_STATUS_OK);
+}
+
+static void
+cb_mock_default (SoupServer *server, SoupMessage *msg, const char *path,
+                 GHashTable *query, SoupClientContext *client, gpointer data)
+{
+  soup_message_set_status (msg, SOUP_STATUS_OK);
+}
+
+static string
+gen_document (int n)
+{
+  string body;
+
+  for (int i = 0; i < n; i++)
+    body += xstrbuild ("  <media id='m%d' type='%s'/>\n", i,
+                       REMOTE_PLAYER_MIME_NCL360);
+  return "<ncl>\n <body>\n" + body + " </body>\n</ncl>\n";
+}
+
+int
+main (void)
+{
+  SoupServer *server;
+  GError *error = nullptr;
+  Formatter *fmt;
+  Document *doc;
+  PlayerRemoteData pdata;
+  WebServicesRemoteStats stats;
+
+  server = soup_server_new (SOUP_SERVER_SERVER_HEADER, "mock", nullptr);
+  g_assert_nonnull (server);
+  if (!soup_server_listen_local (server, MOCK_PORT,
+                                 SoupServerListenOptions (0), &error))
+    ERROR ("cannot start mock remote player: %s", error->message);
+  soup_server_add_handler (server, "/scene/nodes", cb_mock_node,
+                           nullptr, nullptr);
+  soup_server_add_handler (server, nullptr, cb_mock_default, nullptr,
+                           nullptr);
+
+  tests_parse_and_start (&fmt, &doc, gen_document (MEDIAS));
+  pdata.location = xstrbuild ("http://127.0.0.1:%d", MOCK_PORT);
+  pdata.deviceType = "test";
+  pdata.supportedFormats.push_back (REMOTE_PLAYER_MIME_NCL360);
+  pdata.recognizedableEvents.push_back ("selection");
+  g_assert (fmt->getWebServices ()->machMediaThenSetPlayerRemote (pdata));
+
+  // Start followed by stop in the same tick is coalesced away.
+  for (int i = 0; i < MEDIAS; i++)
+    {
+      Object *obj = doc->getObjectById (xstrbuild ("m%d", i));
+      g_assert_nonnull (obj);
+      doc->evalAction (obj->getLambda (), Event::START);
+      doc->evalAction (obj->getLambda (), Event::STOP);
+    }
+  fmt->sendTick (0, 0, 0);
+  fmt->getWebServices ()->getRemoteStats (&stats);
+  g_assert_cmpuint (stats.coalesced, ==, (guint64) (2 * MEDIAS));
+
+  // Starts are flushed by the next tick.
+  received = 0;
+  for (int i = 0; i < MEDIAS; i++)
+    {
+      Object *obj = doc->getObjectById (xstrbuild ("m%d", i));
+      doc->evalAction (obj->getLambda (), Event::START);
+    }
+  fmt->sendTick (0, 0, 0);
+  while (received < MEDIAS)
+    g_main_context_iteration (nullptr, TRUE);
+
+  fmt->getWebServices ()->getRemoteStats (&stats);
+  g_assert_cmpuint (stats.sent, ==, received);
+  g_assert_cmpuint (stats.dropped, ==, 0);
+  g_assert_cmpuint (stats.failed, ==, 0);
+
+  delete fmt;
+  g_object_unref (server);
+  exit (EXIT_SUCCESS);
+}
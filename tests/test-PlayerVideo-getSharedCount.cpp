@@ -0,0 +1,72 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+#include "PlayerVideo.h"
+
+int
+main (void)
+{
+  Formatter *fmt;
+  Document *doc;
+
+  tests_parse_and_start (&fmt, &doc, xstrbuild ("\
+<ncl>\n\
+<head>\n\
+  <regionBase>\n\
+    <region id='reg1' top='0%%' left='0%%' width='50%%' height='50%%'/>\n\
+    <region id='reg2' top='0%%' left='50%%' width='50%%' height='50%%'/>\n\
+    <region id='reg3' bottom='0%%' right='0%%' width='50%%' height='50%%'/>\n\
+    <region id='reg4' bottom='0%%' right='50%%' width='50%%' height='50%%'/>\n\
+  </regionBase>\n\
+  <descriptorBase>\n\
+    <descriptor id='desc1' region='reg1'/>\n\
+    <descriptor id='desc2' region='reg2'/>\n\
+    <descriptor id='desc3' region='reg3'/>\n\
+    <descriptor id='desc4' region='reg4'/>\n\
+  </descriptorBase>\n\
+</head>\n\
+<body>\n\
+  <port id='p1' component='m1'/>\n\
+  <port id='p2' component='m2'/>\n\
+  <port id='p3' component='m3'/>\n\
+  <port id='p4' component='m4'/>\n\
+  <media id='m1' src='%s' descriptor='desc1'/>\n\
+  <media id='m2' src='%s' descriptor='desc2'/>\n\
+  <media id='m3' src='%s' descriptor='desc3'/>\n\
+  <media id='m4' src='%s' descriptor='desc4'/>\n\
+</body>\n\
+</ncl>\n", samples[6].uri, samples[6].uri, samples[6].uri,
+                                                samples[6].uri));
+
+  // Players are created in the next tick: all of them share the clock
+  // and bus.
+  g_assert_cmpuint (PlayerVideo::getSharedCount (), ==, 0);
+  fmt->setOptionBool ("sharedClock", true);
+  fmt->sendTick (0, 0, 0);
+  g_assert_cmpuint (PlayerVideo::getSharedCount (), ==, 4);
+
+  for (int i = 0; i < 10; i++)
+    fmt->sendTick (33 * GINGA_MSECOND, 33 * GINGA_MSECOND, 0);
+
+  // Stopped pipelines are detached from the shared bus.
+  g_assert (fmt->stop ());
+  g_assert_cmpuint (PlayerVideo::getSharedCount (), ==, 0);
+  Player::waitReaped ();
+
+  delete fmt;
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,105 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+#include "AudioMixer.h"
+
+// Gets the surface bytes of the player of \p media.
+static guint64
+surface_bytes (Media *media)
+{
+  Player::Metrics pm;
+
+  g_assert (media->getPlayerMetrics (nullptr, &pm));
+  return pm.surfaceBytes;
+}
+
+int
+main (void)
+{
+  Formatter *fmt;
+  Document *doc;
+  Media *m;
+  cairo_surface_t *sfc;
+  cairo_t *cr;
+
+  // Mix into a clocked fakesink, so that no audio device is needed.
+  g_assert (AudioMixer::setSink ("fakesink sync=true", nullptr));
+
+  tests_parse_and_start (&fmt, &doc, "\
+<ncl>\n\
+  <body>\n\
+    <port id='start' component='m'/>\n\
+    <media id='m' type='application/x-ginga-siggen'>\n\
+      <property name='volume' value='0'/>\n\
+      <property name='visible' value='false'/>\n\
+    </media>\n\
+  </body>\n\
+</ncl>\n");
+
+  m = cast (Media *, doc->getObjectById ("m"));
+  g_assert_nonnull (m);
+
+  sfc = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 800, 600);
+  g_assert_nonnull (sfc);
+  cr = cairo_create (sfc);
+  g_assert_nonnull (cr);
+
+  fmt->sendTick (0, 0, 0);
+  g_assert (m->isOccurring ());
+
+  // The generator plays through the audio mixer.
+  g_assert_cmpuint (AudioMixer::getInputCount (), ==, 1);
+
+  // Invisible: the scope branch is not built, so there is nothing drawn.
+  for (int i = 0; i < 10; i++)
+    {
+      fmt->redraw (cr);
+      g_usleep (10 * G_USEC_PER_SEC / 1000);
+    }
+  g_assert_cmpuint (surface_bytes (m), ==, 0);
+
+  // Visible: the branch is built; hidden again: it is torn down and its
+  // last frame dropped.
+  for (int k = 0; k < 3; k++)
+    {
+      m->setProperty ("visible", "true");
+      for (int i = 0; i < 5; i++)
+        {
+          fmt->redraw (cr);
+          g_usleep (10 * G_USEC_PER_SEC / 1000);
+        }
+      m->setProperty ("visible", "false");
+      fmt->redraw (cr);
+      g_assert_cmpuint (surface_bytes (m), ==, 0);
+    }
+
+  // Zero-sized media is treated as invisible.
+  m->setProperty ("width", "0");
+  m->setProperty ("visible", "true");
+  fmt->redraw (cr);
+  g_assert_cmpuint (surface_bytes (m), ==, 0);
+
+  g_assert (fmt->stop ());
+  Player::waitReaped ();
+  g_assert_cmpuint (AudioMixer::getInputCount (), ==, 0);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (sfc);
+  delete fmt;
+
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,223 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+#include "tests.h"
+#include "WebServices.h"
+#include <libsoup/soup.h>
+#include <json/json.h>
+
+// Loopback client of the WebServices event channel.
+
+Formatter *fmt;
+GMainLoop *loop;
+SoupWebsocketConnection *conn = nullptr;
+list<Json::Value> frames;
+
+static void
+cb_client_message (SoupWebsocketConnection *conn, gint type,
+                   GBytes *message, gpointer data)
+{
+  Json::Value root;
+  Json::CharReaderBuilder builder;
+  Json::CharReader *reader = builder.newCharReader ();
+  string errors;
+  const char *text;
+  gsize size;
+
+  g_assert (type == SOUP_WEBSOCKET_DATA_TEXT);
+  text = (const char *) g_bytes_get_data (message, &size);
+  g_assert (reader->parse (text, text + size, &root, &errors));
+  delete reader;
+
+  frames.push_back (root);
+  g_main_loop_quit (loop);
+}
+
+static void
+cb_client_connected (GObject *session, GAsyncResult *res, gpointer data)
+{
+  GError *error = nullptr;
+
+  conn = soup_session_websocket_connect_finish (SOUP_SESSION (session), res,
+                                                &error);
+  if (error != nullptr)
+    ERROR ("cannot connect to event channel: %s", error->message);
+  g_assert_nonnull (conn);
+  g_signal_connect (conn, "message", G_CALLBACK (cb_client_message),
+                    nullptr);
+  g_main_loop_quit (loop);
+}
+
+static void
+client_connect ()
+{
+  SoupSession *session;
+  SoupMessage *msg;
+  gchar *url;
+
+  session = soup_session_new ();
+  g_assert_nonnull (session);
+  url = g_strdup_printf ("ws://localhost:%d%s",
+                         fmt->getWebServices ()->host_port,
+                         WS_ROUTE_EVENTS);
+  msg = soup_message_new (SOUP_METHOD_GET, url);
+  g_assert_nonnull (msg);
+  soup_session_websocket_connect_async (session, msg, nullptr, nullptr,
+                                        nullptr, cb_client_connected,
+                                        nullptr);
+  g_main_loop_run (loop);
+  g_object_unref (session);
+  g_free (url);
+}
+
+// Sends command and waits for its reply.
+static Json::Value
+client_command (const string &cmd, int id)
+{
+  soup_websocket_connection_send_text (conn, cmd.c_str ());
+  while (true)
+    {
+      for (auto it = frames.begin (); it != frames.end (); ++it)
+        {
+          if ((*it)["id"].asInt () == id)
+            {
+              Json::Value frame = *it;
+              frames.erase (it);
+              return frame;
+            }
+        }
+      g_main_loop_run (loop);
+    }
+}
+
+// Waits for the presentation event of \p node with \p transition.
+static void
+client_wait_presentation (const string &node, const string &transition)
+{
+  while (true)
+    {
+      while (frames.empty ())
+        g_main_loop_run (loop);
+      Json::Value frame = frames.front ();
+      frames.pop_front ();
+      g_assert (frame.isMember ("event"));
+      g_assert (frame["event"].asString () == "presentation");
+      if (frame["node"].asString () == node
+          && frame["interface"].asString () == "@lambda"
+          && frame["transition"].asString () == transition)
+        return;
+    }
+}
+
+int
+main (void)
+{
+  Document *doc;
+  Media *m2;
+  Json::Value reply;
+
+  loop = g_main_loop_new (nullptr, FALSE);
+  tests_parse_and_start (&fmt, &doc, "\
+<ncl>\n\
+ <head>\n\
+  <connectorBase>\n\
+   <causalConnector id='onLookAtStart'>\n\
+    <simpleCondition role='onLookAt'/>\n\
+    <simpleAction role='start'/>\n\
+   </causalConnector>\n\
+  </connectorBase>\n\
+ </head>\n\
+ <body id='body'>\n\
+  <port id='start' component='m1'/>\n\
+  <media id='m1'/>\n\
+  <media id='m2'/>\n\
+  <link xconnector='onLookAtStart'>\n\
+   <bind role='onLookAt' component='m1'/>\n\
+   <bind role='start' component='m2'/>\n\
+  </link>\n\
+ </body>\n\
+</ncl>");
+  Formatter::setOptionWebServices (fmt, "webservices", true);
+  fmt->sendTick (0, 0, 0);
+
+  m2 = cast (Media *, doc->getObjectById ("m2"));
+  g_assert_nonnull (m2);
+  g_assert (m2->isSleeping ());
+
+  client_connect ();
+
+  // Bad commands are answered with an error.
+  reply = client_command ("{\"action\": \"subscribe\", \"id\": 1,"
+                          " \"events\": [\"nothing\"]}",
+                          1);
+  g_assert (reply["status"].asString () == "error");
+  reply = client_command ("{\"action\": \"lookAt\", \"id\": 2,"
+                          " \"node\": \"nonexistent\"}",
+                          2);
+  g_assert (reply["status"].asString () == "error");
+
+  // So are commands whose members have the wrong type.
+  reply = client_command ("{\"action\": [\"subscribe\"], \"id\": 10}", 10);
+  g_assert (reply["status"].asString () == "error");
+  reply = client_command ("{\"action\": \"subscribe\", \"id\": 11,"
+                          " \"events\": [{}]}",
+                          11);
+  g_assert (reply["status"].asString () == "error");
+  reply = client_command ("{\"action\": \"register\", \"id\": 12,"
+                          " \"supportedFormats\": [[]]}",
+                          12);
+  g_assert (reply["status"].asString () == "error");
+  reply = client_command ("{\"action\": \"edit\", \"id\": 13,"
+                          " \"commands\": [{\"x\": 1}]}",
+                          13);
+  g_assert (reply["status"].asString () == "error");
+  reply = client_command ("{\"action\": \"select\", \"id\": 14,"
+                          " \"node\": {}}",
+                          14);
+  g_assert (reply["status"].asString () == "error");
+
+  // Subscribe to presentation events only.
+  reply = client_command ("{\"action\": \"subscribe\", \"id\": 3,"
+                          " \"events\": [\"presentation\"]}",
+                          3);
+  g_assert (reply["reply"].asString () == "subscribe");
+  g_assert (reply["status"].asString () == "ok");
+
+  // Command back: lookAt m1 starts m2 in the next tick.
+  reply = client_command ("{\"action\": \"lookAt\", \"id\": 4,"
+                          " \"node\": \"m1\"}",
+                          4);
+  g_assert (reply["status"].asString () == "ok");
+  g_assert (frames.empty ()); // lookAt events are not subscribed
+  fmt->sendTick (0, 0, 0);
+  g_assert (m2->isOccurring ());
+  client_wait_presentation ("m2", "start");
+
+  // Editing commands go through the same channel.
+  reply = client_command ("{\"action\": \"edit\", \"id\": 5,"
+                          " \"command\": \"setPropertyValue m2 foo bar\"}",
+                          5);
+  g_assert (reply["status"].asString () == "ok");
+  g_assert (m2->getProperty ("foo") == "bar");
+
+  soup_websocket_connection_close (conn, SOUP_WEBSOCKET_CLOSE_NORMAL,
+                                   nullptr);
+  g_object_unref (conn);
+  delete fmt;
+  g_main_loop_unref (loop);
+
+  exit (EXIT_SUCCESS);
+}
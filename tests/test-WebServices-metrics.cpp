@@ -0,0 +1,140 @@
+/* Copyright (C) 2006-2018 PUC-Rio/Laboratorio TeleMidia
+
+This file is part of Ginga (Ginga-NCL).
+
+Ginga is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+Ginga is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Ginga.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "tests.h"
+#include "WebServices.h"
+#include <libsoup/soup.h>
+
+static void
+cb_metrics (SoupSession *session, SoupMessage *msg, gpointer loop)
+{
+  string text;
+
+  g_assert (msg->status_code == SOUP_STATUS_OK);
+  text = string (msg->response_body->data,
+                 (size_t) msg->response_body->length);
+  g_assert (text.find ("# TYPE ginga_redraw_seconds histogram\n")
+            != string::npos);
+  g_assert (text.find ("ginga_redraw_seconds_bucket{le=\"+Inf\"} 2\n")
+            != string::npos);
+  g_main_loop_quit ((GMainLoop *) loop);
+}
+
+int
+main (void)
+{
+  Formatter *fmt;
+  Document *doc;
+  cairo_surface_t *sfc;
+  cairo_t *cr;
+  FormatterMetrics fm;
+  string text;
+  guint64 acc;
+  GMainLoop *loop;
+  SoupSession *session;
+  SoupMessage *msg;
+  gchar *url;
+
+  tests_parse_and_start (&fmt, &doc, "\
+<ncl>\n\
+  <head>\n\
+    <connectorBase>\n\
+      <causalConnector id='onBeginStart'>\n\
+        <simpleCondition role='onBegin'/>\n\
+        <simpleAction role='start'/>\n\
+      </causalConnector>\n\
+    </connectorBase>\n\
+  </head>\n\
+  <body>\n\
+    <port id='p1' component='m1'/>\n\
+    <media id='m1'/>\n\
+    <media id='m2'/>\n\
+    <link xconnector='onBeginStart'>\n\
+      <bind role='onBegin' component='m1'/>\n\
+      <bind role='start' component='m2'/>\n\
+    </link>\n\
+  </body>\n\
+</ncl>\n");
+
+  sfc = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 800, 600);
+  g_assert_nonnull (sfc);
+  cr = cairo_create (sfc);
+  g_assert_nonnull (cr);
+
+  fmt->sendTick (0, 0, 0);
+  fmt->redraw (cr);
+  fmt->sendTick (0, 0, 0);
+  fmt->redraw (cr);
+
+  // Formatter counters.
+  fmt->getMetrics (&fm);
+  g_assert_cmpuint (fm.redrawCount, ==, 2);
+  g_assert_cmpuint (fm.tickCount, ==, 2);
+  acc = 0;
+  for (size_t i = 0; i < FORMATTER_REDRAW_BUCKETS; i++)
+    {
+      if (i > 0)
+        g_assert_cmpint (fm.redrawBounds[i - 1], <, fm.redrawBounds[i]);
+      acc += fm.redrawBuckets[i];
+    }
+  g_assert_cmpuint (acc, <=, fm.redrawCount);
+  g_assert_cmpuint (fm.droppedFrames, ==, 0);
+
+  // Document counters.
+  g_assert_cmpuint (doc->getActionCount (), >, 0);
+  g_assert_cmpuint (doc->getLinkScanCount (), >, 0);
+
+  // Exposition.
+  text = fmt->getWebServices ()->getMetrics ();
+  g_assert (text.find ("ginga_redraw_seconds_count 2\n") != string::npos);
+  g_assert (text.find ("ginga_tick_seconds_count 2\n") != string::npos);
+  g_assert (text.find ("ginga_players{kind=\"timer\"} 2\n")
+            != string::npos);
+  g_assert (text.find (xstrbuild ("ginga_actions_evaluated_total %"
+                                  G_GUINT64_FORMAT "\n",
+                                  doc->getActionCount ()))
+            != string::npos);
+  g_assert (text.find ("ginga_remote_queue_depth 0\n") != string::npos);
+  g_assert (text.find ("# TYPE ginga_video_dropped_frames_total counter\n")
+            != string::npos);
+  g_assert (text.find ("ginga_video_dropped_frames_total 0\n")
+            != string::npos);
+  g_assert (text.find ("# TYPE ginga_lua_cycle_seconds_total counter\n")
+            != string::npos);
+
+  // Route.
+  Formatter::setOptionWebServices (fmt, "webservices", true);
+  loop = g_main_loop_new (nullptr, FALSE);
+  session = soup_session_new ();
+  g_assert_nonnull (session);
+  url = g_strdup_printf ("http://localhost:%u%s",
+                         fmt->getWebServices ()->host_port,
+                         WS_ROUTE_METRICS);
+  msg = soup_message_new (SOUP_METHOD_GET, url);
+  g_assert_nonnull (msg);
+  soup_session_queue_message (session, msg, cb_metrics, loop);
+  g_main_loop_run (loop);
+  g_free (url);
+  g_object_unref (session);
+  g_main_loop_unref (loop);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (sfc);
+  delete fmt;
+
+  exit (EXIT_SUCCESS);
+}